@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
+#include <termios.h>
 #include <unistd.h>
 
 #include "ece391support.h"
@@ -49,6 +50,8 @@ DO_CALL(ece391_halt,1 /* SYS_HALT */);
 DO_CALL(__ece391_read,3 /* SYS_READ */);
 DO_CALL(__ece391_write,4 /* SYS_WRITE */);
 DO_CALL(__ece391_close,6 /* SYS_CLOSE */);
+/* Linux's struct pollfd and POLL* values match ours */
+DO_CALL(ece391_poll,168 /* Linux SYS_POLL */);
 
 /* Call the main() function, then halt with its return value. */
 
@@ -225,3 +228,40 @@ ece391_close (int32_t fd)
     return 0;
 }
 
+int32_t 
+ece391_fcntl (int32_t fd, int32_t cmd, int32_t arg)
+{
+    int flags;
+
+    if (-1 == (flags = fcntl (fd, F_GETFL)))
+        return -1;
+    if (ECE391_F_GETFL == cmd)
+        return (flags & O_NONBLOCK) ? ECE391_O_NONBLOCK : 0;
+    if (ECE391_F_SETFL != cmd)
+        return -1;
+    if (arg & ECE391_O_NONBLOCK)
+        flags |= O_NONBLOCK;
+    else
+        flags &= ~O_NONBLOCK;
+    return (-1 == fcntl (fd, F_SETFL, flags)) ? -1 : 0;
+}
+
+int32_t 
+ece391_ioctl (int32_t fd, int32_t cmd, int32_t arg)
+{
+    struct termios tio;
+
+    if (-1 == tcgetattr (fd, &tio))
+        return -1;
+    if (ECE391_TERM_GET_MODE == cmd)
+        return (tio.c_lflag & ICANON) ? ECE391_TERM_COOKED : ECE391_TERM_RAW;
+    if (ECE391_TERM_SET_MODE != cmd)
+        return -1;
+    if (ECE391_TERM_RAW == arg)
+        tio.c_lflag &= ~(ICANON | ECHO);
+    else if (ECE391_TERM_COOKED == arg)
+        tio.c_lflag |= ICANON | ECHO;
+    else
+        return -1;
+    return (-1 == tcsetattr (fd, TCSANOW, &tio)) ? -1 : 0;
+}
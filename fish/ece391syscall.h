@@ -3,6 +3,126 @@
 
 #include <stdint.h>
 
+/* Returned by a read on a non-blocking descriptor that has no data. */
+#define ECE391_EAGAIN       -2
+
+/* Events for ece391_poll. */
+#define ECE391_POLLIN       0x0001
+#define ECE391_POLLOUT      0x0004
+#define ECE391_POLLNVAL     0x0020
+
+/* Commands and flags for ece391_fcntl. */
+#define ECE391_F_GETFL      1
+#define ECE391_F_SETFL      2
+#define ECE391_O_NONBLOCK   0x1
+
+/* Terminal commands for ece391_ioctl. In raw mode reads return each
+ * keystroke as it is typed, without echo or line editing. */
+#define ECE391_TERM_GET_MODE    1
+#define ECE391_TERM_SET_MODE    2
+#define ECE391_TERM_COOKED      0
+#define ECE391_TERM_RAW         1
+
+/* One descriptor watched by ece391_poll; a timeout is in milliseconds,
+ * negative waits forever. */
+struct ece391_pollfd {
+    int32_t fd;
+    int16_t events;
+    int16_t revents;
+};
+
+/* Operations for ece391_submit. The kernel runs queued operations in
+ * order and posts one completion, tagged with user_data, for each.
+ * Indices run freely and are masked with ECE391_RING_MASK; the program
+ * advances sq_tail and cq_head, the kernel sq_head and cq_tail. */
+#define ECE391_RING_READ        1
+#define ECE391_RING_WRITE       2
+#define ECE391_RING_OPEN        3   /* buf holds the filename */
+#define ECE391_RING_CLOSE       4
+#define ECE391_RING_ENTRIES     16
+#define ECE391_RING_MASK        (ECE391_RING_ENTRIES - 1)
+
+struct ece391_sqe {
+    int32_t opcode;
+    int32_t fd;
+    void* buf;
+    int32_t nbytes;
+    uint32_t user_data;
+};
+
+struct ece391_cqe {
+    uint32_t user_data;
+    int32_t result;
+};
+
+struct ece391_ring {
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    struct ece391_sqe sq[ECE391_RING_ENTRIES];
+    struct ece391_cqe cq[ECE391_RING_ENTRIES];
+};
+
+/* Shared memory segments are attached at page aligned addresses in the
+ * 4MB window starting at ECE391_SHM_BASE; ece391_shm_attach returns the
+ * address.  A segment holds at most ECE391_SHM_MAX_SIZE bytes. */
+#define ECE391_SHM_BASE         0x08800000
+#define ECE391_SHM_MAX_SIZE     0x40000
+
+/* Option for ece391_waitpid: return 0 instead of waiting when no
+ * spawned child has halted yet.  A pid of -1 waits for any child. */
+#define ECE391_WNOHANG          1
+
+/* Times for ece391_nanosleep, ece391_clock_gettime and ece391_setitimer.
+ * The monotonic clock counts from boot.  Sleeps and interval timers run
+ * on 10ms ticks; an interval timer sends ALARM. */
+#define ECE391_CLOCK_MONOTONIC  1
+#define ECE391_ITIMER_REAL      0
+
+struct ece391_timespec {
+    int32_t tv_sec;
+    int32_t tv_nsec;
+};
+
+struct ece391_itimerval {
+    struct ece391_timespec it_interval;
+    struct ece391_timespec it_value;
+};
+
+/* Block cache counters since boot, from bcache_stats.  A read ahead
+ * block counts as a hit when it is read. */
+struct ece391_bcache_stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t readaheads;
+    uint32_t readahead_hits;
+    uint32_t writes;
+};
+
+/* Directory entries from ece391_getdents, packed one after the other.
+ * The name is NUL terminated and the length is in bytes. */
+#define ECE391_TYPE_RTC     0
+#define ECE391_TYPE_DIR     1
+#define ECE391_TYPE_FILE    2
+
+struct ece391_dirent {
+    uint32_t inode;
+    uint32_t type;
+    uint32_t length;
+    uint8_t name[33];
+    uint8_t reserved[3];
+};
+
+/* A file's inode, type, length in bytes and data blocks, from
+ * ece391_stat and ece391_fstat. */
+struct ece391_stat {
+    uint32_t inode;
+    uint32_t type;
+    uint32_t length;
+    uint32_t blocks;
+};
+
 /* All calls return >= 0 on success or -1 on failure. */
 
 /*  
@@ -19,6 +139,31 @@ extern int32_t ece391_open (const uint8_t* filename);
 extern int32_t ece391_close (int32_t fd);
 extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
+extern int32_t ece391_poll (struct ece391_pollfd* fds, int32_t nfds, int32_t timeout);
+extern int32_t ece391_fcntl (int32_t fd, int32_t cmd, int32_t arg);
+extern int32_t ece391_ioctl (int32_t fd, int32_t cmd, int32_t arg);
+extern int32_t ece391_submit (struct ece391_ring* ring);
+extern int32_t ece391_pipe (int32_t fds[2]);
+extern int32_t ece391_dup2 (int32_t old_fd, int32_t new_fd);
+extern int32_t ece391_shm_create (int32_t key, uint32_t size);
+extern int32_t ece391_shm_attach (int32_t id, void* addr);
+extern int32_t ece391_spawn (const uint8_t* command);
+extern int32_t ece391_waitpid (int32_t pid, int32_t* status, int32_t options);
+extern int32_t ece391_nanosleep (const struct ece391_timespec* req,
+                                 struct ece391_timespec* rem);
+extern int32_t ece391_clock_gettime (int32_t clock_id, struct ece391_timespec* tp);
+extern int32_t ece391_setitimer (int32_t which, const struct ece391_itimerval* new_value,
+                                 struct ece391_itimerval* old_value);
+extern int32_t ece391_create (const uint8_t* filename);
+extern int32_t ece391_truncate (int32_t fd, int32_t length);
+extern int32_t ece391_bcache_stats (struct ece391_bcache_stats* stats);
+extern int32_t ece391_getdents (int32_t fd, struct ece391_dirent* buf,
+                                int32_t nbytes);
+extern int32_t ece391_stat (const uint8_t* filename, struct ece391_stat* buf);
+extern int32_t ece391_fstat (int32_t fd, struct ece391_stat* buf);
+
+/* nonzero when system calls enter the kernel with SYSENTER instead of int $0x80 */
+extern int32_t ece391_use_sysenter;
 
 #endif /* ECE391SYSCALL_H */
 
@@ -5,9 +5,11 @@
 
 #define NULL 0
 #define WAIT 100
+#define LINE_MAX 128
 uint8_t *vmem_base_addr;
 uint8_t *mp1_set_video_mode (void);
 void add_frames(uint8_t *, uint8_t *, int32_t);
+int32_t run_ticks(int32_t rtc_fd, int32_t n);
 void ece391_memset(void* memory, char c, int n);
 int32_t ece391_memcpy(void* dest, const void* src, int32_t n);
 
@@ -22,7 +24,7 @@ static struct mp1_blink_struct blink_array[80*25];
 
 int main(void)
 {
-    int rtc_fd, ret_val, i, garbage;
+    int rtc_fd, ret_val;
     struct mp1_blink_struct blink_struct;
 
     ece391_memset(blink_array, 0, sizeof(struct mp1_blink_struct)*80*25);
@@ -38,10 +40,8 @@ int main(void)
     ret_val = 32;
     ret_val = ece391_write(rtc_fd, &ret_val, 4);
 
-    for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
-    }
+    if(run_ticks(rtc_fd, WAIT))
+        goto quit;
 
     blink_struct.on_char = 'I';
     blink_struct.off_char = 'M';
@@ -51,30 +51,59 @@ int main(void)
 
     mp1_ioctl((unsigned long)&blink_struct, RTC_ADD);
 
-    for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
-    }
+    if(run_ticks(rtc_fd, WAIT))
+        goto quit;
 
     mp1_ioctl((40 << 16 | (6*80+60)), RTC_SYNC);
 
-    for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
-    }
+    if(run_ticks(rtc_fd, WAIT))
+        goto quit;
 
     mp1_ioctl(6*80+60, RTC_REMOVE);
 
-    for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
-    }
+    run_ticks(rtc_fd, WAIT);
 
+quit:
     ece391_close(rtc_fd);
 
     return 0;
 }
 
+/*
+ * Runs the blink tasklet for n RTC ticks. Waits on the keyboard and the
+ * RTC together so that pressing enter stops the animation right away.
+ * Returns 1 if the user asked to quit, 0 otherwise.
+ */
+int32_t
+run_ticks(int32_t rtc_fd, int32_t n)
+{
+    struct ece391_pollfd fds[2];
+    uint8_t line[LINE_MAX];
+    int32_t i, garbage;
+
+    fds[0].fd = 0;
+    fds[0].events = ECE391_POLLIN;
+    fds[1].fd = rtc_fd;
+    fds[1].events = ECE391_POLLIN;
+
+    for(i=0; i<n; ) {
+        if(ece391_poll(fds, 2, -1) < 0) {
+            return 1;
+        }
+        if(fds[0].revents & ECE391_POLLIN) {
+            ece391_read(0, line, LINE_MAX);
+            return 1;
+        }
+        if(fds[1].revents & ECE391_POLLIN) {
+            ece391_read(rtc_fd, &garbage, 4);
+            mp1_rtc_tasklet(garbage);
+            i++;
+        }
+    }
+
+    return 0;
+}
+
 void
 add_frames(uint8_t *f0, uint8_t *f1, int32_t rtc_fd)
 {
@@ -0,0 +1,586 @@
+/* ata.c -- IDE/ATA disk driver for the primary channel
+ * vim:ts=4 noexpandtab
+ */
+
+#include "ata.h"
+#include "syscall.h"
+
+#define EFLAGS_IF			0x200			// interrupts enabled
+#define ATA_SPIN_LIMIT		1000000			// status reads before giving up on the disk
+#define ATA_FLOATING_BUS	0xFF			// status with nothing on the channel
+#define ATA_ID_WORDS		256
+#define ATA_ID_CAPS			49				// capabilities, bit 8 is DMA
+#define ATA_ID_CAP_DMA		0x100
+#define ATA_ID_SECTORS		60				// LBA28 sectors, two words
+#define ATA_NIEN_OFF		0x00			// device control with INTRQ enabled
+
+#define PCI_CONFIG_ADDRESS	0xCF8
+#define PCI_CONFIG_DATA		0xCFC
+#define PCI_ENABLE			0x80000000
+#define PCI_DEVICES			32
+#define PCI_FUNCTIONS		8
+#define PCI_ID				0x00			// device and vendor
+#define PCI_COMMAND			0x04
+#define PCI_CLASS			0x08			// class, subclass, prog if, revision
+#define PCI_BAR4			0x20
+#define PCI_NO_DEVICE		0xFFFF
+#define PCI_CLASS_IDE		0x0101			// mass storage, IDE
+#define PCI_PROGIF_BM		0x80			// the controller can bus master
+#define PCI_CMD_IO			0x01
+#define PCI_CMD_BUS_MASTER	0x04
+#define PCI_BAR_IO			0x01
+#define PCI_BAR_IO_MASK		0xFFFC
+
+#define PRD_ENTRIES			4
+#define PRD_BOUNDARY		0x10000			// an entry may not cross 64kB
+
+/* A physical region descriptor, one piece of a DMA transfer. */
+typedef struct prd_t {
+	uint32_t addr;
+	uint16_t bytes;							// 0 means 64kB
+	uint16_t flags;
+} prd_t;
+
+/* Read by the bus master, so it must not cross 64kB either. */
+static prd_t prd_table[PRD_ENTRIES] __attribute__((aligned(32)));
+
+/* Requests in the order they were made, the head is on the disk. */
+static ata_request_t* queue_head = NULL;
+static ata_request_t* queue_tail = NULL;
+/* Sectors on each drive, 0 if there is no disk. */
+static uint32_t disk_sectors[ATA_DRIVES];
+/* Set for the drives that can do DMA. */
+static uint8_t disk_dma[ATA_DRIVES];
+/* I/O base of the bus master registers, 0 to use PIO for everything. */
+static uint32_t bm_base = 0;
+
+/*
+ * ata_delay
+ *   DESCRIPTION:	Waits the 400ns a drive may take to show BSY after a
+ *					command by reading the alternate status four times.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static void ata_delay() {
+	inb(ATA_CTRL_PORT);
+	inb(ATA_CTRL_PORT);
+	inb(ATA_CTRL_PORT);
+	inb(ATA_CTRL_PORT);
+}
+
+/*
+ * ata_spin
+ *   DESCRIPTION:	Polls the alternate status until the drive is no longer
+ *					busy. Only used for IDENTIFY and for the first sector of a
+ *					PIO write, which raise no interrupt of their own.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the status, or -1 if the drive stayed busy
+ *   SIDE EFFECTS: 	none
+ */
+static int32_t ata_spin() {
+	uint32_t i, status;
+
+	for (i = 0; i < ATA_SPIN_LIMIT; i++) {
+		status = inb(ATA_CTRL_PORT);
+		if (!(status & ATA_SR_BSY))
+			return status;
+	}
+	return -1;
+}
+
+/*
+ * pio_in
+ *   DESCRIPTION:	Reads one sector from the data port.
+ *   INPUTS: 		none
+ *   OUTPUTS:		uint8_t* buf : ATA_SECTOR_SIZE bytes
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static inline void pio_in(uint8_t* buf) {
+	uint32_t words = ATA_SECTOR_SIZE / 2;
+
+	asm volatile("cld; rep insw"
+				 : "+D" (buf), "+c" (words)
+				 : "d" (ATA_IO_PORT + ATA_DATA)
+				 : "memory");
+}
+
+/*
+ * pio_out
+ *   DESCRIPTION:	Writes one sector to the data port, then gives the drive
+ *					time to go busy with it.
+ *   INPUTS: 		const uint8_t* buf : ATA_SECTOR_SIZE bytes
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static inline void pio_out(const uint8_t* buf) {
+	uint32_t words = ATA_SECTOR_SIZE / 2;
+
+	asm volatile("cld; rep outsw"
+				 : "+S" (buf), "+c" (words)
+				 : "d" (ATA_IO_PORT + ATA_DATA)
+				 : "memory");
+	ata_delay();
+}
+
+/*
+ * pci_read
+ *   DESCRIPTION:	Reads a register of a device's PCI configuration space.
+ *   INPUTS: 		uint32_t dev, fn : device and function on bus 0
+ *					uint32_t offset : register, a multiple of 4
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the register
+ *   SIDE EFFECTS: 	none
+ */
+static uint32_t pci_read(uint32_t dev, uint32_t fn, uint32_t offset) {
+	outl(PCI_ENABLE | (dev << 11) | (fn << 8) | offset, PCI_CONFIG_ADDRESS);
+	return inl(PCI_CONFIG_DATA);
+}
+
+/*
+ * pci_write
+ *   DESCRIPTION:	Writes a register of a device's PCI configuration space.
+ *   INPUTS: 		uint32_t dev, fn : device and function on bus 0
+ *					uint32_t offset : register, a multiple of 4
+ *					uint32_t val : value to write
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static void pci_write(uint32_t dev, uint32_t fn, uint32_t offset, uint32_t val) {
+	outl(PCI_ENABLE | (dev << 11) | (fn << 8) | offset, PCI_CONFIG_ADDRESS);
+	outl(val, PCI_CONFIG_DATA);
+}
+
+/*
+ * find_bus_master
+ *   DESCRIPTION:	Looks on PCI bus 0 for an IDE controller that can bus
+ *					master, like the PIIX in QEMU, and lets it. The primary
+ *					channel is assumed to be at the legacy ports.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	I/O base of its bus master registers, 0 if there is none
+ *   SIDE EFFECTS: 	Sets the I/O and bus master bits of its command register
+ */
+static uint32_t find_bus_master() {
+	uint32_t dev, fn, class, bar4;
+
+	for (dev = 0; dev < PCI_DEVICES; dev++) {
+		for (fn = 0; fn < PCI_FUNCTIONS; fn++) {
+			if ((pci_read(dev, fn, PCI_ID) & 0xFFFF) == PCI_NO_DEVICE)
+				continue;
+			class = pci_read(dev, fn, PCI_CLASS);
+			bar4 = pci_read(dev, fn, PCI_BAR4);
+			if ((class >> 16) != PCI_CLASS_IDE || !(class & (PCI_PROGIF_BM << 8))
+			   || !(bar4 & PCI_BAR_IO))
+				continue;
+			// the status half of the register is cleared by writing ones
+			pci_write(dev, fn, PCI_COMMAND, (pci_read(dev, fn, PCI_COMMAND) & 0xFFFF)
+					  | PCI_CMD_IO | PCI_CMD_BUS_MASTER);
+			return bar4 & PCI_BAR_IO_MASK;
+		}
+	}
+	return 0;
+}
+
+/*
+ * ata_identify
+ *   DESCRIPTION:	Sends IDENTIFY to a drive to learn its size and whether it
+ *					can do DMA. A missing drive, one that is not ATA, or one
+ *					that does not answer, is left with no disk.
+ *   INPUTS: 		uint32_t drive : ATA_MASTER or ATA_SLAVE
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0 if there is a disk, -1 if not
+ *   SIDE EFFECTS: 	Fills in disk_sectors and disk_dma
+ */
+static int32_t ata_identify(uint32_t drive) {
+	uint16_t id[ATA_ID_WORDS];
+	int32_t status;
+	uint32_t i;
+
+	outb(ATA_DRIVE_CHS | (drive ? ATA_DRIVE_SLAVE : 0), ATA_IO_PORT + ATA_DRIVE);
+	ata_delay();
+	outb(0, ATA_IO_PORT + ATA_COUNT);
+	outb(0, ATA_IO_PORT + ATA_LBA_LOW);
+	outb(0, ATA_IO_PORT + ATA_LBA_MID);
+	outb(0, ATA_IO_PORT + ATA_LBA_HIGH);
+	outb(ATA_CMD_IDENTIFY, ATA_IO_PORT + ATA_COMMAND);
+	ata_delay();
+	if (inb(ATA_IO_PORT + ATA_STATUS) == 0 || ata_spin() < 0)
+		return -1;
+	// ATAPI and SATA devices put their signature here and abort IDENTIFY
+	if (inb(ATA_IO_PORT + ATA_LBA_MID) || inb(ATA_IO_PORT + ATA_LBA_HIGH))
+		return -1;
+	// a drive that never gets its data ready is taken as no disk
+	for (i = 0; i < ATA_SPIN_LIMIT; i++) {
+		status = inb(ATA_IO_PORT + ATA_STATUS);
+		if (status & (ATA_SR_DRQ | ATA_SR_ERR))
+			break;
+	}
+	if (i == ATA_SPIN_LIMIT || (status & ATA_SR_ERR))
+		return -1;
+	pio_in((uint8_t*)id);
+
+	disk_sectors[drive] = id[ATA_ID_SECTORS] | (id[ATA_ID_SECTORS + 1] << 16);
+	disk_dma[drive] = (id[ATA_ID_CAPS] & ATA_ID_CAP_DMA) != 0;
+	return 0;
+}
+
+/*
+ * init_ata
+ *   DESCRIPTION:	Identifies the master and slave of the primary channel,
+ *					then finds the bus master to do DMA with if either can.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0 if there is a disk, -1 if not
+ *   SIDE EFFECTS: 	Enables IRQ 14
+ */
+int32_t init_ata() {
+	uint32_t drive;
+	int32_t found = -1;
+
+	if (inb(ATA_IO_PORT + ATA_STATUS) == ATA_FLOATING_BUS)
+		return -1;
+	for (drive = 0; drive < ATA_DRIVES; drive++) {
+		if (ata_identify(drive) == 0)
+			found = 0;
+	}
+	if (found != 0)
+		return -1;
+	if (disk_dma[ATA_MASTER] || disk_dma[ATA_SLAVE])
+		bm_base = find_bus_master();
+
+	outb(ATA_NIEN_OFF, ATA_CTRL_PORT);
+	enable_irq(ATA_IRQ);
+	return 0;
+}
+
+/*
+ * ata_sectors
+ *   DESCRIPTION:	Tells how large a disk is.
+ *   INPUTS: 		uint32_t drive : ATA_MASTER or ATA_SLAVE
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	number of sectors, 0 if there is no disk
+ *   SIDE EFFECTS: 	none
+ */
+uint32_t ata_sectors(uint32_t drive) {
+	return drive < ATA_DRIVES ? disk_sectors[drive] : 0;
+}
+
+/*
+ * setup_prd
+ *   DESCRIPTION:	Describes a buffer to the bus master, split where it
+ *					crosses a 64kB boundary.
+ *   INPUTS: 		uint8_t* buf : identity mapped buffer
+ *					uint32_t len : its length, at most ATA_MAX_SECTORS sectors
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Fills prd_table
+ */
+static void setup_prd(uint8_t* buf, uint32_t len) {
+	uint32_t addr = (uint32_t)buf;
+	uint32_t chunk;
+	int i;
+
+	for (i = 0; len > 0; i++) {
+		chunk = PRD_BOUNDARY - (addr & (PRD_BOUNDARY - 1));
+		if (chunk > len)
+			chunk = len;
+		prd_table[i].addr = addr;
+		prd_table[i].bytes = chunk & 0xFFFF;
+		prd_table[i].flags = 0;
+		addr += chunk;
+		len -= chunk;
+	}
+	prd_table[i - 1].flags = PRD_LAST;
+}
+
+static void ata_finish(int32_t status);
+
+/*
+ * ata_start
+ *   DESCRIPTION:	Hands the request at the head of the queue to the disk.
+ *					DMA transfers run on their own until the interrupt. PIO
+ *					reads interrupt once per sector; PIO writes need the first
+ *					sector before the drive does anything, the interrupt after
+ *					each one asks for the next. Call with interrupts off.
+ *   INPUTS: 		ata_request_t* req : the head of the queue
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	May finish the request at once if the drive refuses it
+ */
+static void ata_start(ata_request_t* req) {
+	uint32_t command;
+
+	outb(ATA_DRIVE_LBA | (req->drive ? ATA_DRIVE_SLAVE : 0) | ((req->lba >> 24) & 0x0F),
+		 ATA_IO_PORT + ATA_DRIVE);
+	if (req->dma) {
+		setup_prd(req->buf, req->count * ATA_SECTOR_SIZE);
+		outl((uint32_t)prd_table, bm_base + BM_PRD_TABLE);
+		outb(req->write ? 0 : BM_CMD_TO_MEMORY, bm_base + BM_COMMAND);
+		outb(inb(bm_base + BM_STATUS) | BM_ST_ERROR | BM_ST_IRQ, bm_base + BM_STATUS);
+		command = req->write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA;
+	} else {
+		command = req->write ? ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO;
+	}
+	outb(req->count & 0xFF, ATA_IO_PORT + ATA_COUNT);
+	outb(req->lba & 0xFF, ATA_IO_PORT + ATA_LBA_LOW);
+	outb((req->lba >> 8) & 0xFF, ATA_IO_PORT + ATA_LBA_MID);
+	outb((req->lba >> 16) & 0xFF, ATA_IO_PORT + ATA_LBA_HIGH);
+	outb(command, ATA_IO_PORT + ATA_COMMAND);
+	ata_delay();
+
+	if (req->dma) {
+		outb((req->write ? 0 : BM_CMD_TO_MEMORY) | BM_CMD_START, bm_base + BM_COMMAND);
+	} else if (req->write) {
+		if ((int32_t)(command = ata_spin()) < 0 || !(command & ATA_SR_DRQ)
+		   || (command & (ATA_SR_ERR | ATA_SR_DF))) {
+			ata_finish(-1);
+			return;
+		}
+		pio_out(req->buf);
+	}
+}
+
+/*
+ * ata_finish
+ *   DESCRIPTION:	Takes the head off the queue, runs its callback, wakes
+ *					whoever waits for it and starts the next request. Call
+ *					with interrupts off.
+ *   INPUTS: 		int32_t status : 0 if the transfer worked, -1 if not
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static void ata_finish(int32_t status) {
+	ata_request_t* req = queue_head;
+
+	queue_head = req->next;
+	if (queue_head == NULL)
+		queue_tail = NULL;
+	req->status = status;
+	if (req->callback != NULL)
+		req->callback(req);
+	req->finished = 1;
+	wake_up(&req->wait);
+	if (queue_head != NULL)
+		ata_start(queue_head);
+}
+
+/*
+ * ata_interrupt
+ *   DESCRIPTION:	Moves the head request along after the drive interrupted,
+ *					or after polling found it ready. Reading the status also
+ *					acknowledges the interrupt. An interrupt the request is
+ *					not waiting for, such as one left over from polling, is
+ *					ignored. Call with interrupts off.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Moves PIO data, may finish the request
+ */
+static void ata_interrupt() {
+	ata_request_t* req = queue_head;
+	uint32_t status, bm = 0;
+
+	if (bm_base) {
+		bm = inb(bm_base + BM_STATUS);
+		// writing the set bits back clears them
+		outb(bm, bm_base + BM_STATUS);
+	}
+	status = inb(ATA_IO_PORT + ATA_STATUS);
+	if (req == NULL || (status & ATA_SR_BSY))
+		return;
+
+	if (req->dma) {
+		if (!(bm & BM_ST_IRQ) && !(status & (ATA_SR_ERR | ATA_SR_DF)))
+			return;
+		outb(0, bm_base + BM_COMMAND);
+		ata_finish((bm & BM_ST_ERROR) || (status & (ATA_SR_ERR | ATA_SR_DF)) ? -1 : 0);
+		return;
+	}
+	if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+		ata_finish(-1);
+		return;
+	}
+
+	if (!req->write) {
+		if (!(status & ATA_SR_DRQ))
+			return;
+		pio_in(req->buf + req->done * ATA_SECTOR_SIZE);
+		if (++req->done == req->count)
+			ata_finish(0);
+		return;
+	}
+	// the sector sent last is on the disk
+	if (++req->done == req->count)
+		ata_finish(0);
+	else if (status & ATA_SR_DRQ)
+		pio_out(req->buf + req->done * ATA_SECTOR_SIZE);
+	else
+		ata_finish(-1);
+}
+
+/*
+ * ata_handler
+ *   DESCRIPTION:	Called by the ATA wrapper whenever IRQ 14 is raised.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	See ata_interrupt
+ */
+void ata_handler() {
+	ata_interrupt();
+	send_eoi(ATA_IRQ);
+}
+
+/*
+ * ata_poll
+ *   DESCRIPTION:	Runs the queue by polling until a request is finished, for
+ *					callers that cannot take interrupts, like mounting the
+ *					filesystem during boot. Call with interrupts off.
+ *   INPUTS: 		ata_request_t* req : request to wait for
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static void ata_poll(ata_request_t* req) {
+	uint32_t status;
+
+	while (!req->finished) {
+		status = inb(ATA_CTRL_PORT);
+		if (status & ATA_SR_BSY)
+			continue;
+		if (queue_head->dma && !(status & (ATA_SR_ERR | ATA_SR_DF))
+		   && !(inb(bm_base + BM_STATUS) & BM_ST_IRQ))
+			continue;
+		ata_interrupt();
+	}
+}
+
+/*
+ * ata_queue
+ *   DESCRIPTION:	Queues a transfer without waiting for it. The caller fills
+ *					in drive, lba, count, buf, write, callback and owner; the
+ *					request must stay put until it is finished. The bus master
+ *					is used when the buffer is in kernel memory, PIO otherwise.
+ *   INPUTS: 		ata_request_t* req : the request
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0 if it was queued, -1 for a bad request
+ *   SIDE EFFECTS: 	May start the disk
+ */
+int32_t ata_queue(ata_request_t* req) {
+	uint32_t flags;
+	uint32_t sectors = ata_sectors(req->drive);
+
+	if (sectors == 0 || req->buf == NULL || req->count == 0 || req->count > ATA_MAX_SECTORS
+	   || req->lba >= sectors || req->count > sectors - req->lba)
+		return -1;
+
+	req->next = NULL;
+	req->done = 0;
+	req->dma = bm_base && disk_dma[req->drive] && (uint32_t)req->buf >= ATA_DMA_START
+			   && (uint32_t)req->buf + req->count * ATA_SECTOR_SIZE <= ATA_DMA_END;
+	req->finished = 0;
+	req->status = -1;
+	init_wait_queue(&req->wait);
+
+	cli_and_save(flags);
+	if (queue_tail == NULL) {
+		queue_head = queue_tail = req;
+		ata_start(req);
+	} else {
+		queue_tail->next = req;
+		queue_tail = req;
+	}
+	restore_flags(flags);
+	return 0;
+}
+
+/*
+ * ata_wait
+ *   DESCRIPTION:	Waits for a queued request to finish. A process sleeps
+ *					until the interrupt finishes it; the sleep cannot be cut
+ *					short by a signal, since the request may live on its kernel
+ *					stack. Before the first process runs the kernel halts until
+ *					the interrupt instead, and with interrupts off it polls the
+ *					drive.
+ *   INPUTS: 		ata_request_t* req : a queued request
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	May sleep
+ */
+void ata_wait(ata_request_t* req) {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if (!(flags & EFLAGS_IF))
+		ata_poll(req);
+	else if (processes[current_pid])
+		while (!req->finished)
+			sleep_on_uninterruptible(&req->wait);
+	else
+		while (!req->finished)
+			asm volatile("sti; hlt; cli" ::: "memory");
+	restore_flags(flags);
+}
+
+/*
+ * ata_submit
+ *   DESCRIPTION:	Queues a transfer and waits for it.
+ *   INPUTS: 		uint32_t drive : ATA_MASTER or ATA_SLAVE
+ *					uint32_t lba, count : sectors to move
+ *					uint8_t* buf : buffer to move them to or from
+ *					uint8_t write : set to write the disk
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0 on success, -1 on a bad request or a disk error
+ *   SIDE EFFECTS: 	May sleep
+ */
+static int32_t ata_submit(uint32_t drive, uint32_t lba, uint32_t count, uint8_t* buf, uint8_t write) {
+	ata_request_t req;
+
+	req.drive = drive;
+	req.lba = lba;
+	req.count = count;
+	req.buf = buf;
+	req.write = write;
+	req.callback = NULL;
+	req.owner = NULL;
+	if (ata_queue(&req) != 0)
+		return -1;
+	ata_wait(&req);
+	return req.status;
+}
+
+/*
+ * ata_read
+ *   DESCRIPTION:	Reads whole sectors from the disk.
+ *   INPUTS: 		uint32_t drive : ATA_MASTER or ATA_SLAVE
+ *					uint32_t lba : first sector
+ *					uint32_t count : sectors, at most ATA_MAX_SECTORS
+ *   OUTPUTS:		void* buf : the data
+ *   RETURN VALUE: 	0 on success, -1 on failure
+ *   SIDE EFFECTS: 	May sleep
+ */
+int32_t ata_read(uint32_t drive, uint32_t lba, uint32_t count, void* buf) {
+	return ata_submit(drive, lba, count, buf, 0);
+}
+
+/*
+ * ata_write
+ *   DESCRIPTION:	Writes whole sectors to the disk.
+ *   INPUTS: 		uint32_t drive : ATA_MASTER or ATA_SLAVE
+ *					uint32_t lba : first sector
+ *					uint32_t count : sectors, at most ATA_MAX_SECTORS
+ *					const void* buf : the data
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0 on success, -1 on failure
+ *   SIDE EFFECTS: 	May sleep
+ */
+int32_t ata_write(uint32_t drive, uint32_t lba, uint32_t count, const void* buf) {
+	return ata_submit(drive, lba, count, (uint8_t*)buf, 1);
+}
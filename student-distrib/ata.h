@@ -0,0 +1,101 @@
+/* ata.h - IDE/ATA disk driver for the primary channel, PIO and bus master DMA
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _ATA_H
+#define _ATA_H
+
+#include "types.h"
+#include "lib.h"
+#include "i8259.h"
+#include "wait.h"
+
+#define ATA_IRQ				14			// primary channel, IRQ 6 of the slave PIC
+#define ATA_IO_PORT			0x1F0		// primary channel command block
+#define ATA_CTRL_PORT		0x3F6		// primary channel device control / alternate status
+#define ATA_SECTOR_SIZE		512
+#define ATA_MAX_SECTORS		128			// sectors in one request, 64kB
+#define ATA_DRIVES			2			// master and slave on the channel
+#define ATA_MASTER			0			// QEMU -hda, usually the boot disk
+#define ATA_SLAVE			1			// QEMU -hdb
+
+/* command block register offsets from ATA_IO_PORT */
+#define ATA_DATA			0			// 16 bit PIO data
+#define ATA_ERROR			1			// error register (read)
+#define ATA_COUNT			2			// sector count
+#define ATA_LBA_LOW			3			// LBA bits 0-7
+#define ATA_LBA_MID			4			// LBA bits 8-15
+#define ATA_LBA_HIGH		5			// LBA bits 16-23
+#define ATA_DRIVE			6			// drive select and LBA bits 24-27
+#define ATA_STATUS			7			// status (read), reading it acknowledges INTRQ
+#define ATA_COMMAND			7			// command (write)
+
+/* status bits */
+#define ATA_SR_ERR			0x01		// the command failed, see ATA_ERROR
+#define ATA_SR_DRQ			0x08		// ready to transfer a sector of PIO data
+#define ATA_SR_DF			0x20		// drive fault
+#define ATA_SR_BSY			0x80		// the other bits are not valid yet
+
+/* commands */
+#define ATA_CMD_READ_PIO	0x20
+#define ATA_CMD_WRITE_PIO	0x30
+#define ATA_CMD_READ_DMA	0xC8
+#define ATA_CMD_WRITE_DMA	0xCA
+#define ATA_CMD_IDENTIFY	0xEC
+
+#define ATA_DRIVE_CHS		0xA0		// CHS addressing, for IDENTIFY
+#define ATA_DRIVE_LBA		0xE0		// LBA addressing
+#define ATA_DRIVE_SLAVE		0x10		// selects the slave
+
+/* bus master IDE registers, offsets from BAR4 of the controller */
+#define BM_COMMAND			0			// bit 0 starts, bit 3 sets the direction
+#define BM_STATUS			2			// bits 1 and 2 are cleared by writing 1
+#define BM_PRD_TABLE		4			// physical address of the PRD table
+#define BM_CMD_START		0x01
+#define BM_CMD_TO_MEMORY	0x08		// the device writes memory, a disk read
+#define BM_ST_ERROR			0x02
+#define BM_ST_IRQ			0x04		// the device raised its interrupt
+#define PRD_LAST			0x8000		// flags the last entry of the table
+
+/* Kernel memory is identity mapped, so buffers in it can be handed to the
+ * bus master as they are. Anything else is moved with PIO. */
+#define ATA_DMA_START		0x400000
+#define ATA_DMA_END			0x800000
+
+struct ata_request_t;
+typedef void (*ata_callback_t)(struct ata_request_t* req);
+
+/* One transfer of whole sectors. Requests are queued in order and the
+ * head is the one the disk is working on. */
+typedef struct ata_request_t {
+	struct ata_request_t* next;			// next queued request
+	uint32_t drive;						// ATA_MASTER or ATA_SLAVE
+	uint32_t lba;						// first sector
+	uint32_t count;						// sectors, 1 to ATA_MAX_SECTORS
+	uint32_t done;						// sectors moved so far with PIO
+	uint8_t* buf;						// count * ATA_SECTOR_SIZE bytes
+	uint8_t write;						// set to write the disk
+	uint8_t dma;						// set when the bus master moves the data
+	volatile uint8_t finished;			// set by the interrupt handler
+	int32_t status;						// 0 on success, -1 on an error
+	wait_queue_t wait;					// the processes waiting for it
+	ata_callback_t callback;			// run when it finishes, with interrupts off
+	void* owner;						// for the callback
+} ata_request_t;
+
+/* Finds the disks on the primary channel and its bus master, enables IRQ 14. */
+int32_t init_ata();
+/* Number of sectors on a drive, 0 when there is no disk. */
+uint32_t ata_sectors(uint32_t drive);
+/* Queues a request filled in by the caller and returns at once. */
+int32_t ata_queue(ata_request_t* req);
+/* Waits until a queued request is finished. */
+void ata_wait(ata_request_t* req);
+/* Reads sectors into a buffer, sleeping until they arrive. */
+int32_t ata_read(uint32_t drive, uint32_t lba, uint32_t count, void* buf);
+/* Writes sectors from a buffer, sleeping until the disk has them. */
+int32_t ata_write(uint32_t drive, uint32_t lba, uint32_t count, const void* buf);
+/* Called by the ATA wrapper on IRQ 14. */
+void ata_handler();
+
+#endif /* _ATA_H */
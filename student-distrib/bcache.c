@@ -0,0 +1,330 @@
+/* bcache.c -- buffer cache of disk blocks with LRU eviction and read-ahead
+ * vim:ts=4 noexpandtab
+ */
+
+#include "bcache.h"
+
+static bcache_buf_t buffers[BCACHE_BUFFERS];
+static bcache_buf_t* hash_table[BCACHE_HASH_SIZE];
+static bcache_buf_t* lru_head;							// most recently used
+static bcache_buf_t* lru_tail;							// least recently used
+static bcache_stats_t stats;
+
+/*
+ * bcache_hash
+ *   DESCRIPTION:	Picks the hash bucket of a block.
+ *   INPUTS: 		uint32_t dev : ATA drive
+ *					uint32_t block : block number
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the bucket
+ *   SIDE EFFECTS: 	none
+ */
+static inline bcache_buf_t** bcache_hash(uint32_t dev, uint32_t block) {
+	return &hash_table[(block ^ (dev << 5)) & (BCACHE_HASH_SIZE - 1)];
+}
+
+/*
+ * lru_remove
+ *   DESCRIPTION:	Takes a buffer off the LRU list. Called with interrupts off.
+ *   INPUTS: 		bcache_buf_t* buf : buffer on the list
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static void lru_remove(bcache_buf_t* buf) {
+	if (buf->lru_prev)
+		buf->lru_prev->lru_next = buf->lru_next;
+	else
+		lru_head = buf->lru_next;
+	if (buf->lru_next)
+		buf->lru_next->lru_prev = buf->lru_prev;
+	else
+		lru_tail = buf->lru_prev;
+}
+
+/*
+ * lru_touch
+ *   DESCRIPTION:	Moves a buffer to the most recently used end of the list.
+ *					Called with interrupts off.
+ *   INPUTS: 		bcache_buf_t* buf : buffer on the list
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static void lru_touch(bcache_buf_t* buf) {
+	lru_remove(buf);
+	buf->lru_prev = NULL;
+	buf->lru_next = lru_head;
+	if (lru_head)
+		lru_head->lru_prev = buf;
+	else
+		lru_tail = buf;
+	lru_head = buf;
+}
+
+/*
+ * bcache_claim
+ *   DESCRIPTION:	Takes the least recently used buffer nobody holds and
+ *					renames it to another block. Its data is not valid yet.
+ *					Called with interrupts off.
+ *   INPUTS: 		uint32_t dev : ATA drive
+ *					uint32_t block : block number
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the buffer, NULL when every buffer is in use
+ *   SIDE EFFECTS: 	Evicts a block from the cache
+ */
+static bcache_buf_t* bcache_claim(uint32_t dev, uint32_t block) {
+	bcache_buf_t* buf;
+	bcache_buf_t** link;
+
+	for (buf = lru_tail; buf != NULL; buf = buf->lru_prev) {
+		if (buf->refs == 0 && !buf->busy && !buf->dirty)
+			break;
+	}
+	if (buf == NULL)
+		return NULL;
+
+	for (link = bcache_hash(buf->dev, buf->block); *link != NULL; link = &(*link)->hash_next) {
+		if (*link == buf) {
+			*link = buf->hash_next;
+			break;
+		}
+	}
+	buf->dev = dev;
+	buf->block = block;
+	buf->valid = 0;
+	buf->readahead = 0;
+	link = bcache_hash(dev, block);
+	buf->hash_next = *link;
+	*link = buf;
+	lru_touch(buf);
+	return buf;
+}
+
+/*
+ * bcache_read_done
+ *   DESCRIPTION:	ATA callback for a read into a buffer.
+ *   INPUTS: 		ata_request_t* req : the finished request
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static void bcache_read_done(ata_request_t* req) {
+	bcache_buf_t* buf = req->owner;
+
+	buf->valid = (req->status == 0);
+	buf->busy = 0;
+}
+
+/*
+ * bcache_fill
+ *   DESCRIPTION:	Starts reading a buffer's block from the disk. Called with
+ *					interrupts off, so that nobody sees the buffer not busy and
+ *					not valid in between.
+ *   INPUTS: 		bcache_buf_t* buf : a buffer that is not busy
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0 if the read was queued, -1 if not
+ *   SIDE EFFECTS: 	May start the disk
+ */
+static int32_t bcache_fill(bcache_buf_t* buf) {
+	buf->req.drive = buf->dev;
+	buf->req.lba = buf->block * BCACHE_SECTORS;
+	buf->req.count = BCACHE_SECTORS;
+	buf->req.buf = buf->data;
+	buf->req.write = 0;
+	buf->req.callback = bcache_read_done;
+	buf->req.owner = buf;
+	buf->busy = 1;
+	if (ata_queue(&buf->req) != 0) {
+		buf->busy = 0;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * init_bcache
+ *   DESCRIPTION:	Empties the cache and puts every buffer on the LRU list.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void init_bcache() {
+	int i;
+
+	for (i = 0; i < BCACHE_HASH_SIZE; i++)
+		hash_table[i] = NULL;
+	lru_head = lru_tail = NULL;
+	for (i = 0; i < BCACHE_BUFFERS; i++) {
+		buffers[i].dev = 0;
+		buffers[i].block = 0;
+		buffers[i].refs = 0;
+		buffers[i].busy = 0;
+		buffers[i].valid = 0;
+		buffers[i].dirty = 0;
+		buffers[i].readahead = 0;
+		buffers[i].hash_next = NULL;
+		buffers[i].lru_prev = lru_tail;
+		buffers[i].lru_next = NULL;
+		if (lru_tail)
+			lru_tail->lru_next = &buffers[i];
+		else
+			lru_head = &buffers[i];
+		lru_tail = &buffers[i];
+	}
+	memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * bcache_lookup
+ *   DESCRIPTION:	Finds the buffer of a block. No reference is taken, so the
+ *					caller must already hold the buffer or have interrupts off.
+ *   INPUTS: 		uint32_t dev : ATA drive
+ *					uint32_t block : block number
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the buffer, NULL if the block is not cached
+ *   SIDE EFFECTS: 	none
+ */
+bcache_buf_t* bcache_lookup(uint32_t dev, uint32_t block) {
+	bcache_buf_t* buf;
+
+	for (buf = *bcache_hash(dev, block); buf != NULL; buf = buf->hash_next) {
+		if (buf->dev == dev && buf->block == block)
+			return buf;
+	}
+	return NULL;
+}
+
+/*
+ * bread
+ *   DESCRIPTION:	Gets a block with a reference held on its buffer. A block
+ *					that is cached, or being read ahead, is a hit; otherwise the
+ *					least recently used free buffer is read from the disk.
+ *					Either way this waits until the data is there.
+ *   INPUTS: 		uint32_t dev : ATA drive
+ *					uint32_t block : block number
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the buffer, NULL on a disk error or with every buffer held
+ *   SIDE EFFECTS: 	May sleep
+ */
+bcache_buf_t* bread(uint32_t dev, uint32_t block) {
+	bcache_buf_t* buf;
+	uint32_t flags;
+
+	cli_and_save(flags);
+	buf = bcache_lookup(dev, block);
+	if (buf != NULL && (buf->valid || buf->busy)) {
+		stats.hits++;
+		if (buf->readahead) {
+			stats.readahead_hits++;
+			buf->readahead = 0;
+		}
+	} else {
+		stats.misses++;
+		if (buf == NULL && (buf = bcache_claim(dev, block)) == NULL) {
+			restore_flags(flags);
+			return NULL;
+		}
+		bcache_fill(buf);
+	}
+	buf->refs++;
+	lru_touch(buf);
+	restore_flags(flags);
+
+	while (buf->busy)
+		ata_wait(&buf->req);
+	if (!buf->valid) {
+		brelse(buf);
+		return NULL;
+	}
+	return buf;
+}
+
+/*
+ * bwrite
+ *   DESCRIPTION:	Writes a buffer to the disk and waits for it. The cache
+ *					does not write behind, so a buffer changed by its holder is
+ *					written with this before it is released.
+ *   INPUTS: 		bcache_buf_t* buf : buffer from bread
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0 on success, -1 on a disk error
+ *   SIDE EFFECTS: 	May sleep
+ */
+int32_t bwrite(bcache_buf_t* buf) {
+	buf->req.drive = buf->dev;
+	buf->req.lba = buf->block * BCACHE_SECTORS;
+	buf->req.count = BCACHE_SECTORS;
+	buf->req.buf = buf->data;
+	buf->req.write = 1;
+	buf->req.callback = NULL;
+	buf->req.owner = buf;
+	if (ata_queue(&buf->req) != 0)
+		return -1;
+	ata_wait(&buf->req);
+	stats.writes++;
+	if (buf->req.status != 0)
+		return -1;
+	buf->dirty = 0;
+	return 0;
+}
+
+/*
+ * brelse
+ *   DESCRIPTION:	Drops a reference taken by bread. The buffer stays cached
+ *					until it is the least recently used one and is needed.
+ *   INPUTS: 		bcache_buf_t* buf : buffer from bread
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void brelse(bcache_buf_t* buf) {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if (buf->refs > 0)
+		buf->refs--;
+	restore_flags(flags);
+}
+
+/*
+ * bcache_prefetch
+ *   DESCRIPTION:	Starts reading a block that is not cached and returns
+ *					without waiting. The disk works on it while the caller
+ *					copies what it already has; a later bread finds it.
+ *					Nothing happens when every buffer is in use.
+ *   INPUTS: 		uint32_t dev : ATA drive
+ *					uint32_t block : block number
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	May start the disk, evicts a block from the cache
+ */
+void bcache_prefetch(uint32_t dev, uint32_t block) {
+	bcache_buf_t* buf;
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if (bcache_lookup(dev, block) == NULL && (buf = bcache_claim(dev, block)) != NULL) {
+		if (bcache_fill(buf) == 0) {
+			buf->readahead = 1;
+			stats.readaheads++;
+		}
+	}
+	restore_flags(flags);
+}
+
+/*
+ * bcache_read_stats
+ *   DESCRIPTION:	Copies the hit, miss, read-ahead and write counters.
+ *   INPUTS: 		none
+ *   OUTPUTS:		bcache_stats_t* out : the counters
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void bcache_read_stats(bcache_stats_t* out) {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	*out = stats;
+	restore_flags(flags);
+}
@@ -0,0 +1,59 @@
+/* bcache.h - Buffer cache of disk blocks with LRU eviction and read-ahead
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _BCACHE_H
+#define _BCACHE_H
+
+#include "types.h"
+#include "ata.h"
+
+#define BCACHE_BLOCK_SIZE	4096						// one filesystem block
+#define BCACHE_SECTORS		(BCACHE_BLOCK_SIZE / ATA_SECTOR_SIZE)
+#define BCACHE_BUFFERS		64							// 256kB of blocks
+#define BCACHE_HASH_SIZE	64							// must be a power of two
+
+/* A disk block in memory. A buffer is held while its refs are not zero,
+ * and is busy while a transfer into it is running; it is only reused
+ * for another block when neither. Data is first so that a pointer to it
+ * is a pointer to the buffer. */
+typedef struct bcache_buf_t {
+	uint8_t data[BCACHE_BLOCK_SIZE];
+	uint32_t dev;										// ATA drive
+	uint32_t block;										// block number on it
+	uint32_t refs;										// bread calls not released yet
+	volatile uint8_t busy;								// a read into it is running
+	uint8_t valid;										// data holds the block
+	uint8_t dirty;										// changed since it was last written
+	uint8_t readahead;									// read ahead and not used since
+	struct bcache_buf_t* hash_next;						// next buffer in the same bucket
+	struct bcache_buf_t* lru_prev;						// more recently used
+	struct bcache_buf_t* lru_next;						// less recently used
+	ata_request_t req;									// the transfer into it
+} bcache_buf_t;
+
+/* Counters since boot, read by the bcache_stats system call. */
+typedef struct bcache_stats_t {
+	uint32_t hits;										// bread found the block
+	uint32_t misses;									// bread had to read it
+	uint32_t readaheads;								// blocks read ahead
+	uint32_t readahead_hits;							// of those, blocks bread used
+	uint32_t writes;									// blocks written
+} bcache_stats_t;
+
+/* Empties the cache. */
+void init_bcache();
+/* Gets a block, reading it if it is not cached, NULL on a disk error. */
+bcache_buf_t* bread(uint32_t dev, uint32_t block);
+/* Finds a cached block without taking a reference, NULL if not cached. */
+bcache_buf_t* bcache_lookup(uint32_t dev, uint32_t block);
+/* Writes a held buffer to the disk now. */
+int32_t bwrite(bcache_buf_t* buf);
+/* Gives back a buffer from bread. */
+void brelse(bcache_buf_t* buf);
+/* Starts reading a block into the cache without waiting for it. */
+void bcache_prefetch(uint32_t dev, uint32_t block);
+/* Copies the counters. */
+void bcache_read_stats(bcache_stats_t* stats);
+
+#endif /* _BCACHE_H */
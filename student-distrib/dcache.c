@@ -0,0 +1,119 @@
+/* dcache.c -- cache of resolved filesystem paths
+ * vim:ts=4 noexpandtab
+ */
+
+#include "dcache.h"
+#include "lib.h"
+
+#define FNV_OFFSET		2166136261U
+#define FNV_PRIME		16777619U
+
+static dcache_entry_t entries[DCACHE_ENTRIES];
+static dcache_entry_t* hash_table[DCACHE_HASH_SIZE];
+/* Next entry to reuse once they are all taken. */
+static uint32_t dcache_hand;
+
+/*
+ * dcache_hash
+ *   DESCRIPTION:	Hashes a path with FNV-1a.
+ *   INPUTS: 		const uint8_t* path : the path
+ *					uint32_t len : its length
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the hash
+ *   SIDE EFFECTS: 	none
+ */
+static uint32_t dcache_hash(const uint8_t* path, uint32_t len) {
+	uint32_t hash = FNV_OFFSET;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= path[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+/*
+ * init_dcache
+ *   DESCRIPTION:	Forgets every path.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void init_dcache() {
+	int i;
+
+	for (i = 0; i < DCACHE_HASH_SIZE; i++)
+		hash_table[i] = NULL;
+	for (i = 0; i < DCACHE_ENTRIES; i++) {
+		entries[i].len = 0;
+		entries[i].hash_next = NULL;
+	}
+	dcache_hand = 0;
+}
+
+/*
+ * dcache_lookup
+ *   DESCRIPTION:	Finds a path with one hash probe. Called with the
+ *					filesystem lock held.
+ *   INPUTS: 		const uint8_t* path : the path, without leading slashes
+ *					uint32_t len : its length
+ *   OUTPUTS:		dentry_t* dentry : what the path resolved to
+ *   RETURN VALUE: 	0 if the path is cached, -1 if not
+ *   SIDE EFFECTS: 	none
+ */
+int32_t dcache_lookup(const uint8_t* path, uint32_t len, dentry_t* dentry) {
+	dcache_entry_t* entry;
+	uint32_t hash;
+
+	if (len == 0 || len > DCACHE_PATH_LEN)
+		return -1;
+	hash = dcache_hash(path, len);
+	for (entry = hash_table[hash & (DCACHE_HASH_SIZE - 1)]; entry != NULL; entry = entry->hash_next) {
+		if (entry->hash == hash && entry->len == len && memcmp(entry->path, path, len) == 0) {
+			*dentry = entry->dentry;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * dcache_insert
+ *   DESCRIPTION:	Remembers a resolved path, in a free entry or else in the
+ *					next one round the pool. Called with the filesystem lock
+ *					held. Names are never removed from a directory, so an
+ *					entry does not go stale.
+ *   INPUTS: 		const uint8_t* path : the path, without leading slashes
+ *					uint32_t len : its length
+ *					const dentry_t* dentry : what it resolved to
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	May evict another path
+ */
+void dcache_insert(const uint8_t* path, uint32_t len, const dentry_t* dentry) {
+	dcache_entry_t* entry;
+	dcache_entry_t** link;
+	dentry_t cached;
+
+	if (len == 0 || len > DCACHE_PATH_LEN || dcache_lookup(path, len, &cached) == 0)
+		return;
+	entry = &entries[dcache_hand];
+	dcache_hand = (dcache_hand + 1) % DCACHE_ENTRIES;
+	if (entry->len != 0) {
+		for (link = &hash_table[entry->hash & (DCACHE_HASH_SIZE - 1)]; *link != NULL; link = &(*link)->hash_next) {
+			if (*link == entry) {
+				*link = entry->hash_next;
+				break;
+			}
+		}
+	}
+	entry->hash = dcache_hash(path, len);
+	entry->len = len;
+	memcpy(entry->path, path, len);
+	entry->dentry = *dentry;
+	link = &hash_table[entry->hash & (DCACHE_HASH_SIZE - 1)];
+	entry->hash_next = *link;
+	*link = entry;
+}
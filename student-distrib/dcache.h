@@ -0,0 +1,32 @@
+/* dcache.h - Cache of resolved filesystem paths
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _DCACHE_H
+#define _DCACHE_H
+
+#include "types.h"
+#include "fs.h"
+
+#define DCACHE_ENTRIES		64
+#define DCACHE_HASH_SIZE	64							// must be a power of two
+#define DCACHE_PATH_LEN		128							// longer paths are not cached
+
+/* A path that was resolved, as given without its leading slashes, and the
+ * dentry it leads to. */
+typedef struct dcache_entry_t {
+	uint32_t hash;
+	uint32_t len;										// 0 when the entry is free
+	uint8_t path[DCACHE_PATH_LEN];
+	dentry_t dentry;
+	struct dcache_entry_t* hash_next;					// next entry in the same bucket
+} dcache_entry_t;
+
+/* Empties the cache, call when a filesystem is mounted. */
+void init_dcache();
+/* Finds a path, 0 and fills in the dentry if it is cached, -1 if not. */
+int32_t dcache_lookup(const uint8_t* path, uint32_t len, dentry_t* dentry);
+/* Remembers what a path resolved to. */
+void dcache_insert(const uint8_t* path, uint32_t len, const dentry_t* dentry);
+
+#endif /* _DCACHE_H */
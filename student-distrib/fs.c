@@ -1,28 +1,662 @@
-/* fs.c -- read-only 391 filesystem driver
+/* fs.c -- 391 filesystem driver, on the disk or in a module with a writable overlay
  * vim:ts=4 noexpandtab
  */
 
 #include "fs.h"
 #include "lib.h" //strcmp
+#include "ata.h"
+#include "bcache.h"
+#include "dcache.h"
+#include "uaccess.h"
+#include "lz4.h"
+
+/* Blocks are numbered through the whole image: 0 is the boot block, the
+ * inodes follow, then the data blocks. Extent inodes are packed several to
+ * a block. Data blocks allocated since boot continue the numbering past
+ * the end of the image. */
+#define INODE_BLOCK(i)	(1 + (fs_extents ? (i) / FS_EXTENT_INODES_PER_BLOCK : (i)))
+#define DATA_BLOCK(d)	(1 + inode_blocks + (d))
+#define BITS_PER_WORD	32
+#define MAX_FILE_BLOCKS	1023					// data_index entries in an inode
+#define SECTORS_PER_BLOCK	(FS_BLOCK_SIZE / ATA_SECTOR_SIZE)
+#define FS_READAHEAD	4						// file blocks read ahead of a sequential read
+#define FS_ZCACHE_BLOCKS	8					// decompressed file blocks kept, 32kB
+#define FS_MAX_DEPTH	16						// directories deep that init_fs looks
+#define FS_MAX_INODES	FS_MAX_BLOCKS			// inodes init_fs checks, the others cannot be read
+
+/* inode_flags bits */
+#define INODE_VALID		0x1						// every data block is in the filesystem
+#define INODE_CONTIGUOUS	0x2					// the data blocks follow each other, none in the overlay
+
+/* Set when the filesystem is on a disk rather than in the module. */
+static int fs_on_disk = 0;
+/* The ATA drive it is on. */
+static uint32_t fs_drive;
+/* Set for the extent format. */
+static int fs_extents = 0;
+/* Blocks the inodes take. */
+static uint32_t inode_blocks;
+/* Where the last read_data stopped, to tell sequential reads. */
+static uint32_t last_read_inode;
+static uint32_t last_read_end;
+/* Decompressed blocks of compressed files, each tagged with its inode + 1
+ * (0 when free) and its block in the file, reused round robin. Compressed
+ * files are never written, so a block stays good until the next mount. */
+static data_block_t zcache[FS_ZCACHE_BLOCKS];
+static uint32_t zcache_inode[FS_ZCACHE_BLOCKS];
+static uint32_t zcache_index[FS_ZCACHE_BLOCKS];
+static uint32_t zcache_hand;
+/* A compressed block as read, before it is decompressed. */
+static uint8_t zcache_input[FS_BLOCK_SIZE];
+
+/* Taken around every operation, so that one may sleep for the disk. */
+static volatile int fs_busy = 0;
+/* Process holding the lock and how many times it took it. */
+static int fs_owner;
+static uint32_t fs_depth;
+static wait_queue_t fs_wait;
+
+/* Where each block is kept once written: slot + 1 in overlay, 0 while the
+ * image still holds it. The image itself is never written. */
+static uint16_t block_remap[FS_MAX_BLOCKS];
+/* Copies of written blocks and new blocks. */
+static data_block_t overlay[FS_OVERLAY_BLOCKS];
+/* One bit per overlay slot in use. */
+static uint32_t overlay_used[FS_OVERLAY_BLOCKS / BITS_PER_WORD];
+/* One bit per data block that belongs to a file. */
+static uint32_t data_block_used[FS_MAX_BLOCKS / BITS_PER_WORD];
+/* One bit per inode that belongs to a file. */
+static uint32_t inode_used[FS_MAX_BLOCKS / BITS_PER_WORD];
+/* Number of data block indices, in the image and past it. */
+static uint32_t data_block_limit;
+/* What scan_inode found for each inode, so that a read need not look
+ * through the inode first: INODE_* bits, and the data blocks it takes. */
+static uint8_t inode_flags[FS_MAX_INODES];
+static uint32_t file_blocks[FS_MAX_INODES];
+/* Cleared when the image is too large for the bitmaps to track. */
+static int fs_writable;
+
+/* test_bit
+ * Inputs: map -- bitmap, bit -- bit number
+ * Returns: nonzero if the bit is set */
+static inline int test_bit(const uint32_t* map, uint32_t bit) {
+	return map[bit / BITS_PER_WORD] & (1 << (bit % BITS_PER_WORD));
+}
+
+/* set_bit
+ * Inputs: map -- bitmap, bit -- bit number
+ * Side effects: sets the bit */
+static inline void set_bit(uint32_t* map, uint32_t bit) {
+	map[bit / BITS_PER_WORD] |= 1 << (bit % BITS_PER_WORD);
+}
+
+/* clear_bit
+ * Inputs: map -- bitmap, bit -- bit number
+ * Side effects: clears the bit */
+static inline void clear_bit(uint32_t* map, uint32_t bit) {
+	map[bit / BITS_PER_WORD] &= ~(1 << (bit % BITS_PER_WORD));
+}
+
+/* fs_lock
+ *
+ * Takes the filesystem lock, sleeping while another process holds it. The
+ * holder may take it again, so the exported functions can call each other.
+ *
+ * Inputs: None
+ * Returns: None
+ * Side effects: may sleep
+ */
+void fs_lock() {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	while (fs_busy && fs_owner != current_pid)
+		sleep_on_uninterruptible(&fs_wait);
+	fs_busy = 1;
+	fs_owner = current_pid;
+	fs_depth++;
+	restore_flags(flags);
+}
+
+/* fs_unlock
+ *
+ * Gives back one fs_lock, waking the processes waiting for the lock once
+ * the holder has given back all of them.
+ *
+ * Inputs: None
+ * Returns: None
+ * Side effects: None
+ */
+void fs_unlock() {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if (--fs_depth == 0) {
+		fs_busy = 0;
+		wake_up(&fs_wait);
+	}
+	restore_flags(flags);
+}
+
+/* fs_block
+ *
+ * Finds the current contents of a block. On the disk it comes from the
+ * block cache, read if it is not there; in the module it is the overlay copy
+ * if the block has been written, else the image's. Every call must be
+ * matched by fs_put_block.
+ *
+ * Inputs: block -- block number
+ * Returns: pointer to the block, NULL if it could not be read
+ * Side effects: may read the disk
+ */
+static uint8_t* fs_block(uint32_t block) {
+	bcache_buf_t* buf;
+
+	if (!fs_on_disk) {
+		if (block_remap[block])
+			return overlay[block_remap[block] - 1].data;
+		return (uint8_t*)boot_block + block * FS_BLOCK_SIZE;
+	}
+
+	if ((buf = bread(fs_drive, block)) == NULL)
+		return NULL;
+	return buf->data;
+}
+
+/* fs_put_block
+ *
+ * Gives back a block from fs_block or fs_block_writable. A block written on
+ * the disk goes back to it now.
+ *
+ * Inputs: block -- block number
+ * Returns: 0 on success, -1 if the block could not be written
+ * Side effects: may write the disk
+ */
+static int32_t fs_put_block(uint32_t block) {
+	bcache_buf_t* buf;
+	int32_t ret = 0;
+
+	if (!fs_on_disk || (buf = bcache_lookup(fs_drive, block)) == NULL || buf->refs == 0)
+		return 0;
+	if (buf->dirty)
+		ret = bwrite(buf);
+	brelse(buf);
+	return ret;
+}
+
+/* fs_block_writable
+ *
+ * Gets a block to change it. On the disk this is its buffer, written back
+ * when it is put. In the module a block gets an overlay copy the first time
+ * it is written: blocks of the image are copied, new blocks past its end
+ * start out zeroed, and pointers from fs_block to it go stale.
+ *
+ * Inputs: block -- block number
+ * Returns: pointer to the writable block, NULL if it could not be read or
+ *          the overlay is full
+ * Side effects: may take an overlay slot
+ */
+static uint8_t* fs_block_writable(uint32_t block) {
+	uint8_t* data;
+	uint32_t slot;
+
+	if (fs_on_disk) {
+		if ((data = fs_block(block)) != NULL)
+			((bcache_buf_t*)data)->dirty = 1;
+		return data;
+	}
+
+	if (block_remap[block])
+		return overlay[block_remap[block] - 1].data;
+	for (slot = 0; slot < FS_OVERLAY_BLOCKS && test_bit(overlay_used, slot); slot++);
+	if (slot == FS_OVERLAY_BLOCKS)
+		return NULL;
+	set_bit(overlay_used, slot);
+	if (block < DATA_BLOCK(boot_block->num_data_blocks))
+		memcpy(overlay[slot].data, fs_block(block), FS_BLOCK_SIZE);
+	else
+		memset(overlay[slot].data, 0, FS_BLOCK_SIZE);
+	block_remap[block] = slot + 1;
+	return overlay[slot].data;
+}
+
+/* get_inode
+ * Inputs: inode -- inode index, already checked
+ * Returns: the current contents of the inode, only to be read, NULL if it
+ *          could not be read; put it back with fs_put_block. In the extent
+ *          format it is an extent_inode_t, which also starts with the length */
+static inode_block_t* get_inode(uint32_t inode) {
+	uint8_t* block = fs_block(INODE_BLOCK(inode));
+
+	if (block == NULL || !fs_extents)
+		return (inode_block_t*)block;
+	return (inode_block_t*)(block + inode % FS_EXTENT_INODES_PER_BLOCK * sizeof(extent_inode_t));
+}
+
+/* is_compressed
+ * Inputs: node -- inode from get_inode
+ * Returns: nonzero if the file's data blocks hold it compressed */
+static inline int is_compressed(inode_block_t* node) {
+	return fs_extents && (((extent_inode_t*)node)->flags & FS_INODE_COMPRESSED);
+}
+
+/* stored_length
+ * Inputs: node -- inode from get_inode
+ * Returns: the bytes of data blocks the file takes, which for a compressed
+ *          file is less than its length */
+static uint32_t stored_length(inode_block_t* node) {
+	return is_compressed(node) ? ((extent_inode_t*)node)->stored_length : node->length;
+}
+
+/* data_blocks_ok
+ * Inputs: start -- first data block of a run
+ *         count -- number of blocks in the run
+ * Returns: nonzero if every block of the run can be read: on the disk if it
+ *          has room for the block, in the module if the image or the overlay
+ *          holds it */
+static int data_blocks_ok(uint32_t start, uint32_t count) {
+	uint32_t d;
+
+	if (start >= data_block_limit || count > data_block_limit - start)
+		return 0;
+	if (fs_on_disk || start + count <= boot_block->num_data_blocks)
+		return 1;
+	// past the image only blocks written since boot exist
+	for (d = start; d < start + count; d++) {
+		if (d >= boot_block->num_data_blocks && !block_remap[DATA_BLOCK(d)])
+			return 0;
+	}
+	return 1;
+}
+
+/* scan_inode
+ *
+ * Checks that every data block of a file is in the filesystem and counts
+ * them, and finds whether they follow each other in the image, so that a
+ * read can take them as one run. A block in the overlay breaks the run.
+ * Called for every inode by init_fs, and again whenever a file's blocks
+ * change.
+ *
+ * Inputs: inode -- inode index, below num_inodes and FS_MAX_INODES
+ * Returns: None
+ * Side effects: sets inode_flags and file_blocks for the inode
+ */
+static void scan_inode(uint32_t inode) {
+	inode_block_t* node;
+	extent_inode_t* ext;
+	uint32_t blocks, i, d, covered = 0;
+	int contiguous = 1;
+
+	inode_flags[inode] = 0;
+	file_blocks[inode] = 0;
+	if ((node = get_inode(inode)) == NULL)
+		return;
+	ext = (extent_inode_t*)node;
+	blocks = (stored_length(node) + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+	if (!fs_extents) {
+		if (blocks > MAX_FILE_BLOCKS)
+			goto out;
+		for (i = 0; i < blocks; i++) {
+			d = node->data_index[i];
+			if (!data_blocks_ok(d, 1))
+				goto out;
+			// only a writable module has blocks in the overlay
+			if ((i > 0 && d != node->data_index[i - 1] + 1)
+			   || (fs_writable && !fs_on_disk && block_remap[DATA_BLOCK(d)]))
+				contiguous = 0;
+		}
+	} else {
+		if (ext->num_extents > FS_INODE_EXTENTS)
+			goto out;
+		for (i = 0; i < ext->num_extents; i++) {
+			if (!data_blocks_ok(ext->extents[i].start, ext->extents[i].count))
+				goto out;
+			covered += ext->extents[i].count;
+		}
+		if (covered < blocks)
+			goto out;
+		contiguous = blocks == 0 || ext->extents[0].count >= blocks;
+	}
+	inode_flags[inode] = INODE_VALID | (contiguous ? INODE_CONTIGUOUS : 0);
+	file_blocks[inode] = blocks;
+
+out:
+	fs_put_block(INODE_BLOCK(inode));
+}
+
+/* inode_ok
+ * Inputs: inode -- inode index
+ * Returns: nonzero if the inode is in the filesystem and scan_inode found
+ *          all of its data blocks in it */
+static inline int inode_ok(uint32_t inode) {
+	return inode < boot_block->num_inodes && inode < FS_MAX_INODES && (inode_flags[inode] & INODE_VALID);
+}
+
+/* file_block
+ * Inputs: inode -- the index of the inode, checked with inode_ok
+ *         node -- inode from get_inode
+ *         index -- block of the file, below its length
+ *         run -- set to the number of blocks from this one on that follow
+ *                each other, 1 for a fragmented file in the indexed format
+ * Returns: the data block index of the file's block */
+static uint32_t file_block(uint32_t inode, inode_block_t* node, uint32_t index, uint32_t* run) {
+	extent_inode_t* ext = (extent_inode_t*)node;
+	uint32_t i;
+
+	if (inode_flags[inode] & INODE_CONTIGUOUS) {
+		*run = file_blocks[inode] - index;
+		return (fs_extents ? ext->extents[0].start : node->data_index[0]) + index;
+	}
+	*run = 1;
+	if (!fs_extents)
+		return node->data_index[index];
+	for (i = 0; index >= ext->extents[i].count; i++)
+		index -= ext->extents[i].count;
+	*run = ext->extents[i].count - index;
+	return ext->extents[i].start + index;
+}
+
+/* fs_prefetch
+ *
+ * Starts reading the blocks of a file that follow one being read, so that
+ * the disk fetches them while this one is copied. File blocks need not be
+ * next to each other on the disk, so they are found through the inode.
+ *
+ * Inputs: inode -- the index of the inode, checked with inode_ok
+ *         node -- the file's inode, held
+ *         index -- block of the file being read
+ * Returns: none
+ * Side effects: may start the disk
+ */
+static void fs_prefetch(uint32_t inode, inode_block_t* node, uint32_t index) {
+	uint32_t i, run;
+
+	for (i = index + 1; i <= index + FS_READAHEAD && i < file_blocks[inode]; i++)
+		bcache_prefetch(fs_drive, DATA_BLOCK(file_block(inode, node, i, &run)));
+}
+
+/* get_dentry
+ * Inputs: index -- dentry index, already checked
+ * Returns: the current contents of the dentry, only to be read. The boot
+ *          block is always in memory, so there is nothing to put back */
+static dentry_t* get_dentry(uint32_t index) {
+	uint8_t* boot = fs_on_disk ? (uint8_t*)boot_block : fs_block(0);
+
+	return (dentry_t*)(boot + FS_METADATA_SEGMENT_SIZE) + index;
+}
+
+/* alloc_data_block
+ *
+ * Takes a free data block and zeroes it.
+ *
+ * Inputs: None
+ * Returns: the data block index, -1 if there is no free block or overlay
+ *          slot, or the disk failed
+ * Side effects: marks the block used
+ */
+static int32_t alloc_data_block() {
+	uint32_t d;
+	uint8_t* data;
+
+	for (d = 0; d < data_block_limit && test_bit(data_block_used, d); d++);
+	if (d == data_block_limit || (data = fs_block_writable(DATA_BLOCK(d))) == NULL)
+		return -1;
+	memset(data, 0, FS_BLOCK_SIZE);
+	if (fs_put_block(DATA_BLOCK(d)) != 0)
+		return -1;
+	// the disk's boot block counts every data block a file may use, so the
+	// image on it stays whole
+	if (fs_on_disk && d >= boot_block->num_data_blocks) {
+		fs_block_writable(0);
+		boot_block->num_data_blocks = d + 1;
+		if (fs_put_block(0) != 0)
+			return -1;
+	}
+	set_bit(data_block_used, d);
+	return d;
+}
+
+/* free_data_block
+ *
+ * Gives a data block back, and its overlay slot if it has one.
+ *
+ * Inputs: d -- data block index
+ * Returns: None
+ * Side effects: marks the block free
+ */
+static void free_data_block(uint32_t d) {
+	uint32_t block = DATA_BLOCK(d);
+
+	clear_bit(data_block_used, d);
+	if (!fs_on_disk && block_remap[block]) {
+		clear_bit(overlay_used, block_remap[block] - 1);
+		block_remap[block] = 0;
+	}
+}
+
+/* dir_entry
+ * Inputs: dir -- inode of a directory, FS_ROOT_INODE for the root
+ *         index -- entry of the directory
+ *         dentry -- filled in with the entry
+ * Returns: 0 for success, -1 past the end of the directory or if it could
+ *          not be read. Call with the lock held */
+static int32_t dir_entry(uint32_t dir, uint32_t index, dentry_t* dentry) {
+	if (dir == FS_ROOT_INODE) {
+		if (index >= MAX_NUM_DENTRIES)
+			return -1;
+		*dentry = *get_dentry(index);
+		return 0;
+	}
+	if (read_data(dir, index * sizeof(dentry_t), (uint8_t*)dentry, sizeof(dentry_t)) != sizeof(dentry_t))
+		return -1;
+	return 0;
+}
+
+/* dir_lookup
+ * Inputs: dir -- inode of a directory
+ *         name -- name to find, not NUL terminated; only the first 32
+ *                 characters of a longer one are compared
+ *         len -- its length, not 0
+ *         dentry -- filled in with the entry found
+ * Returns: 0 for success, -1 if there is no such entry. Call with the lock
+ *          held */
+static int32_t dir_lookup(uint32_t dir, const uint8_t* name, uint32_t len, dentry_t* dentry) {
+	uint32_t i;
+	uint32_t n = (len < FS_FILE_NAME_LEN) ? len : FS_FILE_NAME_LEN;
+
+	for (i = 0; dir_entry(dir, i, dentry) == 0; i++) {
+		if (strncmp((const int8_t*)name, dentry->file_name, n) == 0
+		   && (n == FS_FILE_NAME_LEN || dentry->file_name[n] == '\0'))
+			return 0;
+	}
+	return -1;
+}
+
+/* resolve_path
+ *
+ * Follows a path from the root. Every prefix that resolves is put in the
+ * dentry cache, so a path used before costs one hash probe, and one that
+ * shares its directories with it a probe per directory and one scan.
+ *
+ * Inputs: path -- names separated by slashes, leading slashes ignored
+ *         len -- length of the path
+ *         dentry -- filled in with the dentry the path leads to, "." for
+ *                   the root itself
+ * Returns: 0 for success, -1 if a name is missing or is not a directory.
+ *          Call with the lock held
+ */
+static int32_t resolve_path(const uint8_t* path, uint32_t len, dentry_t* dentry) {
+	const uint8_t* end = path + len;
+	const uint8_t* name; // start of the current name
+	const uint8_t* next; // end of the current name
+	uint32_t dir = FS_ROOT_INODE;
+
+	while (path < end && *path == '/')
+		path++;
+	if (path == end) {
+		*dentry = *get_dentry(0);
+		return 0;
+	}
+	if (dcache_lookup(path, end - path, dentry) == 0)
+		return 0;
+	for (name = path; ; name = next) {
+		for (next = name; next < end && *next != '/'; next++);
+		if (dcache_lookup(path, next - path, dentry) != 0) {
+			if (dir_lookup(dir, name, next - name, dentry) != 0)
+				return -1;
+			dcache_insert(path, next - path, dentry);
+		}
+		while (next < end && *next == '/')
+			next++;
+		if (next == end)
+			return 0;
+		if (dentry->file_type != FS_TYPE_DIR)
+			return -1;
+		dir = dentry->inode_index;
+	}
+}
+
+/* mark_used
+ *
+ * Marks the inodes and data blocks the files and directories in a
+ * directory use, and those in its subdirectories.
+ *
+ * Inputs: dir -- inode of the directory
+ *         depth -- directories above it
+ * Returns: None
+ * Side effects: sets bits of inode_used and data_block_used
+ */
+static void mark_used(uint32_t dir, uint32_t depth) {
+	dentry_t entry;
+	inode_block_t* node;
+	uint32_t i, b;
+
+	for (i = 0; dir_entry(dir, i, &entry) == 0; i++) {
+		if (entry.file_name[0] == '\0' || entry.inode_index >= boot_block->num_inodes
+		   || (entry.file_type != FS_TYPE_FILE && entry.file_type != FS_TYPE_DIR)
+		   || test_bit(inode_used, entry.inode_index))
+			continue;
+		set_bit(inode_used, entry.inode_index);
+		if (!inode_ok(entry.inode_index) || (node = get_inode(entry.inode_index)) == NULL)
+			continue;
+		for (b = 0; b < file_blocks[entry.inode_index]; b++)
+			set_bit(data_block_used, node->data_index[b]);
+		fs_put_block(INODE_BLOCK(entry.inode_index));
+		if (entry.file_type == FS_TYPE_DIR && depth < FS_MAX_DEPTH)
+			mark_used(entry.inode_index, depth + 1);
+	}
+}
+
+/* count_inode_blocks
+ * Inputs: boot -- a boot block
+ * Returns: the number of blocks its inodes take */
+static uint32_t count_inode_blocks(boot_block_t* boot) {
+	if (boot->format == FS_FORMAT_EXTENTS)
+		return (boot->num_inodes + FS_EXTENT_INODES_PER_BLOCK - 1) / FS_EXTENT_INODES_PER_BLOCK;
+	return boot->num_inodes;
+}
+
+/* mount_disk
+ *
+ * Reads the boot block from a disk and checks that it starts with the root
+ * directory and that the filesystem it describes fits on the disk, so that
+ * a boot disk is not taken for one. The boot block stays held in the cache.
+ *
+ * Inputs: drive -- ATA_MASTER or ATA_SLAVE
+ * Returns: 0 if the disk holds a filesystem, -1 if not
+ * Side effects: points boot_block and dentries at the boot block's buffer
+ */
+static int32_t mount_disk(uint32_t drive) {
+	boot_block_t* boot;
+	dentry_t* root;
+	uint32_t disk_blocks = ata_sectors(drive) / SECTORS_PER_BLOCK;
+	uint32_t blocks; // blocks the inodes take
+
+	if (disk_blocks == 0)
+		return -1;
+	fs_on_disk = 1;
+	fs_drive = drive;
+	if ((boot = (boot_block_t*)fs_block(0)) == NULL) {
+		fs_on_disk = 0;
+		return -1;
+	}
+	root = (dentry_t*)((uint8_t*)boot + FS_METADATA_SEGMENT_SIZE);
+	blocks = count_inode_blocks(boot);
+	if (boot->num_dentries == 0 || boot->num_dentries > MAX_NUM_DENTRIES
+	   || boot->format > FS_FORMAT_EXTENTS
+	   || boot->num_inodes == 0 || blocks >= disk_blocks
+	   || boot->num_data_blocks > disk_blocks - 1 - blocks
+	   || strncmp(root->file_name, ".", FS_FILE_NAME_LEN) != 0 || root->file_type != FS_TYPE_DIR) {
+		fs_put_block(0);
+		fs_on_disk = 0;
+		return -1;
+	}
+	boot_block = boot;
+	dentries = root;
+	return 0;
+}
 
 /* 
  * init_fs
- * Initializes the publicly accessible filesystem variables.
+ * Mounts the filesystem on the first ATA disk that holds one, so that
+ * changes persist and blocks are read as they are used. Otherwise mounts
+ * the module and initializes the publicly accessible filesystem variables.
  * boot_block: the boot block with length information at the base address
  * dentries: the array of up to 63 directory entries right after the boot block
  * inodes: an array of index nodes starting 1 4kb block after the boot block 
  * data_blocks: an array of index nodes starting 1 + num_inodes blocks after the boot block
+ * On the disk inodes and data_blocks are NULL. An image in the extent format
+ * is mounted read only, and its inodes take fewer blocks. Then checks
+ * every inode once, so that reads can trust them, and marks the inodes and
+ * data blocks the image's files use, so that new files are given the others.
  *
  * Inputs: fs_base_address -- the base address of the filesystem, provided by multiboot
  * Returns: None
  * Side effects: initializes the above structures
  */
 void init_fs(uint32_t fs_base_address) {
-	// Read the function description to understand why the specific values are used.
-	boot_block = (boot_block_t*)fs_base_address;
-	dentries = (dentry_t*)(fs_base_address + FS_METADATA_SEGMENT_SIZE);
-	inodes = (inode_block_t*)(fs_base_address + FS_BLOCK_SIZE);
-	data_blocks = (data_block_t*)(fs_base_address + ((boot_block->num_inodes + 1) * FS_BLOCK_SIZE)); 
+	uint32_t total;
+	uint32_t i;
+
+	init_wait_queue(&fs_wait);
+	if (mount_disk(ATA_MASTER) == 0 || mount_disk(ATA_SLAVE) == 0) {
+		fs_extents = boot_block->format == FS_FORMAT_EXTENTS;
+		inode_blocks = count_inode_blocks(boot_block);
+		inodes = NULL;
+		data_blocks = NULL;
+		total = ata_sectors(fs_drive) / SECTORS_PER_BLOCK;
+		if (total > FS_MAX_BLOCKS)
+			total = FS_MAX_BLOCKS;
+		// every data block must have a bit in the bitmaps
+		fs_writable = DATA_BLOCK(boot_block->num_data_blocks) <= FS_MAX_BLOCKS;
+	} else {
+		// Read the function description to understand why the specific values are used.
+		boot_block = (boot_block_t*)fs_base_address;
+		dentries = (dentry_t*)(fs_base_address + FS_METADATA_SEGMENT_SIZE);
+		fs_extents = boot_block->format == FS_FORMAT_EXTENTS;
+		inode_blocks = count_inode_blocks(boot_block);
+		inodes = fs_extents ? NULL : (inode_block_t*)(fs_base_address + FS_BLOCK_SIZE);
+		data_blocks = (data_block_t*)(fs_base_address + ((inode_blocks + 1) * FS_BLOCK_SIZE)); 
+		total = FS_MAX_BLOCKS;
+		// every block, the overlay's included, must have a block_remap entry
+		fs_writable = DATA_BLOCK(boot_block->num_data_blocks) + FS_OVERLAY_BLOCKS <= FS_MAX_BLOCKS;
+	}
+	// extent inodes have no room to grow a file in
+	if (fs_extents)
+		fs_writable = 0;
+	data_block_limit = fs_writable ? total - DATA_BLOCK(0) : boot_block->num_data_blocks;
+	init_dcache();
+	for (i = 0; i < FS_ZCACHE_BLOCKS; i++)
+		zcache_inode[i] = 0;
+	for (i = 0; i < boot_block->num_inodes && i < FS_MAX_INODES; i++)
+		scan_inode(i);
+	if (!fs_writable)
+		return;
+
+	// find the inodes and data blocks the image's files and directories
+	// use; the root directory has inode 0 and the boot block
+	set_bit(inode_used, FS_ROOT_INODE);
+	mark_used(FS_ROOT_INODE, 0);
 }
 
 /* read_dentry_by_index
@@ -39,97 +673,542 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry) {
 	/* validity checks: is the index within bounds? */
 	if (index < 0 || index >= MAX_NUM_DENTRIES)
 		return -1;
+	fs_lock();
 	/* since file_name is a string, we have to call strncpy to copy all 32 bytes over */
-	strncpy(dentry->file_name, dentries[index].file_name, 32);
+	strncpy(dentry->file_name, get_dentry(index)->file_name, 32);
 	/* update the file_type and inode_index ints */
-	dentry->file_type = dentries[index].file_type;
-	dentry->inode_index = dentries[index].inode_index;
+	dentry->file_type = get_dentry(index)->file_type;
+	dentry->inode_index = get_dentry(index)->inode_index;
+	fs_unlock();
 	/* return success */
 	return 0;
 }
 
 /* read_dentry_by_name
  *
- * Iterates through all the directory entries and searches for one with
- * the name passed in as fname.  If a match is found, update the preallocated
- * passed-in dentry with the values of the match.
+ * Looks up a file by its path, such as "grep" or "/bin/grep": each name
+ * but the last must be a directory, starting from the root. If a match is
+ * found, update the preallocated passed-in dentry with the values of the match.
  *
- * Inputs: fname -- file name to find
+ * Inputs: fname -- path of the file to find
  *         dentry -- the directory entry whose values to update if a match is found
  * Returns: 0 for success or -1 if no match is found
  * Side effects: passed-in dentry values overwritten
  */
 int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry) {
-	int i; // iterator
-	if(!strlen((int8_t*)fname)) //if empty string
-		return -1;
-	for (i = 0; i < MAX_NUM_DENTRIES; i++) { // iterate through all known dentries
-		if (strncmp((const int8_t*)fname, dentries[i].file_name, 32) == 0) {
-			// found a match!
-			// use strncpy to copy the file name
-			strncpy(dentry->file_name, dentries[i].file_name, 32);
-			// update the passed-in dentry with the ints in the match
-			dentry->file_type = dentries[i].file_type;
-			dentry->inode_index = dentries[i].inode_index;
-			// return success
-			return 0;
+	int32_t ret;
+	uint32_t len = strlen((int8_t*)fname);
+
+	if (!len) //if empty string
+		return -1;
+	fs_lock();
+	ret = resolve_path(fname, len, dentry);
+	fs_unlock();
+	return ret;
+}
+
+/* read_dentry_in_dir
+ *
+ * Fills a dentry with entry index of a directory. Entries with an empty
+ * name are free.
+ *
+ * Inputs: dir -- inode of the directory, FS_ROOT_INODE for the root
+ *         index -- the entry to read
+ *         dentry -- the preallocated dentry to update
+ * Returns: 0 for success, -1 past the end of the directory
+ * Side effects: passed-in dentry values overwritten
+ */
+int32_t read_dentry_in_dir(uint32_t dir, uint32_t index, dentry_t* dentry) {
+	int32_t ret;
+
+	if (dir >= boot_block->num_inodes)
+		return -1;
+	fs_lock();
+	ret = dir_entry(dir, index, dentry);
+	fs_unlock();
+	return ret;
+}
+
+/* copy_out
+ * Inputs: to -- kernel buffer, or a program's if to_user is set
+ *         from, n -- file data to copy
+ * Returns: 0 on success, -1 if the program's buffer is bad */
+static inline int32_t copy_out(uint8_t* to, const uint8_t* from, uint32_t n, int to_user) {
+	if (to_user)
+		return copy_to_user(to, from, n);
+	memcpy(to, from, n);
+	return 0;
+}
+
+/* read_stored
+ *
+ * Copies bytes of the data blocks of a file as they are stored, one block
+ * at a time, from the disk, or from the overlay for blocks written since
+ * boot. In the module a run of blocks that follow each other in the image,
+ * an extent or a whole contiguous file, is copied in one go. Call with the
+ * lock held.
+ *
+ * Inputs: inode -- the index of the inode, checked with inode_ok
+ *         node -- the file's inode, held
+ *         offset -- first byte to copy
+ *         buf -- where to copy to
+ *         length -- bytes to copy, offset + length within stored_length
+ *         sequential -- nonzero to read the following blocks ahead
+ *         to_user -- nonzero if buf is a program's
+ * Returns: 0 on success, -1 if a block could not be read or buf is bad
+ */
+static int32_t read_stored(uint32_t inode, inode_block_t* node, uint32_t offset, uint8_t* buf, uint32_t length, int sequential, int to_user) {
+	uint32_t run; // blocks from the current one on that follow each other
+	uint32_t chunk; // bytes to copy from the current block
+	uint32_t bytes_read = 0; // bytes copied so far
+	uint32_t index, block;
+	uint8_t* data;
+
+	// copy the rest of the first block, then whole blocks
+	while (bytes_read < length) {
+		index = offset / FS_BLOCK_SIZE;
+		block = DATA_BLOCK(file_block(inode, node, index, &run));
+		// the disk's blocks come from the cache one at a time
+		if (fs_on_disk)
+			run = 1;
+		chunk = run * FS_BLOCK_SIZE - offset % FS_BLOCK_SIZE;
+		if (chunk > length - bytes_read)
+			chunk = length - bytes_read;
+		if ((data = fs_block(block)) == NULL)
+			return -1;
+		// the disk reads the next blocks while this one is copied
+		if (sequential)
+			fs_prefetch(inode, node, index);
+		if (copy_out(buf + bytes_read, data + offset % FS_BLOCK_SIZE, chunk, to_user) != 0) {
+			fs_put_block(block);
+			return -1;
 		}
+		fs_put_block(block);
+		bytes_read += chunk;
+		offset += chunk;
 	}
-	// no match found
-	return -1;
+	return 0;
 }
 
-/* read_data
+/* zcache_block
+ *
+ * Finds a block of a compressed file in the decompressed block cache, or
+ * reads and decompresses it into the next entry round the cache. Call
+ * with the lock held.
+ *
+ * Inputs: inode -- the index of the file's inode, checked with inode_ok
+ *         node -- the file's inode, held
+ *         index -- block of the file, below its length
+ *         sequential -- nonzero to read the following blocks ahead
+ * Returns: the decompressed block, NULL if it could not be read or is
+ *          corrupt
+ */
+static uint8_t* zcache_block(uint32_t inode, inode_block_t* node, uint32_t index, int sequential) {
+	uint32_t blocks = (node->length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+	uint32_t size = FS_BLOCK_SIZE; // bytes of the file in the block
+	uint32_t bounds[2]; // where the block's data starts and ends
+	uint32_t slot;
+	uint8_t* data;
+
+	for (slot = 0; slot < FS_ZCACHE_BLOCKS; slot++) {
+		if (zcache_inode[slot] == inode + 1 && zcache_index[slot] == index)
+			return zcache[slot].data;
+	}
+
+	if (index == blocks - 1 && node->length % FS_BLOCK_SIZE != 0)
+		size = node->length % FS_BLOCK_SIZE;
+	// each block's data ends where the next one's starts
+	bounds[0] = blocks * sizeof(uint32_t);
+	if (blocks * sizeof(uint32_t) > stored_length(node)
+	   || read_stored(inode, node, (index == 0) ? 0 : (index - 1) * sizeof(uint32_t),
+					  (uint8_t*)&bounds[index == 0], (index == 0) ? 4 : 8, 0, 0) != 0)
+		return NULL;
+	if (bounds[0] > bounds[1] || bounds[1] > stored_length(node) || bounds[1] - bounds[0] > size)
+		return NULL;
+
+	slot = zcache_hand;
+	zcache_hand = (zcache_hand + 1) % FS_ZCACHE_BLOCKS;
+	zcache_inode[slot] = 0;
+	data = zcache[slot].data;
+	if (bounds[1] - bounds[0] == size) {
+		// stored as it is
+		if (read_stored(inode, node, bounds[0], data, size, sequential, 0) != 0)
+			return NULL;
+	} else if (read_stored(inode, node, bounds[0], zcache_input, bounds[1] - bounds[0], sequential, 0) != 0
+			   || lz4_decompress(zcache_input, bounds[1] - bounds[0], data, size) != (int32_t)size) {
+		return NULL;
+	}
+	zcache_inode[slot] = inode + 1;
+	zcache_index[slot] = index;
+	return data;
+}
+
+/* read_file
  *
  * Reads data from a provided inode index.  The read should start at offset, and fill
- * the passed in buffer with length number of bytes starting at that point
+ * the passed in buffer with length number of bytes starting at that point.  Copies
+ * one block at a time, from the disk, or from the overlay for blocks written since boot.
+ * An extent of a module in the extent format is copied in one go. Blocks of
+ * a compressed file are copied out of the decompressed block cache.
  *
  * Inputs: inode -- the index of the inode to read data from
  *         offset --  the index of the first byte in the read
  *         buf -- the externally allocated buffer that the read data fills
  *         length -- the number of bytes to fill the buffer with before stopping
+ *         to_user -- nonzero if buf is a program's, copied to with copy_to_user
  * Returns: # bytes read on success, -1 on failure
  * Side Effects: Overwrites length bytes of the passed in buffer
  */
+static int32_t read_file(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length, int to_user) {
+	inode_block_t* node; // current contents of the inode
+	uint32_t chunk; // bytes to copy from the current block
+	uint32_t bytes_read = 0; // bytes copied so far
+	uint8_t* data;
+	int sequential; // read ahead of this read
+
+	/* validity checks: are we going to try to read more bytes than are in the file?
+	   The data block indices were checked when the file was last scanned */
+	fs_lock();
+	if (!inode_ok(inode) || (node = get_inode(inode)) == NULL) {
+		fs_unlock();
+		return -1;
+	}
+	if (offset > node->length || length > node->length - offset)
+		goto fail;
+	// a read that spans blocks, or carries on from the last one, is sequential
+	sequential = fs_on_disk && (length > FS_BLOCK_SIZE
+				 || (inode == last_read_inode && offset == last_read_end));
+	last_read_inode = inode;
+	last_read_end = offset + length;
+	if (!is_compressed(node)) {
+		if (read_stored(inode, node, offset, buf, length, sequential, to_user) != 0)
+			goto fail;
+		bytes_read = length;
+	}
+	while (bytes_read < length) {
+		if ((data = zcache_block(inode, node, offset / FS_BLOCK_SIZE, sequential)) == NULL)
+			goto fail;
+		chunk = FS_BLOCK_SIZE - offset % FS_BLOCK_SIZE;
+		if (chunk > length - bytes_read)
+			chunk = length - bytes_read;
+		if (copy_out(buf + bytes_read, data + offset % FS_BLOCK_SIZE, chunk, to_user) != 0)
+			goto fail;
+		bytes_read += chunk;
+		offset += chunk;
+	}
+	fs_put_block(INODE_BLOCK(inode));
+	fs_unlock();
+	// return success
+	return bytes_read;
+
+fail:
+	fs_put_block(INODE_BLOCK(inode));
+	fs_unlock();
+	return -1;
+}
+
+/* read_data
+ * Inputs: see read_file, buf in the kernel
+ * Returns: # bytes read on success, -1 on failure */
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length) {
-	/* validity checks: are we going to try to read more bytes than are in the file? */
-	if ((inode < 0) || (inode >= boot_block->num_inodes) || (offset + length > inodes[inode].length))
+	return read_file(inode, offset, buf, length, 0);
+}
+
+/* read_data_user
+ * Inputs: see read_file, buf in the current program
+ * Returns: # bytes read on success, -1 on failure, a bad buf included */
+int32_t read_data_user(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length) {
+	return read_file(inode, offset, buf, length, 1);
+}
+
+/* inode_length
+ *
+ * Inputs: inode -- the index of the inode
+ * Returns: the length of the file in bytes, writes since boot included, 0 for
+ *          a bad index or an inode that could not be read
+ */
+uint32_t inode_length(uint32_t inode) {
+	inode_block_t* node;
+	uint32_t length = 0;
+
+	if (inode >= boot_block->num_inodes)
+		return 0;
+	fs_lock();
+	if ((node = get_inode(inode)) != NULL) {
+		length = node->length;
+		fs_put_block(INODE_BLOCK(inode));
+	}
+	fs_unlock();
+	return length;
+}
+
+/* dentry_stat
+ *
+ * Gets the size of what a dentry names. The root directory lives in the
+ * boot block and the RTC has no data, so neither has data blocks. A
+ * compressed file's blocks are the ones its compressed data takes, as
+ * counted by scan_inode; a file it found bad has none.
+ *
+ * Inputs: dentry -- a dentry read from a directory
+ *         length -- filled in with the length in bytes
+ *         blocks -- filled in with the data blocks used, may be NULL
+ * Returns: nothing
+ */
+void dentry_stat(const dentry_t* dentry, uint32_t* length, uint32_t* blocks) {
+	inode_block_t* node;
+	uint32_t used = 0; // data blocks
+
+	*length = 0;
+	if (dentry->file_type == FS_TYPE_DIR && dentry->inode_index == FS_ROOT_INODE) {
+		*length = boot_block->num_dentries * sizeof(dentry_t);
+	} else if (dentry->file_type != FS_TYPE_RTC && dentry->inode_index < boot_block->num_inodes) {
+		fs_lock();
+		if ((node = get_inode(dentry->inode_index)) != NULL) {
+			*length = node->length;
+			fs_put_block(INODE_BLOCK(dentry->inode_index));
+		}
+		if (inode_ok(dentry->inode_index))
+			used = file_blocks[dentry->inode_index];
+		fs_unlock();
+	}
+	if (blocks != NULL)
+		*blocks = used;
+}
+
+/* resize_inode
+ *
+ * Changes the length of a file. Blocks past the new end are freed; a longer
+ * file gets new zeroed blocks and the bytes between the old and new end read
+ * as zeroes. Nothing changes if a block cannot be allocated. Call with the
+ * filesystem lock held.
+ *
+ * Inputs: inode -- the index of an inode in use
+ *         length -- the new length in bytes
+ * Returns: 0 on success, -1 if the file would be too long, the overlay is
+ *          full or the disk failed
+ * Side Effects: allocates or frees data blocks
+ */
+static int32_t resize_inode(uint32_t inode, uint32_t length) {
+	inode_block_t* node; // writable copy of the inode
+	uint32_t old_blocks, new_blocks, b, block;
+	uint32_t tail_end; // end of the zeroed bytes in the old last block
+	int32_t d;
+	int32_t ret = -1;
+	uint8_t* data;
+
+	if (length > MAX_FILE_BLOCKS * FS_BLOCK_SIZE)
+		return -1;
+	if ((node = (inode_block_t*)fs_block_writable(INODE_BLOCK(inode))) == NULL)
+		return -1;
+	old_blocks = (node->length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+	new_blocks = (length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+
+	for (b = old_blocks; b < new_blocks; b++) {
+		if ((d = alloc_data_block()) < 0) {
+			while (b-- > old_blocks)
+				free_data_block(node->data_index[b]);
+			goto out;
+		}
+		node->data_index[b] = d;
+	}
+	// whatever a shorter length left in the old last block must read as zeroes
+	if (length > node->length && node->length % FS_BLOCK_SIZE) {
+		block = DATA_BLOCK(node->data_index[old_blocks - 1]);
+		if ((data = fs_block_writable(block)) != NULL) {
+			tail_end = (length < old_blocks * FS_BLOCK_SIZE) ? length : old_blocks * FS_BLOCK_SIZE;
+			memset(data + node->length % FS_BLOCK_SIZE, 0, tail_end - node->length);
+		}
+		if (data == NULL || fs_put_block(block) != 0) {
+			for (b = old_blocks; b < new_blocks; b++)
+				free_data_block(node->data_index[b]);
+			goto out;
+		}
+	}
+	for (b = new_blocks; b < old_blocks; b++)
+		free_data_block(node->data_index[b]);
+	node->length = length;
+	ret = 0;
+
+out:
+	if (fs_put_block(INODE_BLOCK(inode)) != 0)
+		ret = -1;
+	scan_inode(inode);
+	return ret;
+}
+
+/* write_file
+ *
+ * Writes data to a provided inode index starting at offset, making the file
+ * longer if the write ends past its end. On the disk each block is written
+ * back once it is changed; in the module each block is written in its
+ * overlay copy, taken the first time the block is written.
+ *
+ * Inputs: inode -- the index of the inode to write data to
+ *         offset -- the index of the first byte written, at most the length
+ *         buf -- the data to write
+ *         length -- the number of bytes to write
+ *         from_user -- nonzero if buf is a program's, copied with copy_from_user
+ * Returns: # bytes written, -1 on failure
+ * Side Effects: allocates data blocks and overlay slots
+ */
+static int32_t write_file(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length, int from_user) {
+	inode_block_t* node; // current contents of the inode
+	uint32_t file_length; // length before the write
+	uint32_t chunk; // bytes to copy into the current block
+	uint32_t bytes_written = 0; // bytes copied so far
+	uint32_t block;
+	uint8_t* data;
+
+	if (!fs_writable || inode >= boot_block->num_inodes)
+		return -1;
+	fs_lock();
+	if (!test_bit(inode_used, inode) || (node = get_inode(inode)) == NULL) {
+		fs_unlock();
 		return -1;
-	// check all inode data blocks valid index
-	int i;
-	for(i = 0; i <= inodes[inode].length/FS_BLOCK_SIZE; i++){
-		if((inodes[inode].data_index[i] < 0) || (inodes[inode].data_index[i] >= boot_block->num_data_blocks))
-			return -1;
 	}
-	// Offset may indicate a data block other than the first one
-	// What block should we start reading from?
-	uint32_t inode_data_block_index = offset / FS_BLOCK_SIZE;
-	// Keep track of the index of the current data block to speed up lookups
-	// the compiler may have optimized this anyways but I don't trust technology.
-	uint32_t curr_data_block = inodes[inode].data_index[inode_data_block_index];
-	// The offset of the current block should be in range 0 to FS_BLOCK_SIZE-1
-	offset %= FS_BLOCK_SIZE;
-	// keep track of the number of bytes written
-	int bytes_written = 0;
-	// iterate through all the bytes we need to write
+	file_length = node->length;
+	fs_put_block(INODE_BLOCK(inode));
+	if (offset > file_length || length > MAX_FILE_BLOCKS * FS_BLOCK_SIZE - offset
+	   || (offset + length > file_length && resize_inode(inode, offset + length) != 0)
+	   || (node = get_inode(inode)) == NULL) {
+		fs_unlock();
+		return -1;
+	}
+	// the written blocks move to the overlay, out of the image's run
+	if (!fs_on_disk)
+		inode_flags[inode] &= ~INODE_CONTIGUOUS;
 	while (bytes_written < length) {
-		// if we reach the end of a block, we will need to loop around to the next one.
-		if (offset >= FS_BLOCK_SIZE) {
-			inode_data_block_index++;
-			// same values as above, just a new inode block index
-			curr_data_block = inodes[inode].data_index[inode_data_block_index];
-			offset = 0;
+		chunk = FS_BLOCK_SIZE - offset % FS_BLOCK_SIZE;
+		if (chunk > length - bytes_written)
+			chunk = length - bytes_written;
+		block = DATA_BLOCK(node->data_index[offset / FS_BLOCK_SIZE]);
+		if ((data = fs_block_writable(block)) == NULL)
+			break;
+		if (from_user) {
+			if (copy_from_user(data + offset % FS_BLOCK_SIZE, buf + bytes_written, chunk) != 0) {
+				fs_put_block(block);
+				break;
+			}
+		} else {
+			memcpy(data + offset % FS_BLOCK_SIZE, buf + bytes_written, chunk);
 		}
-		// copy the byte over and iterate the bytes written (output to buffer)
-		// and offset (index for source data)
-		buf[bytes_written] = data_blocks[curr_data_block].data[offset];
-		bytes_written++;
-		offset++;
+		if (fs_put_block(block) != 0)
+			break;
+		bytes_written += chunk;
+		offset += chunk;
 	}
-	// return success
-	return bytes_written;
+	fs_put_block(INODE_BLOCK(inode));
+	fs_unlock();
+	return bytes_written ? bytes_written : (length ? -1 : 0);
+}
+
+/* write_data
+ * Inputs: see write_file, buf in the kernel
+ * Returns: # bytes written, -1 on failure */
+int32_t write_data(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length) {
+	return write_file(inode, offset, buf, length, 0);
+}
+
+/* write_data_user
+ * Inputs: see write_file, buf in the current program
+ * Returns: # bytes written, -1 on failure, a bad buf included */
+int32_t write_data_user(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length) {
+	return write_file(inode, offset, buf, length, 1);
 }
 
+/* fs_truncate
+ *
+ * Sets the length of a file, see resize_inode.
+ *
+ * Inputs: inode -- the index of the inode
+ *         length -- the new length in bytes
+ * Returns: 0 on success, -1 on failure
+ * Side Effects: allocates or frees data blocks
+ */
+int32_t fs_truncate(uint32_t inode, uint32_t length) {
+	int32_t ret = -1;
+
+	fs_lock();
+	if (fs_writable && inode < boot_block->num_inodes && test_bit(inode_used, inode))
+		ret = resize_inode(inode, length);
+	fs_unlock();
+	return ret;
+}
+
+/* fs_create
+ *
+ * Creates an empty regular file in a free dentry with a free inode. An
+ * existing regular file is truncated to nothing instead. The file may be
+ * created in a subdirectory; its entry goes in the first free one there,
+ * or makes the directory longer.
+ *
+ * Inputs: fname -- path of the file, its last name 1 to 32 characters
+ *         dentry -- the preallocated dentry to fill with the file's
+ * Returns: 0 for success, -1 if the name is bad or taken by something other
+ *          than a file, the directory does not exist, or there is no free
+ *          dentry, inode or overlay slot
+ * Side effects: writes the directory and the inode
+ */
+int32_t fs_create(const uint8_t* fname, dentry_t* dentry) {
+	uint32_t i, inode; // free dentry and inode
+	uint8_t* boot; // writable copy of the boot block
+	inode_block_t* node; // writable copy of the inode
+	dentry_t entry; // the new dentry
+	dentry_t parent; // the directory it goes in
+	const uint8_t* name; // last name of the path
+	uint32_t len = strlen((int8_t*)fname);
+
+	for (name = fname + len; name > fname && name[-1] != '/'; name--);
+	if (name == fname + len || fname + len - name > FS_FILE_NAME_LEN)
+		return -1;
+	fs_lock();
+	if (!fs_writable)
+		goto fail;
+	if (resolve_path(fname, len, dentry) == 0) {
+		if (dentry->file_type != FS_TYPE_FILE || resize_inode(dentry->inode_index, 0) != 0)
+			goto fail;
+		fs_unlock();
+		return 0;
+	}
+	if (resolve_path(fname, name - fname, &parent) != 0 || parent.file_type != FS_TYPE_DIR)
+		goto fail;
+
+	for (i = 0; dir_entry(parent.inode_index, i, &entry) == 0 && entry.file_name[0] != '\0'; i++);
+	for (inode = 0; inode < boot_block->num_inodes && test_bit(inode_used, inode); inode++);
+	if ((parent.inode_index == FS_ROOT_INODE && i == MAX_NUM_DENTRIES) || inode == boot_block->num_inodes)
+		goto fail;
+	// the dentry goes in last, so a full overlay or a disk error leaves no
+	// half made file
+	if ((node = (inode_block_t*)fs_block_writable(INODE_BLOCK(inode))) == NULL)
+		goto fail;
+	node->length = 0;
+	if (fs_put_block(INODE_BLOCK(inode)) != 0)
+		goto fail;
+	scan_inode(inode);
+	memset(&entry, 0, sizeof(dentry_t));
+	strncpy(entry.file_name, (int8_t*)name, FS_FILE_NAME_LEN);
+	entry.file_type = FS_TYPE_FILE;
+	entry.inode_index = inode;
+	if (parent.inode_index == FS_ROOT_INODE) {
+		if ((boot = fs_block_writable(0)) == NULL)
+			goto fail;
+		*((dentry_t*)(boot + FS_METADATA_SEGMENT_SIZE) + i) = entry;
+		((boot_block_t*)boot)->num_dentries++;
+		if (fs_put_block(0) != 0)
+			goto fail;
+	} else if (write_data(parent.inode_index, i * sizeof(dentry_t), (uint8_t*)&entry, sizeof(dentry_t))
+			   != sizeof(dentry_t)) {
+		goto fail;
+	}
+	set_bit(inode_used, inode);
+	*dentry = entry;
+	fs_unlock();
+	return 0;
+
+fail:
+	fs_unlock();
+	return -1;
+}
 
 /* file_open
  * Description: opens file
@@ -155,18 +1234,37 @@ int32_t file_close(int32_t fd){
 }
 
 /* file_write
- * Description: Writes to the file
- * Inputs:  fd : none
-            buf: buffer to write to screen
+ * Description: Writes to the file at the file position and moves the
+ *              position past what was written. Writing past the end makes
+ *              the file longer.
+ * Inputs:  fd : file descriptor
+            buf: buffer to write to the file
             nbytes: number of bytes
- * Outputs: -1, since the file system is read only
- * Side Effects: None
+ * Outputs: number of bytes written, -1 on failure
+ * Side Effects: Changes the file on the disk, or in the overlay, never the image
  */
 
 int32_t file_write(int32_t fd, const void* buf, int32_t nbytes){
-    
-    //Write calls to regular files should always return -1 since the file system is read only
-    return -1;
+	int32_t bytes_written;
+	fd_entry_t* entry = &get_current_executing_pcb()->fd_array[fd];
+
+	bytes_written = write_data_user(entry->inode_index, entry->file_position, buf, nbytes);
+	if (bytes_written > 0)
+		entry->file_position += bytes_written;
+	return bytes_written;
+}
+
+/* dir_write
+ * Description: Directories are changed by creating files, not written
+ * Inputs:  fd : none
+            buf: none
+            nbytes: none
+ * Outputs: -1
+ * Side Effects: None
+ */
+
+int32_t dir_write(int32_t fd, const void* buf, int32_t nbytes){
+	return -1;
 }
 
 /*
@@ -187,15 +1285,22 @@ int32_t file_read(int32_t fd, void* buf, int32_t nbytes) {
 	int bytes_read;
 	int position;
 
+	uint32_t length;
+
 	pcb_t * curr_pcb = get_current_executing_pcb();
 	position = curr_pcb->fd_array[fd].file_position;
 	inode_idx = curr_pcb->fd_array[fd].inode_index;
+	length = inode_length(inode_idx);
 
-	if((inodes[inode_idx].length - position) < nbytes)
-		nbytes = inodes[inode_idx].length - position;
+	// the file may have been truncated below the position
+	if(position >= length)
+		return 0;
+	if((length - position) < nbytes)
+		nbytes = length - position;
 
-	bytes_read = read_data(inode_idx, position, buf, nbytes);
-	curr_pcb->fd_array[fd].file_position += bytes_read;
+	bytes_read = read_data_user(inode_idx, position, buf, nbytes);
+	if (bytes_read > 0)
+		curr_pcb->fd_array[fd].file_position += bytes_read;
 	return bytes_read;
 }
 
@@ -214,21 +1319,72 @@ int32_t file_read(int32_t fd, void* buf, int32_t nbytes) {
  */
 int32_t dir_read(int32_t fd, void* buf, int32_t nbytes) {
 	dentry_t dentry;
+	int8_t name[FS_FILE_NAME_LEN + 1]; // the name, zero terminated
+	int32_t len;
 	int i;
 
 	// find the next populated directory entry
 	pcb_t * curr_pcb = get_current_executing_pcb();
 	i = curr_pcb->fd_array[fd].file_position; // starting dentry
-	while (i < MAX_NUM_DENTRIES) {
-		if (read_dentry_by_index(i, &dentry) != 0)
-			return 0;
+	while (read_dentry_in_dir(curr_pcb->fd_array[fd].inode_index, i, &dentry) == 0) {
 		i++;
 		if (dentry.file_name[0] != '\0') { // we found a populated dentry
-			strncpy((int8_t*)buf, (int8_t*)dentry.file_name, nbytes);
-			break;
+			strncpy(name, (int8_t*)dentry.file_name, FS_FILE_NAME_LEN);
+			name[FS_FILE_NAME_LEN] = '\0';
+			len = strlen(name);
+			// the terminating zero goes too when there is room for it
+			if (copy_to_user(buf, name, len < nbytes ? len + 1 : nbytes) != 0)
+				return -1;
+			curr_pcb->fd_array[fd].file_position = i;
+			return len > nbytes ? nbytes : len;
 		}
 	}
 	curr_pcb->fd_array[fd].file_position = i;
-	return strlen(dentry.file_name) > nbytes ? nbytes : strlen(dentry.file_name);
+	return 0;
+}
+
+/*
+ * dir_getdents
+ *   DESCRIPTION:	Fills the buffer with a record for each populated entry of
+ *					the directory from the fd's position on, as many as fit,
+ *					so a listing with types and sizes takes one call.
+ *   INPUTS: 		fd : file descriptor of an open directory
+ * 					buf: user buffer to copy the records to
+ * 					nbytes: its size in bytes
+ *   OUTPUTS:		the records
+ *   RETURN VALUE: 	bytes copied, a multiple of sizeof(dirent_t); 0 at the end
+ *					of the directory, -1 if buf cannot hold one record or
+ *					cannot be written
+ *   SIDE EFFECTS: 	Moves the fd's position past the entries copied
+ */
+int32_t dir_getdents(int32_t fd, void* buf, int32_t nbytes) {
+	dentry_t dentry;
+	dirent_t record;
+	uint32_t i, count = 0;
+	fd_entry_t* fd_entry = &get_current_executing_pcb()->fd_array[fd];
+
+	if (nbytes < (int32_t)sizeof(dirent_t))
+		return -1;
+	fs_lock();
+	i = fd_entry->file_position;
+	while (count < nbytes / sizeof(dirent_t)
+		   && read_dentry_in_dir(fd_entry->inode_index, i, &dentry) == 0) {
+		i++;
+		if (dentry.file_name[0] == '\0')
+			continue;
+		memset(&record, 0, sizeof(record));
+		record.inode_index = dentry.inode_index;
+		record.file_type = dentry.file_type;
+		strncpy((int8_t*)record.name, dentry.file_name, FS_FILE_NAME_LEN);
+		dentry_stat(&dentry, &record.length, NULL);
+		if (copy_to_user((dirent_t*)buf + count, &record, sizeof(record)) != 0) {
+			fs_unlock();
+			return -1;
+		}
+		count++;
+	}
+	fd_entry->file_position = i;
+	fs_unlock();
+	return count * sizeof(dirent_t);
 }
 
@@ -7,6 +7,33 @@
 #define FS_METADATA_SEGMENT_SIZE 64
 
 #define MAX_NUM_DENTRIES 63
+// longest file name, not zero terminated at this length
+#define FS_FILE_NAME_LEN 32
+// longest path the system calls take, the NUL included
+#define FS_PATH_LEN 256
+
+// dentry file types
+#define FS_TYPE_RTC 0
+#define FS_TYPE_DIR 1
+#define FS_TYPE_FILE 2
+
+// inode_index of the "." entry, the root directory. A subdirectory is an
+// entry of type FS_TYPE_DIR whose inode holds an array of dentry_t.
+#define FS_ROOT_INODE 0
+
+// boot block formats
+#define FS_FORMAT_INDEXED 0 // an inode block per file, indexing each data block
+#define FS_FORMAT_EXTENTS 1 // packed inodes listing runs of contiguous data blocks
+// extents in an extent inode, and extent inodes in a block
+#define FS_INODE_EXTENTS 14
+#define FS_EXTENT_INODES_PER_BLOCK 32
+// extent inode flags
+#define FS_INODE_COMPRESSED 0x1 // the data blocks hold the file compressed
+
+// blocks that can be written since boot, 1MB
+#define FS_OVERLAY_BLOCKS 256
+// blocks of the image and the overlay together that can be tracked
+#define FS_MAX_BLOCKS 4096
 
 #include "types.h"
 #include "syscall.h"
@@ -17,7 +44,8 @@ typedef struct boot_block_t {
 		uint32_t num_dentries; // The number of directory entries after this boot block
 		uint32_t num_inodes; // The number of 4kB index nodes in the file system
 		uint32_t num_data_blocks; // The number of raw data blocks in the file system
-		uint32_t reserved[13]; // 52 bytes of reserved values, aligns the boot block with 64 bytes
+		uint32_t format; // FS_FORMAT_INDEXED or FS_FORMAT_EXTENTS
+		uint32_t reserved[12]; // 48 bytes of reserved values, aligns the boot block with 64 bytes
 } boot_block_t;
 
 /* directory entry */
@@ -39,23 +67,71 @@ typedef struct inode_block_t {
 		uint32_t data_index[1023]; // Indexes of the up to 1023 data blocks this inode contains
 } inode_block_t;
 
-/* pointers to important sections */
+/* run of data blocks next to each other */
+typedef struct fs_extent_t {
+		uint32_t start; // index of the first data block
+		uint32_t count; // number of data blocks
+} fs_extent_t;
+
+/* inode entry of the extent format, FS_EXTENT_INODES_PER_BLOCK to a block.
+ * The extents cover the file's blocks in order. A compressed file's data
+ * starts with a uint32_t per file block giving where that block's data ends,
+ * followed by each block compressed with LZ4 on its own; a block that did
+ * not shrink is stored as it is. */
+typedef struct extent_inode_t {
+		uint32_t length; // Length of this inode in bytes
+		uint32_t num_extents; // extents in use
+		uint32_t flags; // FS_INODE_COMPRESSED or 0
+		uint32_t stored_length; // bytes of data blocks used when compressed
+		fs_extent_t extents[FS_INODE_EXTENTS];
+} extent_inode_t;
+
+/* pointers to important sections of the image as loaded; fs.c reads the
+ * current contents, with the writes since boot, through the overlay. On a
+ * disk mount boot_block and dentries point at the boot block in memory, and
+ * inodes and data_blocks are NULL since blocks are read as they are used.
+ * inodes is NULL for the extent format too, which is never written */
 boot_block_t* boot_block; // Pointer to the boot block
 dentry_t* dentries; // Array of directory entries
 inode_block_t* inodes; // Array of index node pointers
 data_block_t* data_blocks; // Array of data block pointers
 
 /* accessible functions */
-/* Initializes above pointers, call this first. */
+/* Mounts the disk, or the module if there is no filesystem on it, and
+ * initializes above pointers, call this first. */
 void init_fs(uint32_t fs_base_address);
-/* Updates an elsewhere-allocated dentry with the values of one looked up by the file name. */
+/* Takes the lock that serializes filesystem operations, may be taken again
+ * by its holder. Operations take it themselves. */
+void fs_lock();
+/* Gives back the lock. */
+void fs_unlock();
+/* Updates an elsewhere-allocated dentry with the values of one looked up by its path,
+ * from the root directory. */
 int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry);
 /* Updates an elsewhere-allocated dentry with the values of the dentry at the provided index.
  * Much faster than reading by name, use this if you already have the index. */
 int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry);
+/* Updates a dentry with an entry of the directory with the given inode. */
+int32_t read_dentry_in_dir(uint32_t dir, uint32_t index, dentry_t* dentry);
 /* Reads data from the inode at the specified index, starting at offset and reading
  * length bytes.  The data goes into the buffer, make sure buf is large enough. */
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+/* Like read_data, into a program's buffer. */
+int32_t read_data_user(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+/* Returns the length of a file, with the writes since boot. */
+uint32_t inode_length(uint32_t inode);
+/* Gets the length and data block count of what a dentry names. */
+void dentry_stat(const dentry_t* dentry, uint32_t* length, uint32_t* blocks);
+/* Writes data to the inode at offset, making the file longer if needed. Writes
+ * go to the disk, or to overlay copies of the blocks; the module's image is
+ * never changed. */
+int32_t write_data(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length);
+/* Like write_data, from a program's buffer. */
+int32_t write_data_user(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length);
+/* Sets the length of a file, freeing blocks or adding zeroed ones. */
+int32_t fs_truncate(uint32_t inode, uint32_t length);
+/* Creates an empty file, or truncates an existing one, and fills in its dentry. */
+int32_t fs_create(const uint8_t* fname, dentry_t* dentry);
 /* Open the file */
 int32_t file_open(const uint8_t * filename);
 /* Close the file */
@@ -64,8 +140,12 @@ int32_t file_close(int32_t fd);
 int32_t file_write(int32_t fd, const void* buf, int32_t nbytes);
 /* Reads from the file */
 int32_t file_read(int32_t fd, void* buf, int32_t nbytes);
+/* Refuses writes to a directory */
+int32_t dir_write(int32_t fd, const void* buf, int32_t nbytes);
 /* Reads from the directory (ls) */
 int32_t dir_read(int32_t fd, void* buf, int32_t nbytes);
+/* Reads directory entries with their types and sizes (getdents) */
+int32_t dir_getdents(int32_t fd, void* buf, int32_t nbytes);
 
 
 
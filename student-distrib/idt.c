@@ -1,5 +1,6 @@
 #include "idt.h"
 #include "syscall.h"
+#include "uaccess.h"
 #include "terminal.h"   //TODO:REMOVE
 
 /* IDT VECTOR CONSTANTS see idt given in lecture */
@@ -7,6 +8,35 @@
 #define KEYBOARD_VECTOR 0x21
 #define RTC_VECTOR 0x28
 #define PIT_VECTOR 0x20
+#define SERIAL_VECTOR 0x24
+#define ATA_VECTOR 0x2E
+#define DIVIDE_ERROR_VECTOR 0
+#define NUM_EXCEPTIONS 20
+
+/* privilege level of the code an exception interrupted */
+#define RPL_MASK 0x3
+#define USER_RPL 3
+
+/* SYSENTER model specific registers and CPUID bits */
+#define IA32_SYSENTER_CS 0x174
+#define IA32_SYSENTER_ESP 0x175
+#define IA32_SYSENTER_EIP 0x176
+#define CPUID_FEATURES 1
+#define CPUID_SEP 0x800         //EDX bit 11, SYSENTER/SYSEXIT present
+#define CPUID_FAMILY 0xF00
+#define CPUID_FAMILY_6 0x600
+#define CPUID_FAMILY_MODEL 0xFF0
+#define PENTIUM_PRO_MODEL_3 0x630 //earlier family 6 parts report SEP but lack it
+
+/* wrmsr
+ * Description: writes a 32 bit value to a model specific register
+ * Inputs: msr - register number, val - value to write
+ * Outputs: None
+ * Side Effects: changes processor state
+ */
+static inline void wrmsr(uint32_t msr, uint32_t val){
+    asm volatile("wrmsr" : : "c" (msr), "a" (val), "d" (0) : "memory");
+}
 /* 
 This function will initialize the IDT. 
 The structure for a descriptor entry is given in the file "x86_desc.h". It is as follows-
@@ -97,107 +127,91 @@ void init_idt(){
         SET_IDT_ENTRY(idt[KEYBOARD_VECTOR], keyboard_wrapper);
         SET_IDT_ENTRY(idt[RTC_VECTOR], rtc_wrapper);
 		SET_IDT_ENTRY(idt[PIT_VECTOR], pit_wrapper);
+		SET_IDT_ENTRY(idt[SERIAL_VECTOR], serial_wrapper);
+		SET_IDT_ENTRY(idt[ATA_VECTOR], ata_wrapper);
 }
 
 
-/* BEGIN HARDWARE INTERRUPT HANDLERS FUNCTIONS */
-void interrupt_0() {
-    printf("Divide Error Exception. \n");
-    while(1)halt(255);		//halt
-}
-
-void interrupt_1() {
-    printf("Debug Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_2() {
-    printf("NMI Interrupt. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_3() {
-    printf("Breakpoint Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_4() {
-    printf("Overflow Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_5() {
-    printf("BOUND Range Exceeded Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_6() {
-    printf("Invalid Opcode Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_7() {
-    printf("Device Not Available Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_8() {
-    printf("Double Fault Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_9() {
-    printf("Coprocessor Segment Overrun. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_10() {
-    printf("Invalid TSS Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_11() {
-    printf("Segment Not Present. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_12() {
-    printf("Stack Fault Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_13() {
-    printf("General Protection Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_14() {
-    printf("Page-Fault Exception. \n");
-    while(1)halt(255);      //halt
-}
+/* init_sysenter
+ * Description: Programs the SYSENTER MSRs so user programs can enter the
+ *              kernel with SYSENTER instead of int $0x80. SYSENTER loads its
+ *              stack pointer from an MSR that never changes, so it points at
+ *              tss.esp0 and sysenter_wrapper loads the real stack from there.
+ *              Nothing is done on processors without SYSENTER, the int $0x80
+ *              gate keeps working either way.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: sets sysenter_enabled
+ */
+void init_sysenter(){
+    uint32_t eax, ebx, ecx, edx;
 
-void interrupt_15() {
-	printf("Test failed. \n");
-    while(1)halt(255);      //halt
-}
+    sysenter_enabled = 0;
+    asm volatile("cpuid"
+                 : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                 : "a" (CPUID_FEATURES));
+    if (!(edx & CPUID_SEP))
+        return;
+    if ((eax & CPUID_FAMILY) == CPUID_FAMILY_6 && (eax & CPUID_FAMILY_MODEL) < PENTIUM_PRO_MODEL_3)
+        return;
 
-void interrupt_16() {
-    printf("x87 FPU Floating-Point Error. \n");
-    while(1)halt(255);      //halt
+    wrmsr(IA32_SYSENTER_CS, KERNEL_CS);     //SYSEXIT derives USER_CS and USER_DS from this
+    wrmsr(IA32_SYSENTER_ESP, (uint32_t)&tss.esp0);
+    wrmsr(IA32_SYSENTER_EIP, (uint32_t)sysenter_wrapper);
+    sysenter_enabled = 1;
 }
 
-void interrupt_17() {
-    printf("Alignment Check Exception. \n");
-    while(1)halt(255);      //halt
-}
-
-void interrupt_18() {
-    printf("Machine-Check Exception. \n");
-    while(1)halt(255);      //halt
-}
+/* BEGIN HARDWARE INTERRUPT HANDLERS FUNCTIONS */
+/* messages printed when an exception kills a program, by vector */
+static const char* exception_names[NUM_EXCEPTIONS] = {
+    "Divide Error Exception. \n",
+    "Debug Exception. \n",
+    "NMI Interrupt. \n",
+    "Breakpoint Exception. \n",
+    "Overflow Exception. \n",
+    "BOUND Range Exceeded Exception. \n",
+    "Invalid Opcode Exception. \n",
+    "Device Not Available Exception. \n",
+    "Double Fault Exception. \n",
+    "Coprocessor Segment Overrun. \n",
+    "Invalid TSS Exception. \n",
+    "Segment Not Present. \n",
+    "Stack Fault Exception. \n",
+    "General Protection Exception. \n",
+    "Page-Fault Exception. \n",
+    "Test failed. \n",
+    "x87 FPU Floating-Point Error. \n",
+    "Alignment Check Exception. \n",
+    "Machine-Check Exception. \n",
+    "SIMD Floating-Point Exception. \n"
+};
+
+/* exception_handler
+ * Description: Called by the interrupt_0 - interrupt_19 wrappers. An exception
+ *              in user code that has a handler installed for its signal is
+ *              turned into DIV_ZERO or SEGFAULT, delivered on the way back to
+ *              user mode. Anything else prints the exception and halts the
+ *              program as before; so does a fault inside a signal handler,
+ *              which could not be delivered. A page fault in the user
+ *              copy routines makes the copy fail instead.
+ * Inputs: context - registers saved by the wrapper
+ * Outputs: None
+ * Side Effects: may halt the current program
+ */
+void exception_handler(hw_context_t* context){
+    pcb_t* current = get_current_executing_pcb();
+    int32_t signum;
+
+    if(fixup_exception(context))
+        return;
+    signum = (context->vector == DIVIDE_ERROR_VECTOR) ? SIG_DIV_ZERO : SIG_SEGFAULT;
+    if((context->cs & RPL_MASK) == USER_RPL && !current->sig_masked
+       && current->sig_handlers[signum] != NULL){
+        send_signal(current, signum);
+        return;
+    }
 
-void interrupt_19() {
-    printf("SIMD Floating-Point Exception. \n");
+    printf((int8_t*)exception_names[context->vector]);
     while(1)halt(255);      //halt
 }
 /*
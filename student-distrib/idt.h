@@ -6,8 +6,16 @@
 #include "interrupt_wrapper.h"
 /* IDT INITIALIZER */
 void init_idt();
+/* SETS UP THE SYSENTER FAST SYSTEM CALL ENTRY */
+void init_sysenter();
 
-/* HARDWARE INTERRUPT EXCEPTION HANDLER */
+/* set when the processor supports SYSENTER and the MSRs are programmed */
+int sysenter_enabled;
+
+/* HANDLES AN EXCEPTION, CALLED BY THE WRAPPERS BELOW */
+void exception_handler(hw_context_t* context);
+
+/* HARDWARE INTERRUPT EXCEPTION WRAPPERS, see interrupt_wrapper.S */
 extern void interrupt_0();
 extern void interrupt_1();
 extern void interrupt_2();
@@ -5,6 +5,8 @@
 #include "rtc.h"
 #include "syscall.h"
 #include "scheduler.h"
+#include "serial.h"
+#include "ata.h"
 
 //calls keyboard_handler with iret
 void keyboard_wrapper();
@@ -12,7 +14,15 @@ void keyboard_wrapper();
 void rtc_wrapper();
 //calls syscall_handler with iret
 void syscall_wrapper();
+//fast system call entry, returns with sysexit
+void sysenter_wrapper();
+//first return to user space of a spawned process
+void spawn_entry();
 //calls pit_handler with iret
 void pit_wrapper();
+//calls serial_handler with iret
+void serial_wrapper();
+//calls ata_handler with iret
+void ata_wrapper();
 
 #endif /* _INTERRUPT_WRAPPER_H */
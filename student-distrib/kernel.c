@@ -16,6 +16,9 @@
 #include "terminal.h"
 #include "fs.h"
 #include "syscall.h"
+#include "serial.h"
+#include "ata.h"
+#include "bcache.h"
 
 // #define RUN_TESTS
 
@@ -28,7 +31,7 @@
 void entry(unsigned long magic, unsigned long addr) {
 
     multiboot_info_t *mbi;
-	unsigned int fs_address;
+	unsigned int fs_address = 0;
 
     /* Clear the screen. */
     clear();
@@ -154,17 +157,27 @@ void entry(unsigned long magic, unsigned long addr) {
 
     /* Init IDT */
     init_idt();
+    /* Init the SYSENTER entry next to the int $0x80 gate */
+    init_sysenter();
 	/* Init paging */
 	init_paging();
     /* Init the PIC */
     i8259_init();
     /* Init Keyboard */
     init_keyboard();
+    /* Init COM1, then let the command line pick the console mode */
+    init_serial();
+    if (CHECK_FLAG(mbi->flags, 2))
+        serial_parse_cmdline((int8_t *)mbi->cmdline);
 	/* Init the RTC */
     init_rtc();
     /* Init terminals */
     init_terminal();
-	/* Init the Read-Only FS: pointed to by module 0 */
+	/* Init the disk on the primary master, if there is one */
+	init_ata();
+	/* Init the cache of disk blocks */
+	init_bcache();
+	/* Init the FS: from the disk when it holds one, else module 0 */
 	init_fs(fs_address);
 
     /* Enable interrupts */
@@ -174,6 +187,9 @@ void entry(unsigned long magic, unsigned long addr) {
     /*printf("Enabling Interrupts\n"); */
     sti();
 
+    /* The tests and boot run on behalf of PID 0 */
+    set_current(0);
+
 #ifdef RUN_TESTS
     /* Run tests */
     launch_tests();
@@ -1,4 +1,5 @@
 #include "keyboard.h"
+#include "ldisc.h"
 
 /* MAP: SCANCODE TO ASCII when no modifier is pressed. */
 static const char no_modifier[60] =
@@ -121,12 +122,7 @@ void keyboard_handler() {
         	SHIFT_RIGHT_FLAG = 0;
         	break;
       	case ENTER:
-          if(buff_index < BUFF_SIZE) {
-            key_buff[buff_index] = '\n';
-            buff_index++;
-            printf("%c", '\n');  
-            num_enters++;   
-          }
+          ldisc_receive('\n');
           break;
       	case CTRL_ON:
       		CTRL_FLAG = 1;
@@ -135,13 +131,7 @@ void keyboard_handler() {
       		CTRL_FLAG = 0;
       		break;
       	case BACKSPACE:
-          //shift index left and delete previously pressed key
-      		buff_index--;
-          if(buff_index < 0)
-            buff_index = 0;          
-          if(key_buff[buff_index] != '\0')
-            print_backspace();
-          key_buff[buff_index] = '\0';
+          ldisc_receive('\b');
           break;
      	  case CAPS_ON:
         	CAPS_LOCK_FLAG ^= 1;
@@ -174,6 +164,11 @@ void set_buffer(uint8_t key) {
     	clear();
       return;
   }
+  /* Control and a letter sends the matching control character. */
+  if(CTRL_FLAG && key < KNOWN_CODES && no_modifier[key] >= 'a' && no_modifier[key] <= 'z') {
+    ldisc_receive(no_modifier[key] - 'a' + 1);
+    return;
+  }
   if((key >= F1) && (key <= F3)){
     if(alt_flag){
       cli();
@@ -185,52 +180,16 @@ void set_buffer(uint8_t key) {
   //make sure not unkown scancode
   if((key == TAB) || (key == ESC) || (key == P_SCREEN0) || (key == P_SCREEN1))
     return;
-    if(buff_index < BUFF_SIZE - 1) {
-	    /* If caps lock and shift are pressed then print correct mapping. */
-	    if(CAPS_LOCK_FLAG && (SHIFT_RIGHT_FLAG || SHIFT_LEFT_FLAG) && (key < KNOWN_CODES)) {
-	    	key_buff[buff_index] = caps_shift_pressed[key];
-	    	printf("%c", key_buff[buff_index]);
-	    	buff_index++;
-	    }
-	    /* If shift is pressed then print correct mapping. */
-	    else if((SHIFT_LEFT_FLAG || SHIFT_RIGHT_FLAG) && (key < KNOWN_CODES)) {
-	    	key_buff[buff_index] = shift_pressed[key];
-	    	printf("%c", key_buff[buff_index]);
-	    	buff_index++;
-	    }
-	    /* If capslock is on then print correct mapping. */
-	    else if(CAPS_LOCK_FLAG && key < KNOWN_CODES) {
-	    	key_buff[buff_index] = caps_pressed[key];
-	    	printf("%c", key_buff[buff_index]);
-	    	buff_index++;
-	    }
-	    /* If no modifiers are on then just print regular mapping. */
-	    else if(key < KNOWN_CODES) {
-	    	key_buff[buff_index] = no_modifier[key];
-			  printf("%c", key_buff[buff_index]);
-	    	buff_index++;
-	   	}
-	}
-}
-
-/* shift_buffer
- * Description: Called by terminal_read
- *              Clears buffer up to the new line character. Then discards
- *              read text by shifting left.
- * Inputs: index (clears up to this index)
- * Outputs: None
- * Side Effects: changes buffer
- */
-void shift_buffer(int index, uint8_t * buf){
-  int i;
-  // clear buffer up to index
-  for(i = 0; i <= index; i++)
-    buf[i] = '\0';
-  //shift left
-  memcpy((void*)buf, (void*)&buf[i+1], BUFF_SIZE-index-1);
-  //update index
-  if(exec_term_id == curr_term_id)
-    buff_index -= (index+1);
-  else
-    terms[exec_term_id].buff_index_save -= (index+1);
+  /* If caps lock and shift are pressed then print correct mapping. */
+  if(CAPS_LOCK_FLAG && (SHIFT_RIGHT_FLAG || SHIFT_LEFT_FLAG) && (key < KNOWN_CODES))
+    ldisc_receive(caps_shift_pressed[key]);
+  /* If shift is pressed then print correct mapping. */
+  else if((SHIFT_LEFT_FLAG || SHIFT_RIGHT_FLAG) && (key < KNOWN_CODES))
+    ldisc_receive(shift_pressed[key]);
+  /* If capslock is on then print correct mapping. */
+  else if(CAPS_LOCK_FLAG && key < KNOWN_CODES)
+    ldisc_receive(caps_pressed[key]);
+  /* If no modifiers are on then just print regular mapping. */
+  else if(key < KNOWN_CODES)
+    ldisc_receive(no_modifier[key]);
 }
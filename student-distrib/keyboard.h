@@ -23,8 +23,6 @@ extern void init_keyboard();
 extern void keyboard_handler();
 /* sets the buffer for keyboard inputs. */
 void set_buffer(uint8_t key);
-/* discard read string and shift */
-void shift_buffer(int index, uint8_t * buf);
 
 /* Key buffer index. */
 volatile int buff_index;
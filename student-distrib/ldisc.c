@@ -0,0 +1,230 @@
+/* ldisc.c -- line discipline between keyboard input and terminal_read
+ * vim:ts=4 noexpandtab
+ */
+
+#include "ldisc.h"
+#include "uaccess.h"
+
+/*
+ * ldisc_erase
+ *   DESCRIPTION:	Removes the last character of the line being typed on the
+ *					displayed terminal and erases it from the screen. Never
+ *					erases past a line that was already entered.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	1 if a character was erased, 0 otherwise
+ *   SIDE EFFECTS: 	Changes the keyboard buffer
+ */
+static int ldisc_erase() {
+	if (buff_index == 0 || key_buff[buff_index - 1] == '\n')
+		return 0;
+	buff_index--;
+	key_buff[buff_index] = '\0';
+	print_backspace();
+	return 1;
+}
+
+/*
+ * ldisc_consume
+ *   DESCRIPTION:	Drops the first n characters of the executing terminal's
+ *					input and moves the rest to the front of the buffer.
+ *   INPUTS: 		int n : number of characters to drop
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Changes the keyboard buffer
+ */
+static void ldisc_consume(int n) {
+	memmove((void*)key_buff, (void*)&key_buff[n], BUFF_SIZE - n);
+	memset((void*)&key_buff[BUFF_SIZE - n], '\0', n);
+	buff_index -= n;
+}
+
+/*
+ * ldisc_interrupt
+ *   DESCRIPTION:	Handles Ctrl+C on the displayed terminal. The line being
+ *					typed is thrown away and the foreground program, the one
+ *					the terminal's shell is waiting on, gets INTERRUPT. Lines
+ *					already entered are kept for whoever reads next.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Changes the keyboard buffer, prints to the screen
+ */
+static void ldisc_interrupt() {
+	if (terms[curr_term_id].ldisc_mode == LDISC_COOKED) {
+		while (buff_index > 0 && key_buff[buff_index - 1] != '\n') {
+			buff_index--;
+			key_buff[buff_index] = '\0';
+		}
+		puts("^C\n");
+	}
+	send_signal(get_terminal_pcb(curr_term_id), SIG_INTERRUPT);
+}
+
+/*
+ * ldisc_receive
+ *   DESCRIPTION:	Called by the keyboard and serial drivers with each
+ *					character typed on the displayed terminal. In cooked mode the
+ *					character is echoed and added to the line being edited;
+ *					erase and kill edit that line and enter completes it. In raw
+ *					mode every character is queued as is, without echo. Ctrl+C
+ *					is never queued, it interrupts the foreground program. Readers
+ *					are woken as soon as there is something for them to read.
+ *   INPUTS: 		uint8_t c : character typed
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Changes the keyboard buffer, may print to the screen
+ */
+void ldisc_receive(uint8_t c) {
+	if (c == '\r')
+		c = '\n';
+
+	if (c == LDISC_INTR) {
+		ldisc_interrupt();
+		return;
+	}
+
+	if (terms[curr_term_id].ldisc_mode == LDISC_RAW) {
+		if (c != '\0' && buff_index < BUFF_SIZE) {
+			key_buff[buff_index] = c;
+			buff_index++;
+			wake_up(&terms[curr_term_id].input_wq);
+		}
+		return;
+	}
+
+	switch (c) {
+		case '\n':
+			if (buff_index < BUFF_SIZE) {
+				key_buff[buff_index] = '\n';
+				buff_index++;
+				putc('\n');
+				num_enters++;
+				wake_up(&terms[curr_term_id].input_wq);
+			}
+			break;
+		case LDISC_ERASE:
+		case ASCII_DEL:
+			ldisc_erase();
+			break;
+		case LDISC_KILL:
+			while (ldisc_erase());
+			break;
+		default:
+			// leave room for the newline ending the line
+			if (c >= ' ' && c < ASCII_DEL && buff_index < BUFF_SIZE - 1) {
+				key_buff[buff_index] = c;
+				buff_index++;
+				putc(c);
+			}
+			break;
+	}
+}
+
+/*
+ * ldisc_ready
+ *   DESCRIPTION:	Checks whether the executing terminal has input to read. A
+ *					terminal only reads while it is displayed, since the keyboard
+ *					buffer always belongs to the displayed terminal.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	1 if a line (cooked) or any character (raw) is waiting
+ *   SIDE EFFECTS: 	none
+ */
+int ldisc_ready() {
+	if (exec_term_id != curr_term_id)
+		return 0;
+	if (terms[exec_term_id].ldisc_mode == LDISC_RAW)
+		return buff_index > 0;
+	return num_enters > 0;
+}
+
+/*
+ * ldisc_read
+ *   DESCRIPTION:	Copies input of the executing terminal into buf. In cooked
+ *					mode this is the first line without its newline; the whole
+ *					line is consumed even if it does not fit. In raw mode it is
+ *					every queued character that fits.
+ *   INPUTS: 		uint8_t* buf : program's buffer to copy to
+ *					int32_t nbytes : size of buf
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	number of bytes copied, -1 if buf or nbytes is bad
+ *   SIDE EFFECTS: 	Consumes the input that was read, none if buf or nbytes
+ *					is bad
+ */
+int32_t ldisc_read(uint8_t* buf, int32_t nbytes) {
+	int i = 0;
+	int32_t n;					// bytes copied
+
+	if (nbytes < 0)
+		return -1;
+	if (terms[exec_term_id].ldisc_mode == LDISC_RAW) {
+		n = (buff_index < nbytes) ? buff_index : nbytes;
+		if (copy_to_user(buf, (const void*)key_buff, n) != 0)
+			return -1;
+		ldisc_consume(n);
+		return n;
+	}
+
+	while (key_buff[i] != '\n')
+		i++;
+	n = (i < nbytes) ? i : nbytes;
+	if (copy_to_user(buf, (const void*)key_buff, n) != 0)
+		return -1;
+	num_enters--;
+	ldisc_consume(i + 1);		// +1 for the newline
+	return n;
+}
+
+/*
+ * ldisc_get_mode
+ *   DESCRIPTION:	Returns a terminal's line discipline mode.
+ *   INPUTS: 		int term_id : terminal to look at
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	LDISC_COOKED or LDISC_RAW
+ *   SIDE EFFECTS: 	none
+ */
+int ldisc_get_mode(int term_id) {
+	return terms[term_id].ldisc_mode;
+}
+
+/*
+ * ldisc_set_mode
+ *   DESCRIPTION:	Sets a terminal's line discipline mode. Input typed before
+ *					the change is kept; the count of complete lines is redone so
+ *					that cooked reads see any newlines queued in raw mode.
+ *   INPUTS: 		int term_id : terminal to change
+ *					int mode : LDISC_COOKED or LDISC_RAW
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0 on success, -1 for a bad mode
+ *   SIDE EFFECTS: 	Wakes readers of the terminal
+ */
+int ldisc_set_mode(int term_id, int mode) {
+	uint32_t flags;
+	volatile char* buf;
+	int len, i, enters = 0;
+
+	if (mode != LDISC_COOKED && mode != LDISC_RAW)
+		return -1;
+
+	cli_and_save(flags);
+	terms[term_id].ldisc_mode = mode;
+	if (term_id == curr_term_id) {
+		buf = key_buff;
+		len = buff_index;
+	} else {
+		buf = (volatile char*)terms[term_id].buff_save;
+		len = terms[term_id].buff_index_save;
+	}
+	for (i = 0; i < len; i++) {
+		if (buf[i] == '\n')
+			enters++;
+	}
+	if (term_id == curr_term_id)
+		num_enters = enters;
+	else
+		terms[term_id].enters_save = enters;
+	wake_up(&terms[term_id].input_wq);
+	restore_flags(flags);
+	return 0;
+}
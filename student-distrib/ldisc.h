@@ -0,0 +1,34 @@
+#ifndef _LDISC_H
+#define _LDISC_H
+
+#include "types.h"
+#include "lib.h"
+#include "keyboard.h"
+#include "terminal.h"
+
+/* line discipline modes */
+#define LDISC_COOKED	0		// line editing and echo, reads return whole lines
+#define LDISC_RAW		1		// no editing or echo, reads return each keystroke
+
+/* control characters handled in cooked mode */
+#define LDISC_ERASE		'\b'	// erases the last character
+#define LDISC_KILL		0x15	// Ctrl+U, erases the whole line
+#define LDISC_INTR		0x03	// Ctrl+C, sends INTERRUPT in both modes
+#define ASCII_DEL		0x7F	// backspace as sent by most serial terminals
+
+/* terminal ioctl commands */
+#define TERM_GET_MODE	1		// returns the line discipline mode
+#define TERM_SET_MODE	2		// sets the line discipline mode to arg
+
+/* handles a character typed on the displayed terminal. */
+void ldisc_receive(uint8_t c);
+/* returns whether a read on the executing terminal would not block. */
+int ldisc_ready();
+/* copies input of the executing terminal to buf, call only when ready. */
+int32_t ldisc_read(uint8_t* buf, int32_t nbytes);
+/* returns a terminal's line discipline mode. */
+int ldisc_get_mode(int term_id);
+/* sets a terminal's line discipline mode. */
+int ldisc_set_mode(int term_id, int mode);
+
+#endif /* _LDISC_H */
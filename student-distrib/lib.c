@@ -3,6 +3,7 @@
 
 #include "lib.h"
 #include "terminal.h"
+#include "serial.h"
 
 #define VIDEO       0xB8000
 #define NUM_COLS    80
@@ -11,7 +12,13 @@
 
 static int screen_x;
 static int screen_y;
+static uint8_t screen_attrib = ATTRIB;
 static char* video_mem = (char *)VIDEO;
+/* Rows of video memory the kernel wrote since take_vga_dirty_rows last ran. */
+static uint32_t vga_dirty_rows = 0;
+
+static void vga_putc(uint8_t c);
+static void non_display_vga_putc(uint8_t c, int term_id);
 
 /* move_cursor
  * Inputs: none
@@ -62,6 +69,41 @@ void set_y(int y){
 }
 
 
+/* get_attrib
+ * Inputs: void
+ * Return Value: screen_attrib
+ * Function: returns the attribute byte used for new characters*/
+uint8_t get_attrib(){
+    return screen_attrib;
+}
+
+/* set_attrib
+ * Inputs: attrib: VGA attribute byte (background << 4 | foreground)
+ * Return Value: none
+ * Function: sets the attribute byte used for new characters*/
+void set_attrib(uint8_t attrib){
+    screen_attrib = attrib;
+}
+
+/* mark_vga_dirty
+ * Inputs: first, last: first and last row written
+ * Return Value: none
+ * Function: records rows of video memory written outside of lib.c*/
+void mark_vga_dirty(int first, int last){
+    for(; first <= last; first++)
+        vga_dirty_rows |= 1 << first;
+}
+
+/* take_vga_dirty_rows
+ * Inputs: void
+ * Return Value: bitmask of rows written since the last call, bit n is row n
+ * Function: lets a terminal switch copy only the rows that changed*/
+uint32_t take_vga_dirty_rows(){
+    uint32_t rows = vga_dirty_rows;
+    vga_dirty_rows = 0;
+    return rows;
+}
+
 /* scroll
  * Inputs: void
  * Return Value: none
@@ -82,8 +124,9 @@ void scroll(){
     //clear bottom row
     for(i = 0; i < NUM_COLS; i++){
         *(uint8_t *)(video_mem + ((NUM_COLS * (NUM_ROWS - 1) + i) << 1)) = '\0';
-        *(uint8_t *)(video_mem + ((NUM_COLS * (NUM_ROWS - 1) + i) << 1) + 1) = ATTRIB;
+        *(uint8_t *)(video_mem + ((NUM_COLS * (NUM_ROWS - 1) + i) << 1) + 1) = screen_attrib;
     }
+    vga_dirty_rows = VGA_ALL_ROWS;
     //update cursor
     move_cursor();
 }
@@ -96,8 +139,9 @@ void clear(void) {
     int32_t i;
     for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
         *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = ATTRIB;
+        *(uint8_t *)(video_mem + (i << 1) + 1) = screen_attrib;
     }
+    vga_dirty_rows = VGA_ALL_ROWS;
     screen_x = 0;
     screen_y = 0;
     move_cursor();
@@ -247,6 +291,14 @@ int32_t puts(int8_t* s) {
  *   Return Value: NONE
  *    Function: prints a backspace at previous position */
 void print_backspace() {
+    //erase the character on a serial terminal too
+    if(serial_console_mode != SERIAL_CONSOLE_OFF) {
+        serial_putc('\b');
+        serial_putc(' ');
+        serial_putc('\b');
+    }
+    if(serial_console_mode == SERIAL_CONSOLE_ONLY)
+        return;
     //update cursor position
     screen_x--;
     if(screen_x < 0){
@@ -256,15 +308,27 @@ void print_backspace() {
     }
     //print space at cursor
     *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1)) = '\0';
-    *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1) + 1) = ATTRIB;
+    *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1) + 1) = screen_attrib;
+    vga_dirty_rows |= 1 << screen_y;
     move_cursor();
 }
 
 /* void putc(uint8_t c);
  * Inputs: uint_8* c = character to print
  * Return Value: void
- *  Function: Output a character to the console */
+ *  Function: Output a character to the console and/or serial port */
 void putc(uint8_t c) {
+    if(serial_console_mode != SERIAL_CONSOLE_OFF)
+        serial_putc(c);
+    if(serial_console_mode != SERIAL_CONSOLE_ONLY)
+        vga_putc(c);
+}
+
+/* void vga_putc(uint8_t c);
+ * Inputs: uint_8* c = character to print
+ * Return Value: void
+ *  Function: Output a character to video memory */
+static void vga_putc(uint8_t c) {
     if(c == '\n' || c == '\r') {
         screen_y++;
         if(screen_y >= NUM_ROWS)
@@ -273,12 +337,13 @@ void putc(uint8_t c) {
         move_cursor();
     } else {
         *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1)) = c;
-        *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1) + 1) = ATTRIB;
+        *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1) + 1) = screen_attrib;
+        vga_dirty_rows |= 1 << screen_y;
         screen_x++;
         //screen_x %= NUM_COLS;
         if(screen_x == NUM_COLS){
             move_cursor();
-            printf("%c", '\n');
+            vga_putc('\n');
             return;
         }
         screen_y = (screen_y + (screen_x / NUM_COLS)) % NUM_ROWS;
@@ -306,7 +371,7 @@ void non_display_scroll(int term_id){
     //clear bottom row
     for(i = 0; i < NUM_COLS; i++){
         *(uint8_t *)(terms[term_id].vid_save + ((NUM_COLS * (NUM_ROWS - 1) + i) << 1)) = '\0';
-        *(uint8_t *)(terms[term_id].vid_save + ((NUM_COLS * (NUM_ROWS - 1) + i) << 1) + 1) = ATTRIB;
+        *(uint8_t *)(terms[term_id].vid_save + ((NUM_COLS * (NUM_ROWS - 1) + i) << 1) + 1) = terms[term_id].attrib_save;
     }
     //update cursor
     //move_cursor();  
@@ -315,8 +380,19 @@ void non_display_scroll(int term_id){
 /* void non_display_putc(uint8_t c);
  * Inputs: uint_8* c = character to print, term_id to write nondisplay characters to
  * Return Value: void
- *  Function: Output a character to the console */
+ *  Function: Output a character to a nondisplay buffer and/or serial port */
 void non_display_putc(uint8_t c, int term_id){
+    if(serial_console_mode != SERIAL_CONSOLE_OFF)
+        serial_putc(c);
+    if(serial_console_mode != SERIAL_CONSOLE_ONLY)
+        non_display_vga_putc(c, term_id);
+}
+
+/* void non_display_vga_putc(uint8_t c);
+ * Inputs: uint_8* c = character to print, term_id to write nondisplay characters to
+ * Return Value: void
+ *  Function: Output a character to a nondisplay buffer */
+static void non_display_vga_putc(uint8_t c, int term_id){
     if(c == '\n' || c == '\r') {
         terms[term_id].y_save++;
         if(terms[term_id].y_save >= NUM_ROWS)
@@ -325,12 +401,12 @@ void non_display_putc(uint8_t c, int term_id){
         //move_cursor();
     } else {
         *(uint8_t *)(terms[term_id].vid_save + ((NUM_COLS * terms[term_id].y_save + terms[term_id].x_save) << 1)) = c;
-        *(uint8_t *)(terms[term_id].vid_save + ((NUM_COLS * terms[term_id].y_save + terms[term_id].x_save) << 1) + 1) = ATTRIB;
+        *(uint8_t *)(terms[term_id].vid_save + ((NUM_COLS * terms[term_id].y_save + terms[term_id].x_save) << 1) + 1) = terms[term_id].attrib_save;
         terms[term_id].x_save++;
         //screen_x %= NUM_COLS;
         if(terms[term_id].x_save == NUM_COLS){
             //move_cursor();
-            non_display_putc('\n', term_id);
+            non_display_vga_putc('\n', term_id);
             return;
         }
         terms[term_id].y_save = (terms[term_id].y_save + (terms[term_id].x_save / NUM_COLS)) % NUM_ROWS;
@@ -561,6 +637,25 @@ void* memmove(void* dest, const void* src, uint32_t n) {
     return dest;
 }
 
+/* int32_t memcmp(const void* s1, const void* s2, uint32_t n)
+ * Inputs: const void* s1 = first buffer to compare
+ *         const void* s2 = second buffer to compare
+ *           uint32_t n = number of bytes to compare
+ * Return Value: zero if the buffers are equal, otherwise the difference
+ *               of the first pair of bytes that differ
+ * Function: compares two buffers byte by byte, unlike strncmp it does
+ *           not stop at '\0' */
+int32_t memcmp(const void* s1, const void* s2, uint32_t n) {
+    const uint8_t* a = (const uint8_t*)s1;
+    const uint8_t* b = (const uint8_t*)s2;
+    uint32_t i;
+    for (i = 0; i < n; i++) {
+        if (a[i] != b[i])
+            return a[i] - b[i];
+    }
+    return 0;
+}
+
 /* int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n)
  * Inputs: const int8_t* s1 = first string to compare
  *         const int8_t* s2 = second string to compare
@@ -631,73 +726,6 @@ void test_interrupts(void) {
     for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
         video_mem[i << 1]++;
     }
-}
-
-/* void parse_command
- * Inputs: command: full command to parse from
-           cmd: first element to write to
-           args: to hold other strings in command 
- * Return Value: void
- * Function: parses command's file and arguments into cmd and args */
-void parse_command(uint8_t * cmd, uint8_t args[BUFF_SIZE], const uint8_t * command){
-    int i;
-    //int temp_arg_idx = 0;
-    int arg_idx = 0;                                    //index into single arg
-    //int num_args = 0;                                   //number of arguments
-    int cmd_idx = 0;                                    //index into cmd
-    int length = strlen((int8_t*)command);              //length of command
-    //unsigned long first_arg_letter_found = 0;
-    uint8_t prev_char = ' ';                            //character used to test for repeated spaces
-
-    //initialize cmd. used to test for initial spaces
-    cmd[0] = '\0';
-    //get command loop
-    for(i = 0; i < length; i++) {
-        //finish command
-        if(command[i] == ' ' && cmd[0] != '\0') {                       
-                i++;
-                break;
-        }
-        else if(command[i] != ' ') {
-            cmd[cmd_idx] = command[i];
-            cmd_idx++;
-        }
-    }
-    cmd[cmd_idx] = '\0';
-    //get arg loop
-    for(; i < length; i++) {
-        //is end of arg ->start new arg
-        if(command[i] == ' ' && prev_char != ' '){
-            args[arg_idx] = ' ';
-            arg_idx++;
-        }
-        else if(command[i] != ' '){
-            args[arg_idx] = command[i];
-            arg_idx++;
-        }               
-        prev_char = command[i];
-    }
-    //null terminate final argument
-    if(args[arg_idx-1] == ' ')
-        args[arg_idx-1] = '\0';
-    args[arg_idx] = '\0';
-    
-    /*
-     for(; i < length; i++) {
-        //is end of arg ->start new arg
-        if(command[i] == '\0')
-            break;
-        if((!first_arg_letter_found) && !(command[i] == ' ')){
-            args[arg_idx] = command[i];
-            first_arg_letter_found = 1;
-            arg_idx++;
-        }
-        else if(first_arg_letter_found){
-            args[arg_idx] = command[i];
-            arg_idx++;
-        }
-    }
-    args[arg_idx] = '\0';
-    */
+    vga_dirty_rows = VGA_ALL_ROWS;
 }
 
@@ -9,7 +9,6 @@
 /* added functions for chk3 */
 
 #define BUFF_SIZE   128
-void parse_command(uint8_t * cmd, uint8_t args[BUFF_SIZE], const uint8_t * command); //parses command into cmd and args
 
 /* non_display_putc */
 void non_display_putc(uint8_t c, int term_id);
@@ -22,6 +21,11 @@ void set_x(int x); //sets screen_x
 void set_y(int y); //sets screen_y
 void scroll(); //scrolls screen down
 void move_cursor(); //moves cursor
+uint8_t get_attrib(); //returns screen_attrib
+void set_attrib(uint8_t attrib); //sets screen_attrib
+void mark_vga_dirty(int first, int last); //records rows written to video memory
+uint32_t take_vga_dirty_rows(); //returns and clears the written rows
+#define VGA_ALL_ROWS 0x1FFFFFF //one bit for each of the 25 rows
 
 int32_t printf(int8_t *format, ...);
 void putc(uint8_t c);
@@ -36,6 +40,7 @@ void* memset_word(void* s, int32_t c, uint32_t n);
 void* memset_dword(void* s, int32_t c, uint32_t n);
 void* memcpy(void* dest, const void* src, uint32_t n);
 void* memmove(void* dest, const void* src, uint32_t n);
+int32_t memcmp(const void* s1, const void* s2, uint32_t n);
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n);
 int8_t* strcpy(int8_t* dest, const int8_t*src);
 int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
@@ -111,7 +116,7 @@ do {                                    \
 /* Writes four bytes to four consecutive ports */
 #define outl(data, port)                \
 do {                                    \
-    asm volatile ("outl %l1, (%w0)"     \
+    asm volatile ("outl %k1, (%w0)"     \
             :                           \
             : "d"(port), "a"(data)      \
             : "memory", "cc"            \
@@ -0,0 +1,93 @@
+/* lz4.c -- decoder for LZ4 compressed blocks
+ * vim:ts=4 noexpandtab
+ */
+
+#include "lz4.h"
+
+/*
+ * lz4_length
+ *   DESCRIPTION:	Finishes a literal or match length that did not fit in
+ *					its 4 bits of the token: bytes of 255 continue it.
+ *   INPUTS: 		const uint8_t** src : next input byte, moved past the length
+ *					const uint8_t* end : end of the input
+ *					uint32_t len : the length from the token, 15
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the length, or 0xFFFFFFFF if the input ends first
+ *   SIDE EFFECTS: 	none
+ */
+static uint32_t lz4_length(const uint8_t** src, const uint8_t* end, uint32_t len) {
+	uint8_t byte;
+
+	do {
+		if (*src == end)
+			return 0xFFFFFFFF;
+		byte = *(*src)++;
+		len += byte;
+	} while (byte == 255 && len < 0x80000000);
+	return len;
+}
+
+/*
+ * lz4_decompress
+ *   DESCRIPTION:	Decodes the sequences of an LZ4 block: each copies a run of
+ *					literals from the input, then a match from up to 64kB back
+ *					in the output. The last sequence has only literals. Every
+ *					length and offset is checked, so a corrupt block cannot
+ *					read or write out of bounds. Matches at least a word back
+ *					are copied a word at a time.
+ *   INPUTS: 		const uint8_t* src : the compressed block
+ *					uint32_t src_len : its length
+ *					uint32_t dst_len : room in dst
+ *   OUTPUTS:		uint8_t* dst : the decompressed data
+ *   RETURN VALUE: 	bytes decompressed, -1 for a corrupt block or one that
+ *					does not fit in dst
+ *   SIDE EFFECTS: 	none
+ */
+int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len) {
+	const uint8_t* in = src;
+	const uint8_t* in_end = src + src_len;
+	uint8_t* out = dst;
+	uint8_t* out_end = dst + dst_len;
+	const uint8_t* match;
+	uint32_t token, len, offset;
+
+	while (in < in_end) {
+		token = *in++;
+
+		// literals
+		len = token >> 4;
+		if (len == 15 && (len = lz4_length(&in, in_end, len)) == 0xFFFFFFFF)
+			return -1;
+		if (len > (uint32_t)(in_end - in) || len > (uint32_t)(out_end - out))
+			return -1;
+		for (; len >= 4; len -= 4, in += 4, out += 4)
+			*(uint32_t*)out = *(const uint32_t*)in;
+		while (len--)
+			*out++ = *in++;
+		if (in == in_end)
+			break;
+
+		// match
+		if (in_end - in < 2)
+			return -1;
+		offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > (uint32_t)(out - dst))
+			return -1;
+		len = token & 0xF;
+		if (len == 15 && (len = lz4_length(&in, in_end, len)) == 0xFFFFFFFF)
+			return -1;
+		len += LZ4_MIN_MATCH;
+		if (len > (uint32_t)(out_end - out))
+			return -1;
+		match = out - offset;
+		if (offset >= 4) {
+			for (; len >= 4; len -= 4, match += 4, out += 4)
+				*(uint32_t*)out = *(const uint32_t*)match;
+		}
+		// a match closer than a word repeats bytes just written
+		while (len--)
+			*out++ = *match++;
+	}
+	return out - dst;
+}
@@ -0,0 +1,17 @@
+/* lz4.h - Decoder for LZ4 compressed blocks
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _LZ4_H
+#define _LZ4_H
+
+#include "types.h"
+
+#define LZ4_MIN_MATCH		4						// shortest match a sequence encodes
+#define LZ4_MAX_OFFSET		65535					// farthest back a match reaches
+
+/* Decompresses one LZ4 block, the raw format without a frame header.
+ * Returns the bytes written to dst, -1 if src is corrupt or does not fit. */
+int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len);
+
+#endif /* _LZ4_H */
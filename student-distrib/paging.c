@@ -141,6 +141,24 @@ int create_user_4mb_page(int real_index, int virt_index) {
 	return 0;
 }
 
+/* remove_4mb_page
+ *
+ * Marks the page directory entry at index virt_index as not
+ * present again
+ *
+ * Inputs: virt_index -- index of the page in virt memory, 2-1023
+ * Returns: 0 for success, -1 for error
+ * Side effects: Updates page directory
+ */
+int remove_4mb_page(int virt_index) {
+	// OOB checks.  indexes <2 are used for the kernel
+	if (virt_index < 2 || virt_index >= PAGE_TABLE_SIZE)
+		return -1;
+
+	page_directory[virt_index].present = 0;
+	return 0;
+}
+
 /* create_vid_4kb_page
  *
  * Marks the page directory entry at index virt_index as
@@ -189,8 +207,12 @@ uint32_t create_vid_4kb_page() {
  * Inputs: int exec_term_id : the terminal being currently executed.
  * Returns: none
  * Side effects: Remaps executing terminal to physical display or the nondisplay buffer. 
+ *               Marks all of video memory dirty if a program wrote it through vidmap.
  */
 void remap_vid(int exec_term_id) {
+    // writes made through the old mapping must not be lost
+    if(take_vid_page_dirty())
+        mark_vga_dirty(0, NUM_ROWS - 1);
     if(exec_term_id == curr_term_id)
         vid_page_table_0[0].addr = 0x000B8; // remap to physical display (xB8000)
     else{
@@ -198,6 +220,25 @@ void remap_vid(int exec_term_id) {
     }
 }
 
+/* take_vid_page_dirty
+ *
+ * Description: Checks the dirty bit the processor sets in the vidmap page table
+ *              entry while it points at video memory, then clears it so the next
+ *              call only sees newer writes. The TLB entry is flushed so that the
+ *              processor sets the bit again on the next write.
+ *
+ * Inputs: None
+ * Returns: 1 if a user program wrote video memory since the last call, 0 otherwise
+ * Side effects: Clears the dirty bit and flushes the page from the TLB
+ */
+int take_vid_page_dirty() {
+    if(!vid_page_table_0[0].present || !vid_page_table_0[0].dirty)
+        return 0;
+    vid_page_table_0[0].dirty = 0;
+    asm volatile ("invlpg (%0)" : : "r" (VID_MAP_VIRTUAL_INDEX << 22) : "memory");
+    return vid_page_table_0[0].addr == 0x000B8;
+}
+
 /* setup_contorl_registers
  * Pushes the address of the page directory to cr3,
  * turns on 4M pages, and then turns on paging
@@ -64,6 +64,8 @@ void init_paging();
  * at real_index * 4MB and make the page in virt memroy at
  * virt_index * 4MB */
 int create_user_4mb_page(int real_index, int virt_index);
+/* function to mark the 4MB page at virt_index * 4MB not present */
+int remove_4mb_page(int virt_index);
 /* function to create a 4kb page that exists in real memory
  * at pde_index * 4MB + pte_index * 4kb and make the page in virt memory at
  * virt_index */
@@ -71,5 +73,7 @@ uint32_t create_vid_4kb_page();
 /* function to reload cr3 and clear the TLBs */
 void reload_cr3();
 void remap_vid(int exec_term_id);
+/* function to check and clear whether video memory was written through vidmap */
+int take_vid_page_dirty();
 
 #endif /* _PAGING_H */
@@ -0,0 +1,293 @@
+/* pipe.c -- anonymous pipes between processes
+ * vim:ts=4 noexpandtab
+ */
+
+#include "pipe.h"
+#include "lib.h"
+#include "uaccess.h"
+
+static pipe_t pipes[MAX_PIPES];
+
+static int32_t pipe_open(const uint8_t* filename){return -1;};
+static int32_t read_no_op(int32_t fd, void* buf, int32_t nbytes){return -1;};
+static int32_t write_no_op(int32_t fd, const void* buf, int32_t nbytes){return -1;};
+static int32_t ioctl_no_op(int32_t fd, int32_t cmd, int32_t arg){return -1;};
+
+/* Jump table for the read end of a pipe */
+fo_jump_table_t pipe_read_jump_table = {
+	pipe_open,
+	pipe_read,
+	write_no_op,
+	pipe_close,
+	pipe_poll,
+	ioctl_no_op
+};
+
+/* Jump table for the write end of a pipe */
+fo_jump_table_t pipe_write_jump_table = {
+	pipe_open,
+	read_no_op,
+	pipe_write,
+	pipe_close,
+	pipe_poll,
+	ioctl_no_op
+};
+
+/*
+ * end_is_live
+ *   DESCRIPTION:	Checks whether some process that can still run holds the
+ *					given end of a pipe. A process waiting in execute for its
+ *					child cannot touch its fds until the child halts, so its
+ *					ends do not count; otherwise a child writing into a pipe
+ *					only its parent reads from would sleep forever.
+ *   INPUTS: 		uint32_t index : pipe to check
+ *					fo_jump_table_t* end : jump table of the end to look for
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	1 if a runnable process holds the end, 0 otherwise
+ *   SIDE EFFECTS: 	none
+ */
+static int end_is_live(uint32_t index, fo_jump_table_t* end) {
+	pcb_t* pcb;
+	int pid, fd;
+
+	for (pid = 0; pid < MAX_NUM_PROCESSES; pid++) {
+		if (!processes[pid])
+			continue;
+		pcb = get_pcb_by_PID(pid);
+		if (pcb->child_pcb != NULL)
+			continue;
+		for (fd = 0; fd < FD_ARRAY_LEN; fd++) {
+			if (pcb->fd_array[fd].active && pcb->fd_array[fd].fo_jump_table_ptr == end
+			    && pcb->fd_array[fd].inode_index == index)
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * pipe_create
+ *   DESCRIPTION:	Takes a free pipe and points two fd entries at its ends.
+ *					The entries are marked active.
+ *   INPUTS: 		fd_entry_t* read_end : entry to hold the read end
+ *					fd_entry_t* write_end : entry to hold the write end
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0 on success, -1 if every pipe is in use
+ *   SIDE EFFECTS: 	none
+ */
+int32_t pipe_create(fd_entry_t* read_end, fd_entry_t* write_end) {
+	pipe_t* pipe;
+	uint32_t flags;
+	int i;
+
+	cli_and_save(flags);
+	for (i = 0; i < MAX_PIPES; i++) {
+		if (pipes[i].readers == 0 && pipes[i].writers == 0)
+			break;
+	}
+	if (i == MAX_PIPES) {
+		restore_flags(flags);
+		return -1;
+	}
+	pipe = &pipes[i];
+	pipe->head = pipe->tail = 0;
+	pipe->readers = pipe->writers = 1;
+	init_wait_queue(&pipe->read_wq);
+	init_wait_queue(&pipe->write_wq);
+	restore_flags(flags);
+
+	read_end->fo_jump_table_ptr = &pipe_read_jump_table;
+	write_end->fo_jump_table_ptr = &pipe_write_jump_table;
+	read_end->inode_index = write_end->inode_index = i;
+	read_end->file_position = write_end->file_position = 0;
+	read_end->flags = write_end->flags = 0;
+	read_end->active = write_end->active = 1;
+	return 0;
+}
+
+/*
+ * pipe_dup
+ *   DESCRIPTION:	Counts a copy of an fd entry made by dup2 or execute, so the
+ *					pipe stays open until every copy is closed.
+ *   INPUTS: 		fd_entry_t* entry : the new copy
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void pipe_dup(fd_entry_t* entry) {
+	if (!entry->active)
+		return;
+	if (entry->fo_jump_table_ptr == &pipe_read_jump_table)
+		pipes[entry->inode_index].readers++;
+	else if (entry->fo_jump_table_ptr == &pipe_write_jump_table)
+		pipes[entry->inode_index].writers++;
+}
+
+/*
+ * pipe_release
+ *   DESCRIPTION:	Drops the reference an fd entry holds on a pipe end and
+ *					wakes both sides, which may now see end of file or a
+ *					closed reader. A pipe with no ends left is free again.
+ *   INPUTS: 		fd_entry_t* entry : entry being closed
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void pipe_release(fd_entry_t* entry) {
+	pipe_t* pipe;
+
+	if (!entry->active)
+		return;
+	if (entry->fo_jump_table_ptr == &pipe_read_jump_table)
+		pipes[entry->inode_index].readers--;
+	else if (entry->fo_jump_table_ptr == &pipe_write_jump_table)
+		pipes[entry->inode_index].writers--;
+	else
+		return;
+	pipe = &pipes[entry->inode_index];
+	wake_up(&pipe->read_wq);
+	wake_up(&pipe->write_wq);
+}
+
+/*
+ * pipe_read
+ *   DESCRIPTION:	Copies buffered data straight from the ring into the
+ *					caller's buffer. Sleeps while the pipe is empty and a writer
+ *					that can still run holds the other end.
+ *   INPUTS: 		int32_t fd : read end of the pipe
+ *					void* buf : buffer to fill
+ *					int32_t nbytes : most bytes to read
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	bytes read, 0 at end of file, ERR_AGAIN if the pipe is
+ *					empty and fd is non-blocking, -1 if buf is bad
+ *   SIDE EFFECTS: 	May put the process to sleep
+ */
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes) {
+	uint32_t index = get_current_executing_pcb()->fd_array[fd].inode_index;
+	pipe_t* pipe = &pipes[index];
+	uint32_t count, start, first;
+
+	cli();
+	while (pipe->tail == pipe->head) {
+		if (!end_is_live(index, &pipe_write_jump_table)) {
+			sti();
+			return 0;
+		}
+		if (fd_is_nonblocking(fd)) {
+			sti();
+			return ERR_AGAIN;
+		}
+		sleep_on(&pipe->read_wq);
+	}
+
+	count = pipe->tail - pipe->head;
+	if (count > (uint32_t)nbytes)
+		count = nbytes;
+	// at most two pieces, before and after the end of the ring
+	start = pipe->head % PIPE_SIZE;
+	first = PIPE_SIZE - start < count ? PIPE_SIZE - start : count;
+	if (copy_to_user(buf, pipe->buf + start, first) != 0
+	    || copy_to_user((uint8_t*)buf + first, pipe->buf, count - first) != 0) {
+		sti();
+		return -1;
+	}
+	pipe->head += count;
+
+	wake_up(&pipe->write_wq);
+	sti();
+	return count;
+}
+
+/*
+ * pipe_write
+ *   DESCRIPTION:	Copies the caller's data straight into the ring, sleeping
+ *					whenever it is full until a reader makes room. Stops early
+ *					once no reader that can still run is left.
+ *   INPUTS: 		int32_t fd : write end of the pipe
+ *					const void* buf : data to write
+ *					int32_t nbytes : bytes to write
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	bytes written, -1 if nothing could be written because
+ *					there is no reader or buf is bad, ERR_AGAIN if the pipe
+ *					is full and fd is non-blocking
+ *   SIDE EFFECTS: 	May put the process to sleep
+ */
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes) {
+	uint32_t index = get_current_executing_pcb()->fd_array[fd].inode_index;
+	pipe_t* pipe = &pipes[index];
+	uint32_t count, start, first;
+	int32_t written = 0;
+
+	cli();
+	while (written < nbytes) {
+		if (!end_is_live(index, &pipe_read_jump_table)) {
+			sti();
+			return written ? written : -1;
+		}
+		if (pipe->tail - pipe->head == PIPE_SIZE) {
+			if (fd_is_nonblocking(fd)) {
+				sti();
+				return written ? written : ERR_AGAIN;
+			}
+			sleep_on(&pipe->write_wq);
+			continue;
+		}
+
+		count = PIPE_SIZE - (pipe->tail - pipe->head);
+		if (count > (uint32_t)(nbytes - written))
+			count = nbytes - written;
+		start = pipe->tail % PIPE_SIZE;
+		first = PIPE_SIZE - start < count ? PIPE_SIZE - start : count;
+		if (copy_from_user(pipe->buf + start, (uint8_t*)buf + written, first) != 0
+		    || copy_from_user(pipe->buf, (uint8_t*)buf + written + first, count - first) != 0) {
+			sti();
+			return written ? written : -1;
+		}
+		pipe->tail += count;
+		written += count;
+
+		wake_up(&pipe->read_wq);
+	}
+	sti();
+	return written;
+}
+
+/*
+ * pipe_close
+ *   DESCRIPTION:	Releases the current process's reference to a pipe end.
+ *   INPUTS: 		int32_t fd : end to close
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	0
+ *   SIDE EFFECTS: 	Wakes processes waiting on the pipe
+ */
+int32_t pipe_close(int32_t fd) {
+	pipe_release(&get_current_executing_pcb()->fd_array[fd]);
+	return 0;
+}
+
+/*
+ * pipe_poll
+ *   DESCRIPTION:	Reports whether a read or write on this end would return
+ *					without sleeping and registers the caller to be woken when
+ *					that changes.
+ *   INPUTS: 		int32_t fd : end to check
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	POLLIN for a read end with data or no writers left,
+ *					POLLOUT for a write end with room or no readers left
+ *   SIDE EFFECTS: 	Adds the current process to the pipe's wait queue
+ */
+int32_t pipe_poll(int32_t fd) {
+	fd_entry_t* entry = &get_current_executing_pcb()->fd_array[fd];
+	pipe_t* pipe = &pipes[entry->inode_index];
+
+	if (entry->fo_jump_table_ptr == &pipe_read_jump_table) {
+		if (pipe->tail != pipe->head || !end_is_live(entry->inode_index, &pipe_write_jump_table))
+			return POLLIN;
+		poll_wait(&pipe->read_wq);
+		return 0;
+	}
+	if (pipe->tail - pipe->head < PIPE_SIZE || !end_is_live(entry->inode_index, &pipe_read_jump_table))
+		return POLLOUT;
+	poll_wait(&pipe->write_wq);
+	return 0;
+}
@@ -0,0 +1,43 @@
+/* pipe.h - Anonymous pipes between processes
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _PIPE_H
+#define _PIPE_H
+
+#include "types.h"
+#include "syscall.h"
+#include "wait.h"
+
+#define PIPE_SIZE 4096          // bytes buffered in one pipe
+#define MAX_PIPES 4             // pipes open at once across all processes
+
+/* A pipe is a ring buffer with a read end and a write end. head and tail
+ * run freely and are reduced modulo PIPE_SIZE when indexing buf. */
+typedef struct pipe_t {
+	uint8_t buf[PIPE_SIZE];     // data written but not yet read
+	uint32_t head;              // next byte to read
+	uint32_t tail;              // next byte to write
+	int32_t readers;            // fds open on the read end, in any process
+	int32_t writers;            // fds open on the write end, in any process
+	wait_queue_t read_wq;       // readers waiting for data
+	wait_queue_t write_wq;      // writers waiting for space
+} pipe_t;
+
+/* Jump tables for the two ends of a pipe */
+fo_jump_table_t pipe_read_jump_table;
+fo_jump_table_t pipe_write_jump_table;
+
+/* Sets up a new pipe on two fd entries, returns -1 if every pipe is in use */
+int32_t pipe_create(fd_entry_t* read_end, fd_entry_t* write_end);
+/* Counts another reference to a pipe end after an fd entry was copied */
+void pipe_dup(fd_entry_t* entry);
+/* Drops the reference an fd entry holds, does nothing if it is not a pipe */
+void pipe_release(fd_entry_t* entry);
+
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t pipe_close(int32_t fd);
+int32_t pipe_poll(int32_t fd);
+
+#endif /* _PIPE_H */
@@ -1,7 +1,14 @@
 #include "rtc.h"
+#include "uaccess.h"
 
 /* Flag to tell us whether an interrupt is occuring. */
 volatile int flags[NUM_TERMINALS] = {0, 0, 0};
+/* Processes sleeping until the next RTC interrupt. */
+static wait_queue_t rtc_wq;
+/* Interrupts per second at the current rate. */
+static int32_t rtc_freq = DEFAULT_FREQ;
+/* Interrupts since the last alarm signal. */
+static int32_t alarm_ticks = 0;
 
 /*
  * init_rtc
@@ -40,6 +47,8 @@ void init_rtc() {
 	/* Set base frequency to 2. */
 	set_frequency(DEFAULT_FREQ);
 
+	init_wait_queue(&rtc_wq);
+
 	/* Enable IRQ line 8. */
 	enable_irq(RTC_IRQ);
 
@@ -94,6 +103,7 @@ void set_frequency(int32_t frequency) {
 
 	/* Write our rate at bottom 4 bits to A. */
 	outb((prev & 0xF0) | rate, RW_PORT);
+	rtc_freq = frequency;
 
 	/* Enable Interrupts. */
 	sti();
@@ -111,7 +121,7 @@ void set_frequency(int32_t frequency) {
  *   RETURN VALUE: 	none
  *   SIDE EFFECTS: 	Reads the status of register C to make sure any RTC
  *					interrupts that were pending before/while the RTC was
- *					initialized are acknowledged.
+ *					initialized are acknowledged. Sends the alarm signal.
  */
 void rtc_handler() {
 	/* Disable interrupts. */
@@ -129,6 +139,14 @@ void rtc_handler() {
 	flags[0] = 1;
 	flags[1] = 1;
 	flags[2] = 1;
+	wake_up(&rtc_wq);
+
+	/* Send the alarm signal every ALARM_SECONDS, whatever the rate is. */
+	alarm_ticks++;
+	if(alarm_ticks >= rtc_freq * ALARM_SECONDS) {
+		alarm_ticks = 0;
+		send_alarm();
+	}
 
 	/* Enable Interrupts. */
 	sti();
@@ -159,29 +177,53 @@ int32_t rtc_open(const uint8_t * filename) {
 /*
  * rtc_read
  *   DESCRIPTION:	Read call that always returns 0 only after an interrupt has
- *					occured which is why we set a flag and waits until the interrupt
- *					handler clears it and then returns 0.
- *   INPUTS: 		const uint32_t fd : not used
+ *					occured which is why we sleep until the interrupt handler
+ *					sets a flag, clear it and then return 0.
+ *   INPUTS: 		const uint32_t fd : checked for O_NONBLOCK
  * 					void* buf : not used
  *					int32_t nbytes : not used
  *   OUTPUTS:		none
  *   RETURN VALUE: 	int32_t : 0 indicates sucess
- *   SIDE EFFECTS: 	Resets the RTC interrupt flag to 0
+ *							  ERR_AGAIN if no interrupt occured and fd is non-blocking
+ *   SIDE EFFECTS: 	Resets the RTC interrupt flag to 0, may put the process to sleep
  */
 int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes) {
     if(buf == NULL || nbytes<0)
     	return -1;
     /* Wait for interrupt to occur.  */
+    cli();
     while(flags[exec_term_id] == 0){
-        //do nothing
+        if(fd_is_nonblocking(fd)){
+            sti();
+            return ERR_AGAIN;
+        }
+        sleep_on(&rtc_wq);
     }
     /* Set interrupt flag to 0 to indicate interrupt is done. */
     flags[exec_term_id] = 0;
+    sti();
 
     /* Return success.  */
     return 0; 
 }
 
+/*
+ * rtc_poll
+ *   DESCRIPTION:	Reports whether rtc_read would return without sleeping and
+ *					registers the caller to be woken by the next interrupt.
+ *   INPUTS: 		const uint32_t fd : not used
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	int32_t : POLLIN if an interrupt occured since the last read,
+ *							  always POLLOUT since writes never block
+ *   SIDE EFFECTS: 	Adds the current process to the RTC wait queue
+ */
+int32_t rtc_poll(int32_t fd) {
+    if(flags[exec_term_id])
+        return POLLIN | POLLOUT;
+    poll_wait(&rtc_wq);
+    return POLLOUT;
+}
+
 
 /*
  * rtc_write
@@ -198,14 +240,18 @@ int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes) {
  *   SIDE EFFECTS: 	Sets RTC interrupt frequency to desired frequency
  */
 int32_t rtc_write(int32_t fd, const void* buf, int32_t nbytes) {
-    
+    int32_t freq;
+
     /* Check if nbytes is a 4 byte integer and if buff is NULL. */
     if (nbytes != NUM_BYTES || buf == NULL) {
         return -1;
     }
 
     /*Set RTC rate to given frequency. */
-    set_frequency(*((int32_t*)buf));
+    if (copy_from_user(&freq, buf, sizeof(freq)) != 0) {
+        return -1;
+    }
+    set_frequency(freq);
 
     /* Return the number of bytes written. */
     return nbytes;
@@ -60,5 +60,7 @@ int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes);
 int32_t rtc_write(int32_t fd, const void* buf, int32_t nbytes);
 /* Closes the RTC. */    
 int32_t rtc_close(int32_t fd);
+/* Reports whether the RTC can be read without blocking. */
+int32_t rtc_poll(int32_t fd);
 
 #endif /* _RTC_H */
@@ -1,6 +1,10 @@
 #include "scheduler.h"
+#include "shm.h"
 #define USER_PD_INDEX 32
 
+/* Set while schedule halts waiting for a process to wake up. */
+static volatile int idling = 0;
+
 /*
  * init_pit
  *   DESCRIPTION: 	Initializes the PIT (programable interrupt handler). We first set to PIT
@@ -27,6 +31,9 @@ void init_pit() {
 	/* Send upper 8 bits of frequency. */
 	outb(FREQ_10MILI >> EIGHT, CHANNEL_0);
 
+	pit_ticks = 0;
+	init_timers();
+
 	/* Enable IRQ line 0. */
 	enable_irq(PIT_IRQ);
 
@@ -36,59 +43,136 @@ void init_pit() {
 
 /*
  * pit_handler
- *   DESCRIPTION: 	Obtains the next executing user program on each next terminal window,
- *					creates a user 4mb page and then remaps the executing terminal. After
- * 					that we update the tss, ebp, and esp in order to take advantage of the
- *					context switch.
+ *   DESCRIPTION: 	Counts the tick, runs the timers that are due and
+ *					hands the processor to the next runnable process. Does not reschedule while the processor is idling
+ *					inside schedule, which picks up the woken task by itself.
  *   INPUTS: 		none
  *   OUTPUTS: 		none
  *   RETURN VALUE: 	none
- *   SIDE EFFECTS: 	Effectivly sets up a "round robin" to execute programs on all three
- *					terminals every 10 miliseconds.
+ *   SIDE EFFECTS: 	Effectivly sets up a "round robin" to execute every program
+ *					for 10 miliseconds at a time.
  */
 void pit_handler() {
 	send_eoi(PIT_IRQ);
 
-	//get curr_pcb
-	pcb_t* curr_pcb = get_current_executing_pcb();
-	//remap video to nondisplay
-	// remap_vid(exec_term_id);
-	// reload_cr3();
+	pit_ticks++;
+	run_timers();
 
-	//save ebp and esp
-	asm volatile("			\n\
-		movl %%ebp, %0 		\n\
-		movl %%esp, %1 		\n\
-		"
-		: "=g" (curr_pcb->return_ebp), "=g" (curr_pcb->return_esp)
-	);
+	if (!idling)
+		schedule();
+}
+
+/*
+ * next_runnable_pid
+ *   DESCRIPTION: 	Finds the next process for the scheduler, round robin by PID
+ *					starting after the running one and ending with it. A process
+ *					waiting in execute for its child is not runnable.
+ *   INPUTS: 		none
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	PID of a runnable process, -1 if all are asleep
+ *   SIDE EFFECTS: 	none
+ */
+static int next_runnable_pid() {
+	pcb_t* pcb;
+	int i, pid;
+
+	for (i = 1; i <= MAX_NUM_PROCESSES; i++) {
+		pid = (current_pid + i) % MAX_NUM_PROCESSES;
+		if (!processes[pid])
+			continue;
+		pcb = get_pcb_by_PID(pid);
+		if (pcb->state == TASK_RUNNING && pcb->child_pcb == NULL)
+			return pid;
+	}
+	return -1;
+}
+
+/*
+ * schedule
+ *   DESCRIPTION: 	Picks the next runnable process, on any terminal, creates its
+ *					user 4mb page and then remaps video memory for its terminal.
+ *					After that we update the tss and switch kernel stacks. Every
+ *					process gets a turn, so background jobs on one terminal run
+ *					alongside its foreground program. If every program is asleep
+ *					we halt until an interrupt wakes one up; the current process
+ *					may be the one that wakes.
+ *   INPUTS: 		none
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Changes the executing process and terminal, paging and the tss
+ */
+void schedule() {
+	pcb_t* prev_pcb;
+	pcb_t* next_pcb;
+	uint32_t flags;
+	int pid;
 
-	//get new exec_term_id and pcb
-	next_executing_term();
-	curr_pcb = get_current_executing_pcb();
+	cli_and_save(flags);
+	prev_pcb = get_current_executing_pcb();
+
+	//wait for something to become runnable
+	while ((pid = next_runnable_pid()) < 0) {
+		idling = 1;
+		asm volatile("sti; hlt; cli" ::: "memory");
+		idling = 0;
+	}
+
+	if (pid == current_pid) {
+		restore_flags(flags);
+		return;
+	}
+
+	//get new process and its terminal
+	set_current(pid);
+	next_pcb = get_current_executing_pcb();
+	exec_term_id = next_pcb->term_id;
 	//remap user program page
-	create_user_4mb_page(curr_pcb->process_id + 2, USER_PD_INDEX);
+	create_user_4mb_page(next_pcb->process_id + 2, USER_PD_INDEX);
+	remap_shm(next_pcb->process_id);
 	reload_cr3();
 	//remap video to nondisplay
 	remap_vid(exec_term_id);
 	reload_cr3();
 
 	//save esp0 and kernel stack segment
-	tss.esp0 = (uint32_t)(get_pcb_by_PID(curr_pcb->process_id - 1)) - 4;
+	tss.esp0 = get_kernel_stack_by_PID(next_pcb->process_id);
 	tss.ss0 = KERNEL_DS;
 
-	//return to next function
+	switch_context(&prev_pcb->return_esp, next_pcb->return_esp);
+
+	restore_flags(flags);
+}
+
+/*
+ * switch_context
+ *   DESCRIPTION: 	Pushes the callee saved registers and a resume address on the
+ *					current kernel stack, saves the stack pointer and loads the
+ *					stack of another process saved the same way. Returns when
+ *					some later call switches back to the saved stack.
+ *   INPUTS: 		uint32_t* prev_esp : where to save the current stack pointer
+ *					uint32_t next_esp : stack pointer to resume
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Runs another process
+ */
+void switch_context(uint32_t* prev_esp, uint32_t next_esp) {
 	asm volatile("			\n\
-		movl %0, %%ebp 		\n\
+		pushl $1f 			\n\
+		pushl %%ebp 		\n\
+		pushl %%ebx 		\n\
+		pushl %%esi 		\n\
+		pushl %%edi 		\n\
+		movl %%esp, (%0) 	\n\
 		movl %1, %%esp 		\n\
-		leave				\n\
+		popl %%edi 			\n\
+		popl %%esi 			\n\
+		popl %%ebx 			\n\
+		popl %%ebp 			\n\
 		ret 				\n\
+	1: 						\n\
 		"
+		: "+a" (prev_esp), "+c" (next_esp)
 		:
-		: "r" (curr_pcb->return_ebp), "r" (curr_pcb->return_esp)
+		: "edx", "memory", "cc"
 	);
-	
-	return;	
 }
-
-
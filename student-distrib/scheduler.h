@@ -6,6 +6,8 @@
 #include "types.h"
 #include "syscall.h"
 #include "terminal.h"
+#include "wait.h"
+#include "timer.h"
 
 #define		PIT_IRQ 	0
 #define 	CHANNEL_0	0x40         //Channel 0 data port (read/write)
@@ -19,11 +21,19 @@
 #define 	EIGHT 		8			 //Value of 8
 
 #define 	NUM_TERMINALS 3			 //number of terminals
+#define 	PIT_TICK_MS	10			 //milliseconds between PIT interrupts
 
 /* Initializes the PIT. */
 void init_pit();
 /* Code for pit interruption and handels scheduling. */
 void pit_handler();
+/* Switches to the next runnable process, idling if there is none. */
+void schedule();
+/* Saves the kernel context of one process and resumes another. */
+void switch_context(uint32_t* prev_esp, uint32_t next_esp);
+
+/* number of PIT interrupts since boot */
+volatile uint32_t pit_ticks;
 
 #endif /* _SCHEDULER_H */
 
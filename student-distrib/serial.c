@@ -0,0 +1,221 @@
+/* serial.c -- 16550 UART driver for COM1
+ * vim:ts=4 noexpandtab
+ */
+
+#include "serial.h"
+#include "ldisc.h"
+
+/* Transmit ring buffer, drained by the THR empty interrupt. */
+static uint8_t tx_buf[SERIAL_TX_BUF_SIZE];
+static volatile uint32_t tx_head = 0;			// next byte to send
+static volatile uint32_t tx_tail = 0;			// next free slot
+/* Set when the THR empty interrupt is armed and will drain the ring. */
+static volatile int tx_busy = 0;
+/* Set once the UART passed its loopback self test. */
+static int serial_present = 0;
+
+/*
+ * init_serial
+ *   DESCRIPTION:	Initializes COM1 at 115200 baud 8N1 with the 16 byte FIFOs
+ *					enabled. The chip is first checked in loopback mode so that
+ *					a missing UART never blocks console output. Receive
+ *					interrupts are always on, transmit interrupts are only armed
+ *					while the transmit ring has data in it.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Initializes COM1, enables IRQ 4 and sets the console mode
+ */
+void init_serial() {
+	cli();
+
+	/* Disable all UART interrupts while programming it. */
+	outb(0x00, COM1_PORT + UART_IER);
+
+	/* Set the baud rate divisor. */
+	outb(LCR_DLAB, COM1_PORT + UART_LCR);
+	outb(BAUD_DIVISOR & 0xFF, COM1_PORT + UART_DLL);
+	outb(BAUD_DIVISOR >> 8, COM1_PORT + UART_DLM);
+
+	/* 8 bits, no parity, one stop bit, clears DLAB. */
+	outb(LCR_8N1, COM1_PORT + UART_LCR);
+
+	/* Enable and clear the FIFOs. */
+	outb(FCR_ENABLE_CLEAR, COM1_PORT + UART_FCR);
+
+	/* Loop a byte back to make sure there is a UART on the port. */
+	outb(MCR_LOOPBACK, COM1_PORT + UART_MCR);
+	outb(SERIAL_TEST_BYTE, COM1_PORT + UART_DATA);
+	if (inb(COM1_PORT + UART_DATA) != SERIAL_TEST_BYTE) {
+		serial_present = 0;
+		serial_console_mode = SERIAL_CONSOLE_OFF;
+		sti();
+		return;
+	}
+
+	/* Normal operation, OUT2 routes the interrupt to the PIC. */
+	outb(MCR_DTR_RTS_OUT2, COM1_PORT + UART_MCR);
+	outb(IER_RX_AVAIL, COM1_PORT + UART_IER);
+
+	tx_head = 0;
+	tx_tail = 0;
+	tx_busy = 0;
+	serial_present = 1;
+	serial_console_mode = SERIAL_CONSOLE_DEFAULT;
+
+	enable_irq(SERIAL_IRQ);
+
+	sti();
+}
+
+/*
+ * serial_fill_fifo
+ *   DESCRIPTION:	Moves up to a FIFO's worth of bytes from the transmit ring
+ *					into the UART. Disarms the THR empty interrupt once the ring
+ *					runs dry. Must be called with interrupts disabled.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Writes to the UART data register
+ */
+static void serial_fill_fifo() {
+	int i;
+
+	for (i = 0; i < UART_TX_FIFO_SIZE && tx_head != tx_tail; i++) {
+		outb(tx_buf[tx_head], COM1_PORT + UART_DATA);
+		tx_head = (tx_head + 1) & SERIAL_TX_BUF_MASK;
+	}
+
+	if (tx_head == tx_tail) {
+		tx_busy = 0;
+		outb(IER_RX_AVAIL, COM1_PORT + UART_IER);
+	} else {
+		tx_busy = 1;
+		outb(IER_RX_AVAIL | IER_TX_EMPTY, COM1_PORT + UART_IER);
+	}
+}
+
+/*
+ * serial_handler
+ *   DESCRIPTION:	Called by the serial wrapper whenever COM1 raises IRQ 4.
+ *					Services every pending UART interrupt: received bytes are
+ *					handed to the line discipline as if they were typed on
+ *					the displayed terminal, and an empty transmit FIFO is
+ *					refilled from the transmit ring.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Drains the RX FIFO and refills the TX FIFO
+ */
+void serial_handler() {
+	uint8_t iir;
+
+	while (!((iir = inb(COM1_PORT + UART_IIR)) & IIR_NO_INT)) {
+		switch (iir & IIR_ID_MASK) {
+			case IIR_RX_AVAIL:
+			case IIR_RX_TIMEOUT:
+				while (inb(COM1_PORT + UART_LSR) & LSR_DATA_READY)
+					ldisc_receive(inb(COM1_PORT + UART_DATA));
+				break;
+			case IIR_TX_EMPTY:
+				serial_fill_fifo();
+				break;
+			case IIR_LINE_STATUS:
+				/* Reading LSR acknowledges the error. */
+				inb(COM1_PORT + UART_LSR);
+				break;
+			default:
+				break;
+		}
+	}
+
+	send_eoi(SERIAL_IRQ);
+}
+
+/*
+ * serial_putc
+ *   DESCRIPTION:	Queues a character on the transmit ring. Newlines are sent as
+ *					CR LF so the output reads correctly on a host terminal. If
+ *					the ring is full we fall back to polling the UART for space,
+ *					so no output is ever dropped.
+ *   INPUTS: 		uint8_t c : character to send
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	May arm the THR empty interrupt
+ */
+void serial_putc(uint8_t c) {
+	uint32_t flags;
+
+	if (!serial_present)
+		return;
+
+	if (c == '\n')
+		serial_putc('\r');
+
+	cli_and_save(flags);
+
+	/* Ring is full: push the oldest byte out by hand to make room. */
+	if (((tx_tail + 1) & SERIAL_TX_BUF_MASK) == tx_head) {
+		while (!(inb(COM1_PORT + UART_LSR) & LSR_THR_EMPTY));
+		outb(tx_buf[tx_head], COM1_PORT + UART_DATA);
+		tx_head = (tx_head + 1) & SERIAL_TX_BUF_MASK;
+	}
+
+	tx_buf[tx_tail] = c;
+	tx_tail = (tx_tail + 1) & SERIAL_TX_BUF_MASK;
+
+	/* Kick the transmitter if it is idle, the interrupt does the rest. */
+	if (!tx_busy && (inb(COM1_PORT + UART_LSR) & LSR_THR_EMPTY))
+		serial_fill_fifo();
+
+	restore_flags(flags);
+}
+
+/*
+ * serial_set_console_mode
+ *   DESCRIPTION:	Selects whether console output stays on VGA, is mirrored to
+ *					COM1, or goes to COM1 only. Ignored without a UART so we can
+ *					never lose the console.
+ *   INPUTS: 		int mode : SERIAL_CONSOLE_OFF, _MIRROR or _ONLY
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Changes where putc sends characters
+ */
+void serial_set_console_mode(int mode) {
+	if (!serial_present || mode < SERIAL_CONSOLE_OFF || mode > SERIAL_CONSOLE_ONLY)
+		return;
+	serial_console_mode = mode;
+}
+
+/*
+ * serial_parse_cmdline
+ *   DESCRIPTION:	Looks for "serial=off", "serial=mirror" or "serial=only" in
+ *					the multiboot command line, at its start or after a space,
+ *					and sets the console mode.
+ *   INPUTS: 		const int8_t* cmdline : NUL terminated kernel command line
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	May change the console mode
+ */
+void serial_parse_cmdline(const int8_t* cmdline) {
+	const int8_t* start = cmdline;
+	const int8_t* opt;
+
+	if (cmdline == NULL)
+		return;
+
+	for (; *cmdline != '\0'; cmdline++) {
+		// only a whole word, not the end of another option
+		if ((cmdline != start && cmdline[-1] != ' ')
+		   || strncmp(cmdline, (int8_t*)"serial=", 7) != 0)	// 7 is strlen("serial=")
+			continue;
+		opt = cmdline + 7;
+		if (strncmp(opt, (int8_t*)"off", 3) == 0)
+			serial_set_console_mode(SERIAL_CONSOLE_OFF);
+		else if (strncmp(opt, (int8_t*)"mirror", 6) == 0)
+			serial_set_console_mode(SERIAL_CONSOLE_MIRROR);
+		else if (strncmp(opt, (int8_t*)"only", 4) == 0)
+			serial_set_console_mode(SERIAL_CONSOLE_ONLY);
+		return;
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef _SERIAL_H
+#define _SERIAL_H
+
+#include "types.h"
+#include "lib.h"
+#include "i8259.h"
+
+#define SERIAL_IRQ			4			// COM1 sits on IRQ 4 of the master PIC
+#define COM1_PORT			0x3F8		// base I/O port of COM1
+
+/* 16550 register offsets from the base port */
+#define UART_DATA			0			// RX/TX holding register (DLAB = 0)
+#define UART_IER			1			// interrupt enable register (DLAB = 0)
+#define UART_IIR			2			// interrupt identification register (read)
+#define UART_FCR			2			// FIFO control register (write)
+#define UART_LCR			3			// line control register
+#define UART_MCR			4			// modem control register
+#define UART_LSR			5			// line status register
+#define UART_DLL			0			// divisor latch low byte (DLAB = 1)
+#define UART_DLM			1			// divisor latch high byte (DLAB = 1)
+
+/* register bits */
+#define IER_RX_AVAIL		0x01		// interrupt when received data is available
+#define IER_TX_EMPTY		0x02		// interrupt when the transmit holding register empties
+#define LCR_8N1				0x03		// 8 data bits, no parity, 1 stop bit
+#define LCR_DLAB			0x80		// divisor latch access bit
+#define FCR_ENABLE_CLEAR	0xC7		// enable and clear FIFOs, 14 byte RX trigger
+#define MCR_DTR_RTS_OUT2	0x0B		// DTR, RTS and OUT2 (OUT2 gates the IRQ line)
+#define MCR_LOOPBACK		0x1E		// loopback mode used for the self test
+#define LSR_DATA_READY		0x01		// a byte is waiting in the RX FIFO
+#define LSR_THR_EMPTY		0x20		// transmit holding register is empty
+#define IIR_NO_INT			0x01		// no interrupt pending
+#define IIR_ID_MASK			0x0E		// interrupt id bits
+#define IIR_TX_EMPTY		0x02		// THR empty interrupt
+#define IIR_RX_AVAIL		0x04		// received data available interrupt
+#define IIR_RX_TIMEOUT		0x0C		// character timeout interrupt
+#define IIR_LINE_STATUS		0x06		// line status interrupt
+
+#define UART_TX_FIFO_SIZE	16			// bytes we may load per THR empty interrupt
+#define BAUD_DIVISOR		1			// 115200 / 1 = 115200 baud
+#define SERIAL_TEST_BYTE	0xAE		// byte looped back during the self test
+
+/* transmit ring buffer, must be a power of two */
+#define SERIAL_TX_BUF_SIZE	4096
+#define SERIAL_TX_BUF_MASK	(SERIAL_TX_BUF_SIZE - 1)
+
+/* console modes: where printf and terminal_write output goes */
+#define SERIAL_CONSOLE_OFF		0		// VGA only
+#define SERIAL_CONSOLE_MIRROR	1		// VGA and COM1
+#define SERIAL_CONSOLE_ONLY		2		// COM1 replaces VGA
+#define SERIAL_CONSOLE_DEFAULT	SERIAL_CONSOLE_MIRROR
+
+/* kernel.c calls this to initialize COM1. */
+extern void init_serial();
+/* called by wrapper when a COM1 interrupt has occured. */
+extern void serial_handler();
+/* queues a character for transmission on COM1. */
+void serial_putc(uint8_t c);
+/* selects whether console output is mirrored to or replaced by COM1. */
+void serial_set_console_mode(int mode);
+/* parses a "serial=off|mirror|only" option out of the kernel command line. */
+void serial_parse_cmdline(const int8_t* cmdline);
+
+/* current console mode, read by putc on every character */
+volatile int serial_console_mode;
+
+#endif /* _SERIAL_H */
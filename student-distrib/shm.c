@@ -0,0 +1,154 @@
+/* shm.c -- shared memory segments between processes
+ * vim:ts=4 noexpandtab
+ */
+
+#include "shm.h"
+#include "syscall.h"
+#include "paging.h"
+#include "lib.h"
+
+/* frames right after the 4MB pages of the last possible process */
+#define SHM_PHYS_BASE ((MAX_NUM_PROCESSES + 2) << 22)
+#define SHM_PAGE_SHIFT 12
+#define SHM_PAGES_PER_WINDOW 1024
+
+static shm_segment_t segments[SHM_MAX_SEGMENTS];
+
+/* one page table for each process's view of the window */
+static pte_t shm_page_tables[MAX_NUM_PROCESSES][SHM_PAGES_PER_WINDOW] __attribute__((aligned (4096)));
+
+/*
+ * shm_create
+ *   DESCRIPTION:	Returns the segment registered under key, creating it if
+ *					there is none. Either way the current process holds a
+ *					reference until it halts, so a producer may create a
+ *					segment before its consumer attaches.
+ *   INPUTS: 		int32_t key : name shared by the processes
+ *					uint32_t size : bytes wanted, rounded up to whole pages
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	segment id, -1 if size is 0 or too large, an existing
+ *					segment is smaller, or every segment is in use
+ *   SIDE EFFECTS: 	none
+ */
+int32_t shm_create(int32_t key, uint32_t size) {
+	uint32_t pages = (size + SHM_PAGE_SIZE - 1) / SHM_PAGE_SIZE;
+	int pid = get_current_executing_pcb()->process_id;
+	int32_t id, free_id = -1;
+
+	if (size == 0 || pages > SHM_MAX_PAGES)
+		return -1;
+
+	for (id = 0; id < SHM_MAX_SEGMENTS; id++) {
+		if (segments[id].pages == 0) {
+			if (free_id < 0)
+				free_id = id;
+		} else if (segments[id].key == key) {
+			if (segments[id].pages < pages)
+				return -1;
+			segments[id].refs |= 1 << pid;
+			return id;
+		}
+	}
+	if (free_id < 0)
+		return -1;
+
+	segments[free_id].key = key;
+	segments[free_id].pages = pages;
+	segments[free_id].refs = 1 << pid;
+	segments[free_id].fresh = 1;
+	return free_id;
+}
+
+/*
+ * shm_attach
+ *   DESCRIPTION:	Maps every frame of a segment into the current process,
+ *					starting at addr. Processes may attach the same segment at
+ *					different addresses.
+ *   INPUTS: 		int32_t id : segment from shm_create
+ *					void* addr : page aligned address inside the window
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	addr, -1 if the id is bad or the range is not free
+ *   SIDE EFFECTS: 	Changes the current process's page table, flushes the TLB
+ */
+int32_t shm_attach(int32_t id, void* addr) {
+	int pid = get_current_executing_pcb()->process_id;
+	pte_t* table = shm_page_tables[pid];
+	uint32_t first, i;
+
+	if (id < 0 || id >= SHM_MAX_SEGMENTS || segments[id].pages == 0)
+		return -1;
+	if ((uint32_t)addr & (SHM_PAGE_SIZE - 1) || (uint32_t)addr < SHM_WINDOW_START
+	    || (uint32_t)addr + segments[id].pages * SHM_PAGE_SIZE > SHM_WINDOW_END)
+		return -1;
+
+	first = ((uint32_t)addr - SHM_WINDOW_START) >> SHM_PAGE_SHIFT;
+	for (i = 0; i < segments[id].pages; i++) {
+		if (table[first + i].present)
+			return -1;
+	}
+
+	for (i = 0; i < segments[id].pages; i++) {
+		table[first + i].val = 0;
+		table[first + i].addr = (SHM_PHYS_BASE >> SHM_PAGE_SHIFT) + id * SHM_MAX_PAGES + i;
+		table[first + i].privilege_level = 1; // User level priv
+		table[first + i].rw = 1; // set as read write
+		table[first + i].present = 1; // Mark this page as present
+	}
+	segments[id].refs |= 1 << pid;
+	remap_shm(pid);
+	reload_cr3();
+
+	// a segment never attached before may hold an old owner's data
+	if (segments[id].fresh) {
+		memset(addr, 0, segments[id].pages * SHM_PAGE_SIZE);
+		segments[id].fresh = 0;
+	}
+	return (int32_t)addr;
+}
+
+/*
+ * remap_shm
+ *   DESCRIPTION:	Points the window's page directory entry at the page table
+ *					of a process, or marks it not present if the process has
+ *					nothing attached. The caller reloads cr3.
+ *   INPUTS: 		int pid : process about to run
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Updates page directory
+ */
+void remap_shm(int pid) {
+	int id;
+
+	for (id = 0; id < SHM_MAX_SEGMENTS; id++) {
+		if (segments[id].refs & (1 << pid))
+			break;
+	}
+	page_directory[SHM_PD_INDEX].val = 0;
+	if (id == SHM_MAX_SEGMENTS)
+		return;
+	page_directory[SHM_PD_INDEX].addr = ((uint32_t)shm_page_tables[pid] & 0xFFFFF000) >> SHM_PAGE_SHIFT;
+	page_directory[SHM_PD_INDEX].privilege_level = 1; // User level priv
+	page_directory[SHM_PD_INDEX].rw = 1; // Set as read/write
+	page_directory[SHM_PD_INDEX].present = 1;  // Mark this page as present
+}
+
+/*
+ * shm_release
+ *   DESCRIPTION:	Drops the references a halting process holds and clears its
+ *					page table. A segment nobody holds becomes free.
+ *   INPUTS: 		int pid : process that is halting
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Unmaps the window if pid is running, the caller reloads cr3
+ */
+void shm_release(int pid) {
+	int id;
+
+	for (id = 0; id < SHM_MAX_SEGMENTS; id++) {
+		segments[id].refs &= ~(1 << pid);
+		if (segments[id].refs == 0)
+			segments[id].pages = 0;
+	}
+	memset(shm_page_tables[pid], 0, sizeof(shm_page_tables[pid]));
+	page_directory[SHM_PD_INDEX].val = 0;
+}
@@ -0,0 +1,36 @@
+/* shm.h - Shared memory segments between processes
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _SHM_H
+#define _SHM_H
+
+#include "types.h"
+
+#define SHM_PD_INDEX 34                         // 136MB, window segments are attached in
+#define SHM_WINDOW_START (SHM_PD_INDEX << 22)
+#define SHM_WINDOW_END ((SHM_PD_INDEX + 1) << 22)
+#define SHM_PAGE_SIZE 4096
+#define SHM_MAX_SEGMENTS 8                      // segments that may exist at once
+#define SHM_MAX_PAGES 64                        // pages in the largest segment, 256KB
+
+/* A segment is a fixed run of physical frames after the last program page.
+ * It lives while any process holds a reference from shm_create or
+ * shm_attach, and is zeroed the first time it is attached. */
+typedef struct shm_segment_t {
+	int32_t key;                                // name processes look it up by
+	uint32_t pages;                             // size in 4KB pages, 0 if unused
+	uint32_t refs;                              // one bit for each PID holding it
+	uint32_t fresh;                             // not yet zeroed
+} shm_segment_t;
+
+/* Finds or creates the segment with a key, returns its id */
+int32_t shm_create(int32_t key, uint32_t size);
+/* Maps a segment into the current process at a page aligned address */
+int32_t shm_attach(int32_t id, void* addr);
+/* Points the shared memory window at a process's mappings, call before reload_cr3 */
+void remap_shm(int pid);
+/* Drops every segment a process holds and unmaps them */
+void shm_release(int pid);
+
+#endif /* _SHM_H */
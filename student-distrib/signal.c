@@ -0,0 +1,203 @@
+/* signal.c -- delivering signals to user programs
+ * vim:ts=4 noexpandtab
+ */
+
+#include "signal.h"
+#include "syscall.h"
+#include "uaccess.h"
+
+#define USER_RPL		3						// privilege level of user code
+#define RPL_MASK		0x3						// privilege bits of a selector
+#define SYS_SIGRETURN	10
+
+/* movl $SYS_SIGRETURN, %eax; int $0x80; nop */
+static const uint8_t trampoline_code[sizeof(((sigframe_t*)0)->trampoline)] = {
+	0xB8, SYS_SIGRETURN, 0x00, 0x00, 0x00, 0xCD, 0x80, 0x90
+};
+
+/*
+ * default_kills
+ *   DESCRIPTION:	Tells whether a signal without a handler kills the process.
+ *					Exceptions and Ctrl+C do, ALARM and USER1 are ignored.
+ *   INPUTS: 		int32_t signum : signal number
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	1 if the default action is to kill, 0 to ignore
+ *   SIDE EFFECTS: 	none
+ */
+static int default_kills(int32_t signum) {
+	return signum == SIG_DIV_ZERO || signum == SIG_SEGFAULT || signum == SIG_INTERRUPT;
+}
+
+/*
+ * init_signals
+ *   DESCRIPTION:	Sets up the signal state of a new program: nothing pending,
+ *					nothing masked and the default action for every signal.
+ *   INPUTS: 		pcb_t* pcb : process to reset
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void init_signals(pcb_t* pcb) {
+	int i;
+
+	pcb->sig_pending = 0;
+	pcb->sig_masked = 0;
+	for (i = 0; i < NUM_SIGNALS; i++)
+		pcb->sig_handlers[i] = NULL;
+}
+
+/*
+ * send_signal
+ *   DESCRIPTION:	Marks a signal pending on a process. Signals the process
+ *					ignores are dropped here, so they never wake it. A sleeping
+ *					process is woken so that a fatal signal can kill it from
+ *					sleep_current; the sleep it was in restarts otherwise and
+ *					the handler runs when the system call returns.
+ *   INPUTS: 		pcb_t* pcb : process to signal
+ *					int32_t signum : signal number
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	May make the process runnable
+ */
+void send_signal(pcb_t* pcb, int32_t signum) {
+	uint32_t flags;
+
+	if (signum < 0 || signum >= NUM_SIGNALS)
+		return;
+	if (pcb->sig_handlers[signum] == NULL && !default_kills(signum))
+		return;
+
+	cli_and_save(flags);
+	pcb->sig_pending |= 1 << signum;
+	if (pcb->state == TASK_SLEEPING)
+		pcb->state = TASK_RUNNING;
+	restore_flags(flags);
+}
+
+/*
+ * send_alarm
+ *   DESCRIPTION:	Sends ALARM to every process that is running or asleep.
+ *					Called by the RTC handler every ALARM_SECONDS.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void send_alarm() {
+	pcb_t* pcb;
+	int pid;
+
+	for (pid = 0; pid < MAX_NUM_PROCESSES; pid++) {
+		if (!processes[pid])
+			continue;
+		pcb = get_pcb_by_PID(pid);
+		if (pcb->state == TASK_RUNNING || pcb->state == TASK_SLEEPING)
+			send_signal(pcb, SIG_ALARM);
+	}
+}
+
+/*
+ * signals_pending
+ *   DESCRIPTION:	Checks whether the current process has a signal pending
+ *					that deliver_signals would act on. SYSEXIT cannot enter a
+ *					handler, so the fast system call path returns through
+ *					the iret path when this is set.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	nonzero if a signal is pending and signals are not masked
+ *   SIDE EFFECTS: 	none
+ */
+int32_t signals_pending() {
+	pcb_t* current = get_current_executing_pcb();
+
+	return current->sig_pending != 0 && !current->sig_masked;
+}
+
+/*
+ * deliver_signals
+ *   DESCRIPTION:	Runs on the way out of every interrupt, exception and int
+ *					$0x80 system call, with interrupts off. When returning to
+ *					user mode with a signal pending, either kills the process
+ *					or pushes a sigframe_t on the user stack and changes the
+ *					saved context so that iret enters the handler. Signals
+ *					stay masked until the handler calls sigreturn.
+ *   INPUTS: 		hw_context_t* context : registers the wrapper will restore
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Writes to the user stack, may halt the process
+ */
+void deliver_signals(hw_context_t* context) {
+	pcb_t* current;
+	sigframe_t* frame;
+	sigframe_t kframe;
+	int32_t signum;
+
+	if ((context->cs & RPL_MASK) != USER_RPL)
+		return;
+	current = get_current_executing_pcb();
+	if (current->sig_masked || current->sig_pending == 0)
+		return;
+
+	for (signum = 0; signum < NUM_SIGNALS; signum++) {
+		if (!(current->sig_pending & (1 << signum)))
+			continue;
+		current->sig_pending &= ~(1 << signum);
+
+		if (current->sig_handlers[signum] == NULL) {
+			if (default_kills(signum))
+				halt(255);
+			continue;
+		}
+
+		frame = (sigframe_t*)((context->esp - sizeof(sigframe_t)) & ~0x3);
+		memcpy(kframe.trampoline, trampoline_code, sizeof(kframe.trampoline));
+		kframe.context = *context;
+		kframe.signum = signum;
+		kframe.ret_addr = (uint32_t)frame->trampoline;
+		if (context->esp < sizeof(sigframe_t)
+		   || copy_to_user(frame, &kframe, sizeof(kframe)) != 0)
+			halt(255);		// no room for the frame, the program cannot go on
+
+		context->esp = (uint32_t)frame;
+		context->eip = (uint32_t)current->sig_handlers[signum];
+		current->sig_masked = 1;
+		return;
+	}
+}
+
+/*
+ * handle_fatal_signals
+ *   DESCRIPTION:	Kills the current process if a pending signal has no handler
+ *					and kills by default. Called after a process wakes, so that
+ *					Ctrl+C ends a program blocked in a read.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	May halt the process
+ */
+void handle_fatal_signals() {
+	pcb_t* current = get_current_executing_pcb();
+	int32_t signum;
+
+	for (signum = 0; signum < NUM_SIGNALS; signum++) {
+		if ((current->sig_pending & (1 << signum))
+			&& current->sig_handlers[signum] == NULL && default_kills(signum))
+			halt(255);
+	}
+}
+
+/*
+ * user_context
+ *   DESCRIPTION:	Finds the registers saved when the current process entered
+ *					the kernel from user mode through an interrupt gate. They
+ *					always sit at the very top of its kernel stack.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	hw_context_t* : the saved context
+ *   SIDE EFFECTS: 	none
+ */
+hw_context_t* user_context() {
+	uint32_t stack_top = get_kernel_stack_by_PID(current_pid);
+
+	return (hw_context_t*)(stack_top - sizeof(hw_context_t));
+}
@@ -0,0 +1,69 @@
+/* signal.h - Delivering signals to user programs
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _SIGNAL_H
+#define _SIGNAL_H
+
+#include "types.h"
+
+/* signal numbers, the same as enum signums in ece391syscall.h */
+#define SIG_DIV_ZERO	0		// divide error in user code
+#define SIG_SEGFAULT	1		// any other exception in user code
+#define SIG_INTERRUPT	2		// Ctrl+C on the program's terminal
+#define SIG_ALARM		3		// sent to every program every ALARM_SECONDS
+#define SIG_USER1		4		// not raised by the kernel
+#define NUM_SIGNALS		5
+
+#define ALARM_SECONDS	10		// time between two alarm signals
+
+/* The registers every interrupt, exception and int $0x80 entry saves on the
+ * kernel stack, lowest address first. The wrappers push everything up to
+ * error_code, the processor pushes the rest. esp and ss are only there when
+ * the kernel was entered from user mode. */
+typedef struct hw_context_t {
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+	uint32_t esi;
+	uint32_t edi;
+	uint32_t ebp;
+	uint32_t eax;
+	uint32_t vector;				// interrupt vector the kernel was entered through
+	uint32_t error_code;			// pushed by the processor for some exceptions, else 0
+	uint32_t eip;
+	uint32_t cs;
+	uint32_t eflags;
+	uint32_t esp;
+	uint32_t ss;
+} hw_context_t;
+
+/* What delivery pushes on the user stack before running a handler. The
+ * handler is called with ret_addr as its return address and signum as its
+ * argument, so returning runs the trampoline, which calls sigreturn. */
+typedef struct sigframe_t {
+	uint32_t ret_addr;				// address of trampoline
+	int32_t signum;					// argument to the handler
+	hw_context_t context;			// user registers to restore
+	uint8_t trampoline[8];			// movl $SYS_SIGRETURN, %eax; int $0x80
+} sigframe_t;
+
+/* pcb_t is defined in syscall.h, which includes this file */
+struct pcb_t;
+
+/* Clears pending signals and resets every handler to the default action. */
+void init_signals(struct pcb_t* pcb);
+/* Marks a signal pending on a process and wakes it if it is asleep. */
+void send_signal(struct pcb_t* pcb, int32_t signum);
+/* Sends ALARM to every live process, called from the RTC handler. */
+void send_alarm();
+/* Called by the entry wrappers before returning to the interrupted code. */
+void deliver_signals(hw_context_t* context);
+/* Tells the SYSEXIT path whether deliver_signals has anything to do. */
+int32_t signals_pending();
+/* Kills the current process if a pending signal's default action is to. */
+void handle_fatal_signals();
+/* Returns the context saved when the current process last entered the kernel. */
+hw_context_t* user_context();
+
+#endif /* _SIGNAL_H */
@@ -3,33 +3,53 @@
  */
 
 #include "syscall.h"
+#include "scheduler.h"
+#include "ldisc.h"
+#include "pipe.h"
+#include "shm.h"
 #include "tests.h"
+#include "interrupt_wrapper.h"
+#include "uaccess.h"
 
 #define ELF_SIZE 4
 #define PROGRAM_LOAD_VIRT_ADDRESS 0x08048000
 #define USER_PD_INDEX 32		//128mb/4mb
 #define ENTRY_POINT_OFFSET 24   //entry point starts at byte 24
+#define EFLAGS_IF 0x200			//interrupts enabled
+#define USER_EFLAGS 0xCD5		//flags a signal handler may change: CF PF AF ZF SF DF OF
+#define USER_STACK_TOP ((USER_PD_INDEX+1) << ALIGN_4MB)	//132mb, the user stack starts below it
+#define ARG_WINDOW_PD_INDEX 35	//140mb, where load_program maps the caller's page
+#define ARG_MAX 0x10000			//most bytes of argument and environment strings
 
 //functions to prevent writing to stdin and reading from stdout
 static int32_t read_no_op(int32_t fd, void* buf, int32_t nbytes){return -1;};
 static int32_t write_no_op(int32_t fd, const void* buf, int32_t nbytes){return -1;};
 static int32_t open_no_op(const uint8_t* filename){return-1;};
 static int32_t close_no_op(int32_t fd){return -1;};
+//poll functions for descriptors that never block
+static int32_t poll_always_ready(int32_t fd){return POLLIN | POLLOUT;};
+static int32_t poll_write_only(int32_t fd){return POLLOUT;};
+//ioctl function for descriptors with no device commands
+static int32_t ioctl_no_op(int32_t fd, int32_t cmd, int32_t arg){return -1;};
 
 /* File operations jump table for a file */
 fo_jump_table_t file_fo_jump_table = {
     file_open,
     file_read,
     file_write,
-    file_close
+    file_close,
+    poll_always_ready,
+    ioctl_no_op
 };
 
 /* File operations jump table for a directory */
 fo_jump_table_t dir_fo_jump_table = {
     file_open,
     dir_read,
-    file_write,
-    file_close
+    dir_write,
+    file_close,
+    poll_always_ready,
+    ioctl_no_op
 };
 
 /* Jump table for stdin operations */
@@ -37,7 +57,9 @@ fo_jump_table_t stdin_jump_table = {
 	open_no_op,
 	terminal_read,
 	write_no_op,
-	close_no_op
+	close_no_op,
+	terminal_poll,
+	terminal_ioctl
 };
 
 /* Jump table for stdout operations */
@@ -45,7 +67,9 @@ fo_jump_table_t stdout_jump_table = {
 	open_no_op,
 	read_no_op,
 	terminal_write,
-	close_no_op
+	close_no_op,
+	poll_write_only,
+	terminal_ioctl
 };
 
 /* Jump table for rtc operations  */
@@ -53,12 +77,87 @@ fo_jump_table_t rtc_jump_table = {
 	rtc_open,
 	rtc_read,
 	rtc_write,
-	rtc_close
+	rtc_close,
+	rtc_poll,
+	ioctl_no_op
 };
 
 static uint8_t elf_magic[ELF_SIZE] = {0x7f, 0x45, 0x4c, 0x46}; //array to check for elf in file
+/* environment of the programs the boot shells start */
+static const int8_t* default_env[] = {"HOME=/", "TERM=ece391", NULL};
 //static uint8_t processes[MAX_NUM_PROCESSES];
 
+/*
+ * release_children
+ *   DESCRIPTION:	Called when a process halts. Spawned children that already
+ *					halted are freed, the others lose their parent and free
+ *					themselves when they halt.
+ *   INPUTS: 		parent : pcb of the halting process
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Frees PIDs
+ */
+static void release_children(pcb_t* parent){
+	pcb_t* child;
+	int i;
+
+	for(i = 0; i < MAX_NUM_PROCESSES; i++){
+		child = get_pcb_by_PID(i);
+		if(!processes[i] || !child->spawned || child->parent_pcb != parent)
+			continue;
+		if(child->state == TASK_ZOMBIE)
+			processes[i] = 0;
+		else
+			child->parent_pcb = NULL;
+	}
+}
+
+/*
+ * sleep_timer_fn
+ *   DESCRIPTION:	Runs when a process's sleep timer expires and wakes it.
+ *   INPUTS: 		pid : process to wake
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	May make the process runnable
+ */
+static void sleep_timer_fn(uint32_t pid){
+	pcb_t* pcb = get_pcb_by_PID(pid);
+
+	if(pcb->state == TASK_SLEEPING)
+		pcb->state = TASK_RUNNING;
+}
+
+/*
+ * alarm_timer_fn
+ *   DESCRIPTION:	Runs when a process's interval timer expires. Sends ALARM
+ *					and arms the timer again if it has an interval.
+ *   INPUTS: 		pid : process to signal
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static void alarm_timer_fn(uint32_t pid){
+	pcb_t* pcb = get_pcb_by_PID(pid);
+
+	send_signal(pcb, SIG_ALARM);
+	if(pcb->alarm_interval)
+		add_timer(&pcb->alarm_timer, pit_ticks + pcb->alarm_interval);
+}
+
+/*
+ * init_process_timers
+ *   DESCRIPTION:	Sets up the timers of a new process, disarmed.
+ *   INPUTS: 		pcb : process to set up
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+static void init_process_timers(pcb_t* pcb){
+	init_timer(&pcb->sleep_timer, sleep_timer_fn, pcb->process_id);
+	init_timer(&pcb->alarm_timer, alarm_timer_fn, pcb->process_id);
+	pcb->alarm_interval = 0;
+}
+
 /*
  * halt
  *   DESCRIPTION:	This system call terminates a proess and then returns the 
@@ -84,9 +183,27 @@ int32_t halt (uint8_t status){
 	/* Obtain the current pcb. */
 	pcb_t* current = get_current_executing_pcb();
 
+	/* A program that switched its terminal's mode gives its parent back the
+	 * mode it had at execute. */
+	if(!current->spawned && ldisc_get_mode(exec_term_id) != current->ldisc_mode)
+		ldisc_set_mode(exec_term_id, current->ldisc_mode);
+
+	/* Timers must not fire for a PID that is reused. */
+	del_timer(&current->sleep_timer);
+	del_timer(&current->alarm_timer);
+	current->alarm_interval = 0;
+
+	/* Shared memory segments are dropped with the process. */
+	shm_release(current->process_id);
+	reload_cr3();
+
+	/* Spawned children lose their parent. */
+	release_children(current);
+
 	/* If it is the first shell, restart the shell. */
-	if(current->parent_pcb == NULL){
-		tss.esp0 = (uint32_t)(get_pcb_by_PID(current->process_id - 1) - 4); //-4 because 32 bytes above the next pcb
+	if(current->parent_pcb == NULL && !current->spawned){
+		init_signals(current);
+		tss.esp0 = get_kernel_stack_by_PID(current->process_id);
 		tss.ss0 = KERNEL_DS;
 		asm volatile ("            \n\
 	        cli                    \n\
@@ -111,26 +228,41 @@ int32_t halt (uint8_t status){
 		);
 	}
 	
-	// clear arg buffer
-	(current->args)[0] = '\0';
+	// the arguments went with the user page
+	current->argc = 0;
+	current->argv = NULL;
+	current->envp = NULL;
 	/* Close all used files within the fd array in pcb. */
 	for(i = 0; i < FD_ARRAY_LEN; i++) {
-		if(current->fd_array[i].flags == 1)
-			close(i);
+		pipe_release(&current->fd_array[i]);
 		current->fd_array[i].flags = 0;
 		current->fd_array[i].fo_jump_table_ptr = NULL; 
 	}	
 
+	/* Nobody waits in execute for a spawned process, so it stays a zombie
+	 * until its parent collects the status with waitpid and never runs again. */
+	if(current->spawned){
+		current->exit_status = _status;
+		if(current->parent_pcb != NULL){
+			current->state = TASK_ZOMBIE;
+			wake_up(&current->parent_pcb->child_wq);
+		} else {
+			processes[current->process_id] = 0;
+		}
+		schedule();
+	}
+
 	/* Restore the old page mapping. */
 	if (current->parent_pcb != NULL){
 		create_user_4mb_page(current->parent_pcb->process_id + 2, USER_PD_INDEX);
+		remap_shm(current->parent_pcb->process_id);
 		//current = current->parent_pcb;
 		reload_cr3();
 	}
 	
 	/* Set esp0 in tss. and ss0 */
 	//tss.esp0 = stack pointer of previous pcb
-	tss.esp0 = (uint32_t)(get_pcb_by_PID(current->parent_pcb->process_id - 1) - 4); //-4 because 32 bytes above the next pcb
+	tss.esp0 = get_kernel_stack_by_PID(current->parent_pcb->process_id);
 	tss.ss0 = KERNEL_DS;
 
 	//set process to inactive
@@ -142,6 +274,7 @@ int32_t halt (uint8_t status){
 	
 	current = current->parent_pcb;
 	current->child_pcb = NULL;
+	set_current(current->process_id);
 	asm volatile("					\n\
 				 xorl %%eax, %%eax  \n\
 				 movl %2, %%eax		\n\
@@ -159,128 +292,309 @@ int32_t halt (uint8_t status){
 }
 
 /*
- * execute
- *   DESCRIPTION:	This system call attempts to load and exeute a new program, 
- *					handing off the proessor to the new program until it terminates. 
- * 					The command is a space-separated sequence of words. The first
- * 					is the file name of the program to be exeuted, and the rest of the 
- *					command provides the new program on request via the getargs system all. 
+ * caller_addr
+ *   DESCRIPTION:	Finds where an address in the caller's user page is seen
+ *					while load_program has the caller's page mapped in the
+ *					argument window.
+ *   INPUTS: 		addr : address in the caller's user page
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the address in the window, NULL if addr is not in the user page
+ *   SIDE EFFECTS: 	none
+ */
+static const uint8_t* caller_addr(const void* addr){
+	if((uint32_t)addr < (USER_PD_INDEX << ALIGN_4MB) || (uint32_t)addr >= USER_STACK_TOP)
+		return NULL;
+	return (const uint8_t*)((uint32_t)addr - (USER_PD_INDEX << ALIGN_4MB) + (ARG_WINDOW_PD_INDEX << ALIGN_4MB));
+}
+
+/*
+ * copy_env_string
+ *   DESCRIPTION:	Copies one environment string to the new program's stack.
+ *   INPUTS: 		out : where to copy to, advanced past the copy
+ *					end : end of the space for strings
+ *					str : string to copy, NULL fails
+ *					str_end : end of the memory str may be read from, NULL
+ *							  for a kernel string
+ *   OUTPUTS:		the string at *out
+ *   RETURN VALUE: 	0 on success, -1 if it does not fit or runs off str_end
+ *   SIDE EFFECTS: 	none
+ */
+static int32_t copy_env_string(uint8_t** out, const uint8_t* end, const uint8_t* str, const uint8_t* str_end){
+	if(str == NULL)
+		return -1;
+	do {
+		if(*out >= end || (str_end != NULL && str >= str_end))
+			return -1;
+		**out = *str;
+		(*out)++;
+	} while(*str++ != '\0');
+	return 0;
+}
+
+/*
+ * setup_user_stack
+ *   DESCRIPTION:	Puts the arguments and environment of a new program on its
+ *					user stack, in the form main(argc, argv, envp) expects.
+ *					Called by load_program with the new program's page mapped
+ *					as the user page and the caller's page in the argument
+ *					window. The command is read once: each word is copied
+ *					straight to the new stack and ended with a NUL. The
+ *					environment strings of the caller follow, then the argv
+ *					and envp arrays are built below the strings. From the
+ *					returned stack pointer up the stack holds argc, argv,
+ *					envp, the argv array and the envp array.
+ *   INPUTS: 		pcb : pcb of the new program, gets argc, argv and envp
+ *					command : command in the caller's user page
+ *					prev_pcb : pcb of the caller, for its environment
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the new program's first stack pointer, 0 if the command
+ *					is empty, not in the user page or longer than ARG_MAX
+ *   SIDE EFFECTS: 	Writes the new program's user stack
+ */
+static uint32_t setup_user_stack(pcb_t* pcb, const uint8_t* command, const pcb_t* prev_pcb){
+	uint8_t* strings = (uint8_t*)(USER_STACK_TOP - ARG_MAX);	//first string on the new stack
+	const uint8_t* end = (const uint8_t*)USER_STACK_TOP;		//end of the space for strings
+	const uint8_t* window_end = (const uint8_t*)((ARG_WINDOW_PD_INDEX+1) << ALIGN_4MB);
+	const uint8_t* in = caller_addr(command);					//next byte of the command
+	uint8_t* out = strings;										//next byte of the strings
+	uint8_t* const* env_in;										//caller's envp array
+	uint32_t* sp;												//new stack pointer
+	uint32_t argc = 0, envc = 0, i;
+	int in_word = 0;
+
+	if(in == NULL)
+		return 0;
+	// split on spaces as the words are copied
+	for(; in < window_end && *in != '\0'; in++){
+		if(*in == ' '){
+			if(in_word)
+				*out++ = '\0';
+			in_word = 0;
+			continue;
+		}
+		// leave room for the NUL ending the word
+		if(out + 1 >= end)
+			return 0;
+		if(!in_word)
+			argc++;
+		in_word = 1;
+		*out++ = *in;
+	}
+	if(in >= window_end || argc == 0)
+		return 0;
+	if(in_word)
+		*out++ = '\0';
+
+	// the caller's environment, or the default one for the boot shells' children
+	if(prev_pcb->envp == NULL){
+		for(; default_env[envc] != NULL; envc++){
+			if(copy_env_string(&out, end, (const uint8_t*)default_env[envc], NULL) != 0)
+				return 0;
+		}
+	} else {
+		env_in = (uint8_t* const*)caller_addr(prev_pcb->envp);
+		for(; ; envc++){
+			if(env_in == NULL || (const uint8_t*)(env_in + envc + 1) > window_end)
+				return 0;
+			if(env_in[envc] == NULL)
+				break;
+			if(copy_env_string(&out, end, caller_addr(env_in[envc]), window_end) != 0)
+				return 0;
+		}
+	}
+
+	// argc, argv, envp, then the two NULL terminated arrays
+	sp = (uint32_t*)strings - (3 + argc + 1 + envc + 1);
+	sp[0] = argc;
+	sp[1] = (uint32_t)&sp[3];
+	sp[2] = (uint32_t)&sp[3 + argc + 1];
+	out = strings;
+	for(i = 0; i < argc + envc; i++){
+		sp[3 + i + (i >= argc)] = (uint32_t)out;
+		out += strlen((int8_t*)out) + 1;
+	}
+	sp[3 + argc] = 0;
+	sp[3 + argc + 1 + envc] = 0;
+
+	pcb->argc = argc;
+	pcb->argv = (uint8_t**)sp[1];
+	pcb->envp = (uint8_t**)sp[2];
+	pcb->user_esp = (uint32_t)sp;
+	return (uint32_t)sp;
+}
+
+/*
+ * load_program
+ *   DESCRIPTION:	Shared first half of execute and spawn. Finds a free PID,
+ *					copies the program image into that PID's user page and
+ *					fills in its pcb. Stdin and stdout are inherited from the
+ *					caller and the new process runs on the caller's terminal.
+ *					The new process is left in TASK_NEW, so the scheduler does
+ *					not pick it until the caller has set it up to run, and the
+ *					caller's own pages are mapped again on return.
  *   INPUTS: 		command : full command with file and arguments
  *   OUTPUTS:		none
- *   RETURN VALUE: 	-1 if the command cannot be executed, or if the progam does not exist or filename is not
- *					executable. 
- *   SIDE EFFECTS: 	Loads/executes the specified program/filename
+ *   RETURN VALUE: 	the new PID, 0 if every PID is in use, -1 if the program does
+ *					not exist or is not executable
+ *   SIDE EFFECTS: 	Changes paging structure while loading
  */
-int32_t execute (const uint8_t* command){
+static int32_t load_program (const uint8_t* command){
 	// Allocate local variables
-	uint8_t cmd[MAX_CMD_SIZE];					 //buffer to hold cmd (first string in command)
-	uint8_t args[MAX_CMD_SIZE];	 //array to hold arguments (other strings in command)
 	uint8_t buf[ELF_SIZE];					   //copy buffer for the ELF check
 	dentry_t dentry;							 //dentry to copy into
 	int bytes_to_read;						   //number of bytes to read from file
-	int* esp0;								   //address of the kernel stack for current task
-	pcb_t* pcb;					  //address of the pcb for the current task
+	pcb_t* pcb;					  //address of the pcb for the new task
+	pcb_t* prev_pcb = get_current_executing_pcb();	//the caller's pcb
 	int i;									   //iterators
 	uint32_t entry_point;						//entry point to user leve program
+	uint32_t flags;								//saved interrupt flag
 	int new_PID = -1;								//available PID
-	pcb_t * prev_pcb;							//the previous pcb
+	int ok;										//set while loading succeeds
 
 	//return if NULL command
 	if(command == NULL)
 		return -1;	
 
-	//PARSE COMMAND______________________________________________________________
-	parse_command(cmd, args, command);		//call helper function: fills cmd and args
-
-	//test return to parent program if exceptions occur
-	if(!strncmp((int8_t*)cmd, (int8_t*)"exception", 9))  //9 because size of string "exception" is 9
-		exception_test();
-
-	//CHECK FOR VALID FILE AND EXECUTABLE_________________________________________
-	if(read_dentry_by_name(cmd, &dentry) == -1){			//test if file exists
-		return -1;
-	}
-	if(read_data(dentry.inode_index, 0, buf, ELF_SIZE) == -1)
-		return -1;
-	if(strncmp((int8_t*)buf, (int8_t*)elf_magic, ELF_SIZE) != 0)			//test if elf exists
-		return -1;
+	// The scheduler remaps the user page on every switch, so the program is
+	// loaded with interrupts off. The filesystem lock is taken first, since
+	// waiting for it would switch; the disk is polled while loading
+	fs_lock();
+	cli_and_save(flags);
 
 	//SEARCH FOR AVAILABLE PROCESS ID. return 0 if no processes available
 	for(i = 3; i < MAX_NUM_PROCESSES; i++){
 		if(!processes[i]){
 			new_PID = i;
+			// not runnable or wakeable until the caller finishes with it
+			get_pcb_by_PID(new_PID)->state = TASK_NEW;
+			get_pcb_by_PID(new_PID)->spawned = 0;
 			processes[new_PID] = 1;
 			break;
 		}
 	}
 	if(new_PID == -1){
+		restore_flags(flags);
+		fs_unlock();
 		printf("Process # limit reached\n");
 		return 0;
 	}
+	pcb = get_pcb_by_PID(new_PID);
 
 	//SET UP PAGING______________________________________________________________
 	// allocate a page for the new task at 128mb (index 32), pointing in real memory
-	// to 8mb (index 2) for the first task and 12mb (index 3) for the second
-	// and then flush the TLBs
+	// to 8mb (index 2) for the first task and 12mb (index 3) for the second.
+	// The caller's page stays visible in the argument window so its command
+	// and environment can be read. Then flush the TLBs
 	if (create_user_4mb_page(new_PID + 2, USER_PD_INDEX) != 0) {
 		processes[new_PID] = 0; 
+		restore_flags(flags);
+		fs_unlock();
 		return -1;	//return -1 if page didn't allocate
 	}
+	create_user_4mb_page(prev_pcb->process_id + 2, ARG_WINDOW_PD_INDEX);
+	remap_shm(new_PID);
 	reload_cr3();
 
+	//PARSE COMMAND ONTO THE NEW USER STACK, argv[0] is the file_____________________
+	ok = setup_user_stack(pcb, command, prev_pcb) != 0;
+
+	//test return to parent program if exceptions occur
+	if(ok && !strncmp((int8_t*)pcb->argv[0], (int8_t*)"exception", 9))  //9 because size of string "exception" is 9
+		exception_test();
+
+	//CHECK FOR VALID FILE AND EXECUTABLE_________________________________________
+	if(ok
+	   && (read_dentry_by_name(pcb->argv[0], &dentry) == -1						//test if file exists
+	   || read_data(dentry.inode_index, 0, buf, ELF_SIZE) == -1
+	   || strncmp((int8_t*)buf, (int8_t*)elf_magic, ELF_SIZE) != 0))			//test if elf exists
+		ok = 0;
 
 	//PROGRAM LOADER: COPY IMAGE INTO VIRTUAL ADDRESS________________________________
-	bytes_to_read = inodes[dentry.inode_index].length;
-	if(read_data(dentry.inode_index, 0, (uint8_t*)PROGRAM_LOAD_VIRT_ADDRESS, bytes_to_read) != bytes_to_read) {
-		// We've hit an error, not everything copied so undo the paging stuff
+	if(ok){
+		bytes_to_read = inode_length(dentry.inode_index);
+		if(read_data(dentry.inode_index, 0, (uint8_t*)PROGRAM_LOAD_VIRT_ADDRESS, bytes_to_read) != bytes_to_read)
+			ok = 0;	// not everything copied
+		else
+			read_data(dentry.inode_index, ENTRY_POINT_OFFSET, (uint8_t*)(&entry_point), 4); // get entry point
+	}
+
+	// put the caller's pages back
+	remove_4mb_page(ARG_WINDOW_PD_INDEX);
+	create_user_4mb_page(prev_pcb->process_id + 2, USER_PD_INDEX);
+	remap_shm(prev_pcb->process_id);
+	reload_cr3();
+	if(!ok)
 		processes[new_PID] = 0;
-		// won't actually do anything if we try to overwrite kernel page
-		create_user_4mb_page(new_PID + 2, USER_PD_INDEX);
-		reload_cr3();
+	restore_flags(flags);
+	fs_unlock();
+	if(!ok)
 		return -1;
-	}
-	read_data(dentry.inode_index, ENTRY_POINT_OFFSET, (uint8_t*)(&entry_point), 4); // get entry point
 
-	
 	//CREATE PCB__________________________________________________________________
-	// Find the address of the kernel stack: 0x800000 in blocks of 8kb upwards
-	prev_pcb = get_current_executing_pcb();
-	esp0 = (int*)(get_pcb_by_PID(new_PID - 1)- 4);  //-4 because 32 bytes above the next pcb
 	pcb = get_pcb_by_PID(new_PID);
-	// initialize stdin and stdout
-	pcb->fd_array[0].fo_jump_table_ptr = &stdin_jump_table;
-	pcb->fd_array[1].fo_jump_table_ptr = &stdout_jump_table;
-	pcb->fd_array[0].active = 1;
-	pcb->fd_array[1].active = 1;
+	// inherit stdin and stdout, which the shell may have pointed at a pipe
+	for (i = 0; i < 2; i++) {
+		pcb->fd_array[i] = prev_pcb->fd_array[i];
+		pipe_dup(&pcb->fd_array[i]);
+	}
 	pcb->entry = entry_point;
-	//fill argument string in pcb
-	strcpy((int8_t*)pcb->args, (int8_t*)args);
 	// Clear the rest of the FD array
 	for (i = 2; i < FD_ARRAY_LEN; i++) {
-		pcb->fd_array[i].active = 0;
+		pcb->fd_array[i].flags = 0;
 	}
 	pcb->process_id = new_PID; //save process ID
+	pcb->term_id = prev_pcb->term_id;
+	pcb->exit_status = 0;
+	init_wait_queue(&pcb->child_wq);
+	init_signals(pcb);
+	init_process_timers(pcb);
+	pcb->parent_pcb = prev_pcb;
+	pcb->child_pcb = NULL;
+
+	return new_PID;
+}
+
+/*
+ * execute
+ *   DESCRIPTION:	This system call attempts to load and exeute a new program, 
+ *					handing off the proessor to the new program until it terminates. 
+ * 					The command is a space-separated sequence of words. The first
+ * 					is the file name of the program to be exeuted, and the rest of the 
+ *					command provides the new program on request via the getargs system all. 
+ *   INPUTS: 		command : full command with file and arguments
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	-1 if the command cannot be executed, or if the progam does not exist or filename is not
+ *					executable. 
+ *   SIDE EFFECTS: 	Loads/executes the specified program/filename
+ */
+int32_t execute (const uint8_t* command){
+	int new_PID;								//PID of the new program
+	pcb_t* pcb;									//pcb of the new program
+	pcb_t* prev_pcb;							//the previous pcb
+
+	new_PID = load_program(command);
+	if(new_PID <= 0)
+		return new_PID;
+	pcb = get_pcb_by_PID(new_PID);
+	prev_pcb = get_current_executing_pcb();
+	pcb->ldisc_mode = ldisc_get_mode(exec_term_id);
 
 	//save parent ebp and esp
 	asm volatile("movl %%esp, %0":"=g"(pcb->parent_esp));
 	asm volatile("movl %%ebp, %0":"=g"(pcb->parent_ebp));
-	
-	// Link to parent pcb and set child to NULL
-	if(new_PID < 3){
-		pcb->parent_pcb = NULL;
-	}
-	else{
-		pcb->parent_pcb = prev_pcb;
-		prev_pcb->child_pcb = pcb;
-	}
-		
-	pcb->child_pcb = NULL;
-
 
 	// CONTEXT SWITCH_______________________________________________________________
-	//update tss
+	// Link the child in with interrupts off: once the caller has a child it
+	// is no longer runnable, and the child must be running by then
 	cli();
-	tss.esp0 = (uint32_t)esp0;		//kernel stack pointer
+	prev_pcb->child_pcb = pcb;
+	pcb->state = TASK_RUNNING;
+	set_current(new_PID);
+	create_user_4mb_page(new_PID + 2, USER_PD_INDEX);
+	remap_shm(new_PID);
+	reload_cr3();
+	//update tss
+	tss.esp0 = get_kernel_stack_by_PID(new_PID);		//kernel stack pointer
 	tss.ss0 = KERNEL_DS;			//kernal data segment = kernal stack segment
 	// Push IRET context to stack
 	/* cs and ds registers are of the form:
@@ -292,7 +606,7 @@ int32_t execute (const uint8_t* command){
 	 * entry to point to the newly allocated kernel stack, we push the
 	 * following to the stack for iret in order:
 	 * new stack segment (user data segment)
-	 * new stack pointer (bottom of 4MB user program page, 33 << 22)
+	 * new stack pointer (below argc, argv and envp on the user stack)
 	 * flags
 	 * new code segment
 	 * new instruction pointer (bytes 24-27 of loaded executable)
@@ -307,10 +621,7 @@ int32_t execute (const uint8_t* command){
         movl %0, %%edx         \n\
         movw %%dx, %%ds        \n\
         pushl %0               \n\
-        movl $33, %%edx        \n\
-        shll $22, %%edx        \n\
-		subl $4, %%edx         \n\
-        pushl %%edx            \n\
+        pushl %3               \n\
         pushfl                 \n\
         popl %%edx             \n\
         orl $0x200, %%edx      \n\
@@ -320,7 +631,7 @@ int32_t execute (const uint8_t* command){
         iret                   \n\
 		"
 		:
-		: "r" (USER_DS), "r" (USER_CS), "r" (entry_point)
+		: "r" (USER_DS), "r" (USER_CS), "r" (pcb->entry), "r" (pcb->user_esp)
 		: "edx" // clobbers %EDX
 	);
 
@@ -328,13 +639,220 @@ int32_t execute (const uint8_t* command){
 	return 0;
 }
 
+/*
+ * spawn
+ *   DESCRIPTION:	Loads a new program like execute but returns to the caller
+ *					at once; the program runs alongside it under the scheduler,
+ *					on the caller's terminal. Its kernel stack is set up to look
+ *					like switch_context saved it just before returning to user
+ *					space, so the scheduler starts it like any other process.
+ *					The caller collects its status with waitpid.
+ *   INPUTS: 		command : full command with file and arguments
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	PID of the new process, -1 if it could not be started
+ *   SIDE EFFECTS: 	Adds a runnable process
+ */
+int32_t spawn (const uint8_t* command){
+	int new_PID;								//PID of the new program
+	pcb_t* pcb;									//pcb of the new program
+	uint32_t* esp;								//builds the new kernel stack
+
+	new_PID = load_program(command);
+	if(new_PID <= 0)
+		return -1;
+	pcb = get_pcb_by_PID(new_PID);
+	pcb->spawned = 1;
+
+	// iret context, as a trap from user space would leave it
+	esp = (uint32_t*)get_kernel_stack_by_PID(new_PID);
+	*--esp = USER_DS;							//ss
+	*--esp = pcb->user_esp;						//esp, below argc, argv and envp
+	*--esp = EFLAGS_IF;							//eflags
+	*--esp = USER_CS;							//cs
+	*--esp = pcb->entry;						//eip
+	// what switch_context pops: return address, ebp, ebx, esi, edi
+	*--esp = (uint32_t)spawn_entry;
+	*--esp = 0;
+	*--esp = 0;
+	*--esp = 0;
+	*--esp = 0;
+	pcb->return_esp = (uint32_t)esp;
+
+	pcb->state = TASK_RUNNING;
+	return new_PID;
+}
+
+/*
+ * waitpid
+ *   DESCRIPTION:	Waits for a child started with spawn to halt, then frees
+ *					its PID and returns the status it passed to halt.
+ *   INPUTS: 		pid : child to wait for, -1 for any child
+ *					status : where to store the status, may be NULL
+ *					options : WNOHANG to return 0 instead of sleeping
+ *   OUTPUTS:		*status gets the child's status
+ *   RETURN VALUE: 	PID of the halted child, 0 if WNOHANG is set and no child
+ *					has halted, -1 if there is no such child
+ *   SIDE EFFECTS: 	May put the process to sleep
+ */
+int32_t waitpid (int32_t pid, int32_t* status, int32_t options){
+	pcb_t* current = get_current_executing_pcb();	//the caller's pcb
+	pcb_t* child;								//child being checked
+	int found;									//whether a matching child exists
+	int i;										//iterator
+
+	if(status != NULL && !access_ok(status, sizeof(*status)))
+		return -1;
+
+	cli();
+	while(1){
+		found = 0;
+		for(i = 0; i < MAX_NUM_PROCESSES; i++){
+			child = get_pcb_by_PID(i);
+			if(!processes[i] || !child->spawned || child->parent_pcb != current)
+				continue;
+			if(pid != -1 && pid != i)
+				continue;
+			found = 1;
+			if(child->state == TASK_ZOMBIE){
+				// left to reap later if the status cannot be stored
+				if(status != NULL
+				   && copy_to_user(status, &child->exit_status, sizeof(*status)) != 0){
+					sti();
+					return -1;
+				}
+				processes[i] = 0;
+				sti();
+				return i;
+			}
+		}
+		if(!found || (options & WNOHANG)){
+			sti();
+			return found ? 0 : -1;
+		}
+		sleep_on(&current->child_wq);
+	}
+}
+
+/*
+ * nanosleep
+ *   DESCRIPTION:	Sleeps for at least the requested time. The process's sleep
+ *					timer wakes it, so sleeping takes no processor time. The
+ *					time is rounded up to PIT ticks and one more tick is added,
+ *					since the current tick is already partly over. Times past
+ *					TIMER_MAX_TICKS sleep that long. A signal with a handler
+ *					ends the sleep early.
+ *   INPUTS: 		req : time to sleep
+ *					rem : where to store the time left if the sleep is cut
+ *						  short, may be NULL
+ *   OUTPUTS:		*rem gets the time left
+ *   RETURN VALUE: 	0 after sleeping the whole time, -1 if interrupted or for
+ *					a bad argument
+ *   SIDE EFFECTS: 	Puts the process to sleep
+ */
+int32_t nanosleep (const timespec_t* req, timespec_t* rem){
+	pcb_t* current = get_current_executing_pcb();	//the caller's pcb
+	timespec_t ts;								//copy of req, then the time left
+	uint32_t expires;							//PIT tick to wake up at
+	uint32_t left;								//ticks still to sleep
+
+	if(copy_from_user(&ts, req, sizeof(ts)) != 0)
+		return -1;
+	if(rem != NULL && !access_ok(rem, sizeof(*rem)))
+		return -1;
+	if(ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= NSEC_PER_SEC)
+		return -1;
+
+	cli();
+	expires = pit_ticks + timespec_to_ticks(&ts) + 1;
+	add_timer(&current->sleep_timer, expires);
+	while((int32_t)(pit_ticks - expires) < 0 && !(current->sig_pending && !current->sig_masked))
+		sleep_current();
+	del_timer(&current->sleep_timer);
+	left = ((int32_t)(expires - pit_ticks) > 0) ? expires - pit_ticks : 0;
+	sti();
+
+	if(rem != NULL){
+		ticks_to_timespec(left, &ts);
+		if(copy_to_user(rem, &ts, sizeof(ts)) != 0)
+			return -1;
+	}
+	return left ? -1 : 0;
+}
+
+/*
+ * clock_gettime
+ *   DESCRIPTION:	Reads the monotonic clock, the time since the PIT started.
+ *					It is kept in PIT ticks and refined with the time stamp
+ *					counter, so it has nanosecond resolution where the
+ *					processor has one.
+ *   INPUTS: 		clock_id : CLOCK_MONOTONIC
+ *					tp : where to store the time
+ *   OUTPUTS:		*tp gets the time
+ *   RETURN VALUE: 	0 on success, -1 for a bad clock or pointer
+ *   SIDE EFFECTS: 	none
+ */
+int32_t clock_gettime (int32_t clock_id, timespec_t* tp){
+	timespec_t ts;								//the time, copied out to tp
+
+	if(clock_id != CLOCK_MONOTONIC)
+		return -1;
+
+	clock_monotonic(&ts);
+	return copy_to_user(tp, &ts, sizeof(ts));
+}
+
+/*
+ * setitimer
+ *   DESCRIPTION:	Arms the interval timer, which sends ALARM when it_value
+ *					runs out and then every it_interval. A zero it_value
+ *					disarms it. Times are rounded up to PIT ticks and cut to
+ *					TIMER_MAX_TICKS.
+ *   INPUTS: 		which : ITIMER_REAL
+ *					new_value : the new setting
+ *					old_value : where to store the old setting, may be NULL
+ *   OUTPUTS:		*old_value gets the time to the next ALARM and the interval
+ *   RETURN VALUE: 	0 on success, -1 for a bad argument
+ *   SIDE EFFECTS: 	Changes the process's alarm timer
+ */
+int32_t setitimer (int32_t which, const itimerval_t* new_value, itimerval_t* old_value){
+	pcb_t* current = get_current_executing_pcb();	//the caller's pcb
+	itimerval_t new_timer, old_timer;			//copies of new_value and old_value
+	uint32_t value;								//ticks to the first alarm
+
+	if(which != ITIMER_REAL || copy_from_user(&new_timer, new_value, sizeof(new_timer)) != 0)
+		return -1;
+	if(old_value != NULL && !access_ok(old_value, sizeof(*old_value)))
+		return -1;
+	if(new_timer.it_value.tv_sec < 0 || new_timer.it_value.tv_nsec < 0
+	   || new_timer.it_value.tv_nsec >= NSEC_PER_SEC
+	   || new_timer.it_interval.tv_sec < 0 || new_timer.it_interval.tv_nsec < 0
+	   || new_timer.it_interval.tv_nsec >= NSEC_PER_SEC)
+		return -1;
+
+	cli();
+	ticks_to_timespec(current->alarm_timer.pending ? current->alarm_timer.expires - pit_ticks : 0,
+					  &old_timer.it_value);
+	ticks_to_timespec(current->alarm_interval, &old_timer.it_interval);
+	value = timespec_to_ticks(&new_timer.it_value);
+	current->alarm_interval = timespec_to_ticks(&new_timer.it_interval);
+	if(value)
+		add_timer(&current->alarm_timer, pit_ticks + value);
+	else
+		del_timer(&current->alarm_timer);
+	sti();
+
+	if(old_value != NULL)
+		return copy_to_user(old_value, &old_timer, sizeof(old_timer));
+	return 0;
+}
+
 /*
  * read
  *   DESCRIPTION: 	Reads data from keyboard, a file, RTC, or directory.
  *  				Reads from a entry in file descriptor array using a 
  * 					function pointer to a jump table.
  *   INPUTS: 		fd: file descriptor number to read from
- * 					buf: buffer to fill
+ * 					buf: buffer to fill, in the program's memory
  * 					nbytes: number of bytes to read
  *   OUTPUTS: 		none
  *   RETURN VALUE: 	-1 for failure
@@ -345,8 +863,9 @@ int32_t read (int32_t fd, void* buf, int32_t nbytes){
 	pcb_t* pcb_ptr; // Pointer to this task's pcb
 	fd_entry_t* fd_array; // Array of file descriptors in this pcb
 
-	// OOB check for fd and nbytes, NULL check for buf, and check that a user task exists
-	if (fd < 0 || fd >= FD_ARRAY_LEN || buf == NULL || nbytes < 0)
+	// OOB check for fd and nbytes, NULL check for buf, and check that a user task exists.
+	// The drivers copy to buf with copy_to_user, which catches unmapped pages
+	if (fd < 0 || fd >= FD_ARRAY_LEN || buf == NULL || nbytes < 0 || !access_ok(buf, nbytes))
 		return -1;
 
 	pcb_ptr = get_current_executing_pcb();
@@ -363,7 +882,7 @@ int32_t read (int32_t fd, void* buf, int32_t nbytes){
  *   DESCRIPTION: 	Writes data to terinal or a device(RTC), basically
  * 					this function writes to a file.
  *   INPUTS: 		fd: file descriptor number to read from
- * 					buf: buffer to fill
+ * 					buf: buffer to fill, in the program's memory
  * 					nbytes: number of bytes to read
  *   OUTPUTS: 		none
  *   RETURN VALUE: 	-1 for failure
@@ -374,8 +893,9 @@ int32_t write (int32_t fd, const void* buf, int32_t nbytes){
 	pcb_t* pcb_ptr; // Pointer to this task's pcb
 	fd_entry_t* fd_array; // Array of file descriptors in this pcb
 
-	// OOB check for fd and nbytes, NULL check for buf, and check that a user task exists
-	if (fd < 0 || fd >= FD_ARRAY_LEN || buf == NULL || nbytes < 0)
+	// OOB check for fd and nbytes, NULL check for buf, and check that a user task exists.
+	// The drivers copy from buf with copy_from_user, which catches unmapped pages
+	if (fd < 0 || fd >= FD_ARRAY_LEN || buf == NULL || nbytes < 0 || !access_ok(buf, nbytes))
 		return -1;
 
 	pcb_ptr = get_current_executing_pcb();
@@ -388,25 +908,32 @@ int32_t write (int32_t fd, const void* buf, int32_t nbytes){
 }
 
 /*
- * open
- *   DESCRIPTION: 	Provides access to a file system by opening the given
- * 					file, directory, or device.
- *   INPUTS: 		filename: filename to open
+ * get_path
+ *   DESCRIPTION: 	Copies a path out of the program for open, create and stat.
+ *   INPUTS: 		path: kernel buffer of FS_PATH_LEN bytes
+ * 					filename: path in the program's memory
+ *   OUTPUTS: 		the path, zero terminated
+ *   RETURN VALUE: 	0 for success, -1 if filename is bad or too long
+ *   SIDE EFFECTS: 	none
+ */
+static int32_t get_path (uint8_t* path, const uint8_t* filename){
+	return strncpy_from_user((int8_t*)path, (const int8_t*)filename, FS_PATH_LEN) < 0 ? -1 : 0;
+}
+
+/*
+ * open_dentry
+ *   DESCRIPTION: 	Gives a file, directory or device the first unused file
+ * 					descriptor of the current process.
+ *   INPUTS: 		dentry: what to open
  *   OUTPUTS: 		none
- *   RETURN VALUE: 	-1 for failure
- *   SIDE EFFECTS: 	Sets up specified function pointers for file type. 
+ *   RETURN VALUE: 	the file descriptor, -1 for failure
+ *   SIDE EFFECTS: 	Sets up specified function pointers for file type.
  */
-int32_t open (const uint8_t* filename){
-	// Find the file in the file system and assign an unsed file descriptor
-	// File desriptrs must be set up according to file type
-	dentry_t dentry; // Dentry for file
+static int32_t open_dentry (const dentry_t* dentry){
 	pcb_t* pcb_ptr; // Pointer to this task's pcb
 	fd_entry_t* fd_array; // Array of file descriptors in this pcb
 	int i; // Iterator
 
-	// Validity checks.  If we're good, read the directory entry and get the file descriptor array
-	if (filename == NULL || read_dentry_by_name(filename, &dentry) != 0)
-		return -1;
 	pcb_ptr = get_current_executing_pcb();
 	fd_array = pcb_ptr->fd_array;
 	i = 2;
@@ -416,20 +943,21 @@ int32_t open (const uint8_t* filename){
 			return -1;
 	}
 	// We've found an empty fd entry, populate it
+	fd_array[i].flags = 0;
 	fd_array[i].file_position = 0;
-	strncpy((int8_t*)pcb_ptr->filenames[i], (int8_t*)dentry.file_name, USER_PD_INDEX);
-	switch (dentry.file_type) {
+	strncpy((int8_t*)pcb_ptr->filenames[i], (int8_t*)dentry->file_name, USER_PD_INDEX);
+	switch (dentry->file_type) {
 		case 0: // RTC
 			fd_array[i].fo_jump_table_ptr = &rtc_jump_table;
 			fd_array[i].inode_index = 0;
 			break;
 		case 1: // Directory
 			fd_array[i].fo_jump_table_ptr = &dir_fo_jump_table;
-			fd_array[i].inode_index = 0;
+			fd_array[i].inode_index = dentry->inode_index;
 			break;
 		case 2: // File
 			fd_array[i].fo_jump_table_ptr = &file_fo_jump_table;
-			fd_array[i].inode_index = dentry.inode_index;
+			fd_array[i].inode_index = dentry->inode_index;
 			break;
 		default: // Error
 			return -1;
@@ -444,6 +972,27 @@ int32_t open (const uint8_t* filename){
 	return i;
 }
 
+/*
+ * open
+ *   DESCRIPTION: 	Provides access to a file system by opening the given
+ * 					file, directory, or device.
+ *   INPUTS: 		filename: filename to open, in the program's memory
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	-1 for failure
+ *   SIDE EFFECTS: 	Sets up specified function pointers for file type. 
+ */
+int32_t open (const uint8_t* filename){
+	// Find the file in the file system and assign an unsed file descriptor
+	// File desriptrs must be set up according to file type
+	uint8_t path[FS_PATH_LEN]; // Kernel copy of filename
+	dentry_t dentry; // Dentry for file
+
+	// Validity checks.  If we're good, read the directory entry
+	if (get_path(path, filename) != 0 || read_dentry_by_name(path, &dentry) != 0)
+		return -1;
+	return open_dentry(&dentry);
+}
+
 /*
  * close
  *   DESCRIPTION: 	Closes a specified file descriptor and makes it avaliable for 
@@ -468,45 +1017,203 @@ int32_t close (int32_t fd){
 	fd_array = pcb_ptr->fd_array;
 	if (!fd_array[fd].active)
 		return -1;
-	else
-		fd_array[fd].active = 0;
+	pipe_release(&fd_array[fd]);
+	fd_array[fd].flags = 0;
 	return 0;
 	//return (*(fd_array[fd].fo_jump_table_ptr->close))(fd);
 }
 
+/*
+ * create
+ *   DESCRIPTION: 	Creates an empty file and opens it. An existing file is
+ *					truncated to nothing and opened. The file lives in the
+ *					writable overlay over the file system image, so it lasts
+ *					until the next boot.
+ *   INPUTS: 		filename: name of the file, at most 32 characters
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	the file descriptor, -1 for failure
+ *   SIDE EFFECTS: 	Adds a directory entry
+ */
+int32_t create (const uint8_t* filename){
+	uint8_t path[FS_PATH_LEN]; // Kernel copy of filename
+	dentry_t dentry; // Dentry of the new file
+
+	if (get_path(path, filename) != 0 || fs_create(path, &dentry) != 0)
+		return -1;
+	return open_dentry(&dentry);
+}
+
+/*
+ * truncate
+ *   DESCRIPTION: 	Sets the length of an open file. Bytes past the new end
+ *					are dropped; a longer file reads as zeroes past its old
+ *					end. The file position does not move.
+ *   INPUTS: 		fd: file descriptor of a regular file
+ *					length: new length in bytes
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	0 for success, -1 for failure
+ *   SIDE EFFECTS: 	Frees or allocates file system blocks
+ */
+int32_t truncate (int32_t fd, int32_t length){
+	fd_entry_t* fd_entry; // Entry being changed
+
+	if (fd < 2 || fd >= FD_ARRAY_LEN || length < 0)
+		return -1;
+	fd_entry = &get_current_executing_pcb()->fd_array[fd];
+	if (!fd_entry->active || fd_entry->fo_jump_table_ptr != &file_fo_jump_table)
+		return -1;
+	return fs_truncate(fd_entry->inode_index, length);
+}
+
+/*
+ * bcache_stats
+ *   DESCRIPTION: 	Copies the block cache's hit, miss, read-ahead and write
+ *					counters to the program.
+ *   INPUTS: 		stats: where to put them
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	0 for success, -1 for failure
+ *   SIDE EFFECTS: 	none
+ */
+int32_t bcache_stats (bcache_stats_t* stats){
+	bcache_stats_t counters;
+
+	bcache_read_stats(&counters);
+	return copy_to_user(stats, &counters, sizeof(counters));
+}
+
+/*
+ * getdents
+ *   DESCRIPTION: 	Reads the entries of an open directory into the buffer, one
+ *					dirent_t each with the name, type, inode and size, as many
+ *					as fit. Shares the position read() lists the directory from.
+ *   INPUTS: 		fd: file descriptor of a directory
+ *					buf: where to put the records
+ *					nbytes: size of buf in bytes
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	bytes of records read, 0 at the end, -1 for failure
+ *   SIDE EFFECTS: 	Moves the directory position
+ */
+int32_t getdents (int32_t fd, dirent_t* buf, int32_t nbytes){
+	fd_entry_t* fd_entry; // Entry being read
+
+	if (fd < 2 || fd >= FD_ARRAY_LEN || buf == NULL)
+		return -1;
+	fd_entry = &get_current_executing_pcb()->fd_array[fd];
+	if (!fd_entry->active || fd_entry->fo_jump_table_ptr != &dir_fo_jump_table)
+		return -1;
+	return dir_getdents(fd, buf, nbytes);
+}
+
+/*
+ * copy_stat
+ *   DESCRIPTION: 	Fills in a stat_t for a dentry and copies it to the program.
+ *   INPUTS: 		dentry: what to describe
+ *					buf: where to put it
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	0 for success, -1 for failure
+ *   SIDE EFFECTS: 	none
+ */
+static int32_t copy_stat (const dentry_t* dentry, stat_t* buf){
+	stat_t st;
+
+	st.inode_index = dentry->inode_index;
+	st.file_type = dentry->file_type;
+	dentry_stat(dentry, &st.length, &st.blocks);
+	return copy_to_user(buf, &st, sizeof(st));
+}
+
+/*
+ * stat
+ *   DESCRIPTION: 	Reports the type, length, data block count and inode of a
+ *					file, so a program can size its buffer before reading.
+ *   INPUTS: 		filename: path of the file
+ *					buf: where to put the result
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	0 for success, -1 for failure
+ *   SIDE EFFECTS: 	none
+ */
+int32_t stat (const uint8_t* filename, stat_t* buf){
+	uint8_t path[FS_PATH_LEN]; // Kernel copy of filename
+	dentry_t dentry; // Entry of the file
+
+	if (get_path(path, filename) != 0 || read_dentry_by_name(path, &dentry) != 0)
+		return -1;
+	return copy_stat(&dentry, buf);
+}
+
+/*
+ * fstat
+ *   DESCRIPTION: 	Like stat, for an open file, directory or RTC. The length
+ *					includes writes made through the descriptor.
+ *   INPUTS: 		fd: file descriptor
+ *					buf: where to put the result
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	0 for success, -1 for failure or for the terminal and pipes
+ *   SIDE EFFECTS: 	none
+ */
+int32_t fstat (int32_t fd, stat_t* buf){
+	fd_entry_t* fd_entry; // Entry being described
+	dentry_t dentry; // Stands in for the entry the fd was opened by
+
+	if (fd < 0 || fd >= FD_ARRAY_LEN)
+		return -1;
+	fd_entry = &get_current_executing_pcb()->fd_array[fd];
+	if (!fd_entry->active)
+		return -1;
+	if (fd_entry->fo_jump_table_ptr == &file_fo_jump_table)
+		dentry.file_type = FS_TYPE_FILE;
+	else if (fd_entry->fo_jump_table_ptr == &dir_fo_jump_table)
+		dentry.file_type = FS_TYPE_DIR;
+	else if (fd_entry->fo_jump_table_ptr == &rtc_jump_table)
+		dentry.file_type = FS_TYPE_RTC;
+	else
+		return -1;
+	dentry.inode_index = fd_entry->inode_index;
+	return copy_stat(&dentry, buf);
+}
+
 /*
  * getargs
- *   DESCRIPTION: 	copies arguments from command read from terminal into
- *					buf
+ *   DESCRIPTION: 	copies the arguments after the program name into buf,
+ *					separated by single spaces. They are read from argv on
+ *					the program's own stack, so the program may have changed
+ *					them; every pointer is read with the user copy routines.
  *   INPUTS: 		buf: buffer to copy args to, nbytes: nbytes to copy
  *   OUTPUTS: 		none
- *   RETURN VALUE: 	-1 for failure
+ *   RETURN VALUE: 	-1 for failure, including no arguments or arguments and
+ *					terminating NUL not fitting in nbytes
  * 					0 for sucess
  *   SIDE EFFECTS: none 
  */
 int32_t getargs (uint8_t* buf, int32_t nbytes){
 	//local variables
-	int args_length;  //length of argument	
-	int i = 0; //counter
+	const int8_t* arg;		//argument being copied
+	uint32_t i;				//argument index
+	int32_t len = 0;		//bytes copied so far
+	int32_t arg_len;		//length of the argument copied
 	pcb_t * pcb_ptr = get_current_executing_pcb(); //pointer to current pcb
-	args_length = strlen((int8_t*)pcb_ptr->args);
-	if(!args_length)
-		return -1;
 
 	//error check buf (is in user space, not null)
-	if(buf == NULL 
-	   || nbytes < args_length
-	   || ((uint32_t)buf < (USER_PD_INDEX << ALIGN_4MB))
-	   || ((uint32_t)buf >= (((USER_PD_INDEX+1) << ALIGN_4MB) - 4)))
+	if(buf == NULL || nbytes <= 0 || !access_ok(buf, nbytes))
+		return -1;
+	if(pcb_ptr->argc <= 1)
 		return -1;
 
-	//copy all arguments
-	while(i < args_length && i < nbytes){
-		buf[i] = pcb_ptr->args[i];
-		i++;
+	//copy all arguments, argv[0] is the program. Each one is copied with
+	//its NUL, which the next space overwrites
+	for(i = 1; i < pcb_ptr->argc; i++){
+		if(copy_from_user(&arg, &pcb_ptr->argv[i], sizeof(arg)) != 0)
+			return -1;
+		if(i > 1){
+			if(len >= nbytes || copy_to_user(&buf[len], " ", 1) != 0)
+				return -1;
+			len++;
+		}
+		arg_len = strncpy_from_user((int8_t*)&buf[len], arg, nbytes - len);
+		if(arg_len < 0)
+			return -1;
+		len += arg_len;
 	}
-	//null terminate buffer
-	buf[i] = '\0';
 	return 0;
 }
 
@@ -521,43 +1228,358 @@ int32_t getargs (uint8_t* buf, int32_t nbytes){
  *   SIDE EFFECTS: 	changes paging structure: creates user level page; flushes tlb
  */
 int32_t vidmap (uint8_t** screen_start){
+	uint8_t* addr;	//user address of video memory
+
 	//error check screen_start (is in user space, not null)
-	if(screen_start 
-	   && ((uint32_t)screen_start >= (USER_PD_INDEX << ALIGN_4MB))
-	   && ((uint32_t)screen_start < (((USER_PD_INDEX+1) << ALIGN_4MB) - 4)))
-		*screen_start = (uint8_t*)create_vid_4kb_page(); //create page and copy to screen_start
-	else
+	if(!access_ok(screen_start, sizeof(*screen_start)))
 		return -1;
+	addr = (uint8_t*)create_vid_4kb_page(); //create page and copy to screen_start
 	// printf("VIDMAP CALLED in process: %d\n", get_current_executing_pcb()->process_id);
 	reload_cr3();
-	return 0;
+	return copy_to_user(screen_start, &addr, sizeof(addr));
 }
 
 /*
  * set_handler
  *   DESCRIPTION: 	Related to signal handling and changes the default action taken when a
- *					signal is recieved. 
+ *					signal is recieved. A NULL handler restores the default action.
  *   INPUTS: 		int32_t signum : value of signal number
  					void* handler_address : pointer to the handler address
  *   OUTPUTS: 		none
- *   RETURN VALUE: 	-1 our system calls do not have use for this function.
- *   SIDE EFFECTS: 	none
+ *   RETURN VALUE: 	0 on success, -1 for a bad signal number or handler address
+ *   SIDE EFFECTS: 	Changes the signal handlers in the pcb
  */
 int32_t set_handler (int32_t signum, void* handler_address){
-	return -1;
+	if (signum < 0 || signum >= NUM_SIGNALS)
+		return -1;
+	// the handler must lie in the user program page
+	if (handler_address != NULL
+	   && (((uint32_t)handler_address < (USER_PD_INDEX << ALIGN_4MB))
+	   || ((uint32_t)handler_address >= ((USER_PD_INDEX+1) << ALIGN_4MB))))
+		return -1;
+	get_current_executing_pcb()->sig_handlers[signum] = handler_address;
+	return 0;
 }
 
 /*
  * sigreturn
  *   DESCRIPTION: 	Copy the hardware context that was on the user level stack back onto the
- *					processor.
+ *					processor. Called by the trampoline delivery left on the user stack
+ *					once the handler returns, through int $0x80 so that the context the
+ *					syscall wrapper restores is the one saved at the top of the kernel
+ *					stack. The handler may have changed the saved registers; segments and
+ *					privileged flags are not taken from the user stack.
  *   INPUTS: 		void
  *   OUTPUTS: 		none
- *   RETURN VALUE: 	-1 our system calls do not have use for this function.
- *   SIDE EFFECTS: 	none
+ *   RETURN VALUE: 	the saved eax, so the wrapper puts it back
+ *   SIDE EFFECTS: 	Unmasks signals
  */
 int32_t sigreturn (void){
-	return -1;
+	pcb_t* current = get_current_executing_pcb();
+	hw_context_t* context = user_context();
+	sigframe_t* frame;
+	hw_context_t saved;
+
+	// the handler's ret popped ret_addr, so esp points at signum
+	frame = (sigframe_t*)(context->esp - sizeof(frame->ret_addr));
+	if (!current->sig_masked
+	   || copy_from_user(&saved, &frame->context, sizeof(saved)) != 0)
+		return -1;
+
+	saved.vector = context->vector;
+	saved.error_code = context->error_code;
+	*context = saved;
+	context->cs = USER_CS;
+	context->ss = USER_DS;
+	context->eflags = (context->eflags & USER_EFLAGS) | EFLAGS_IF;
+
+	current->sig_masked = 0;
+	return context->eax;
+}
+
+/*
+ * poll
+ *   DESCRIPTION: 	Waits until at least one of the given file descriptors is
+ *					ready or the timeout runs out. Each descriptor's poll
+ *					operation reports which events are ready and registers the
+ *					process on the wait queue of its device, so a single sleep
+ *					covers all of them. The timeout is rounded up to PIT ticks,
+ *					at most TIMER_MAX_TICKS.
+ *   INPUTS: 		fds : array of descriptors and the events wanted for each
+ *					nfds : number of entries in fds, at most POLL_MAX_FDS
+ *					timeout : milliseconds to wait, 0 to return at once, negative
+ *							  to wait forever
+ *   OUTPUTS: 		fills in revents of every entry in fds
+ *   RETURN VALUE: 	number of entries with revents set, 0 on timeout,
+ *					-1 for failure
+ *   SIDE EFFECTS: 	May put the process to sleep
+ */
+int32_t poll (pollfd_t* fds, int32_t nfds, int32_t timeout){
+	pcb_t* pcb_ptr; // Pointer to this task's pcb
+	fd_entry_t* fd_entry; // Entry being checked
+	pollfd_t kfds[POLL_MAX_FDS]; // Copy of fds, copied back once done
+	uint32_t ticks; // length of the timeout in PIT ticks
+	uint32_t deadline; // PIT tick at which the timeout runs out
+	int32_t ready; // Number of ready entries
+	int i; // Iterator
+
+	// fds must lie in user memory
+	if(nfds < 0 || nfds > POLL_MAX_FDS
+	   || copy_from_user(kfds, fds, nfds * sizeof(pollfd_t)) != 0)
+		return -1;
+
+	pcb_ptr = get_current_executing_pcb();
+	// divided first so that a long timeout cannot overflow, and cut like
+	// timespec_to_ticks so that the deadline stays in the future
+	ticks = timeout / PIT_TICK_MS + (timeout % PIT_TICK_MS != 0);
+	if(timeout > 0 && ticks > TIMER_MAX_TICKS)
+		ticks = TIMER_MAX_TICKS;
+	deadline = pit_ticks + ticks;
+
+	cli();
+	// the sleep timer wakes us when the timeout runs out
+	if(timeout > 0)
+		add_timer(&pcb_ptr->sleep_timer, deadline);
+	while(1){
+		ready = 0;
+		for(i = 0; i < nfds; i++){
+			kfds[i].revents = 0;
+			if(kfds[i].fd < 0 || kfds[i].fd >= FD_ARRAY_LEN || !pcb_ptr->fd_array[kfds[i].fd].active){
+				kfds[i].revents = POLLNVAL;
+			} else {
+				fd_entry = &pcb_ptr->fd_array[kfds[i].fd];
+				kfds[i].revents = (*(fd_entry->fo_jump_table_ptr->poll))(kfds[i].fd) & kfds[i].events;
+			}
+			if(kfds[i].revents)
+				ready++;
+		}
+		if(ready || timeout == 0 || (timeout > 0 && (int32_t)(pit_ticks - deadline) >= 0))
+			break;
+		sleep_current();
+	}
+	del_timer(&pcb_ptr->sleep_timer);
+	sti();
+	if(copy_to_user(fds, kfds, nfds * sizeof(pollfd_t)) != 0)
+		return -1;
+	return ready;
+}
+
+/*
+ * fcntl
+ *   DESCRIPTION: 	Gets or sets the flags of an open file descriptor. The only
+ *					flag that may be changed is O_NONBLOCK.
+ *   INPUTS: 		fd : file descriptor to change
+ *					cmd : F_GETFL or F_SETFL
+ *					arg : new flags for F_SETFL, unused for F_GETFL
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	the flags for F_GETFL, 0 for F_SETFL, -1 for failure
+ *   SIDE EFFECTS: 	none
+ */
+int32_t fcntl (int32_t fd, int32_t cmd, int32_t arg){
+	fd_entry_t* fd_entry; // Entry being changed
+
+	if (fd < 0 || fd >= FD_ARRAY_LEN)
+		return -1;
+	fd_entry = &get_current_executing_pcb()->fd_array[fd];
+	if (!fd_entry->active)
+		return -1;
+
+	switch (cmd) {
+		case F_GETFL:
+			return fd_entry->nonblock ? O_NONBLOCK : 0;
+		case F_SETFL:
+			fd_entry->nonblock = (arg & O_NONBLOCK) ? 1 : 0;
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+/*
+ * ioctl
+ *   DESCRIPTION: 	Passes a device specific command to the driver behind a
+ *					file descriptor, such as switching the terminal between raw
+ *					and cooked mode.
+ *   INPUTS: 		fd : file descriptor to control
+ *					cmd : driver specific command
+ *					arg : driver specific argument
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	driver specific, -1 for failure
+ *   SIDE EFFECTS: 	driver specific
+ */
+int32_t ioctl (int32_t fd, int32_t cmd, int32_t arg){
+	fd_entry_t* fd_entry; // Entry being controlled
+
+	if (fd < 0 || fd >= FD_ARRAY_LEN)
+		return -1;
+	fd_entry = &get_current_executing_pcb()->fd_array[fd];
+	if (!fd_entry->active)
+		return -1;
+
+	return (*(fd_entry->fo_jump_table_ptr->ioctl))(fd, cmd, arg);
+}
+
+/*
+ * sqe_ok
+ *   DESCRIPTION: 	Checks that the buffer of a queued operation lies in the
+ *					program's memory before it runs: nbytes of it for a read
+ *					or write, the start of the filename for an open.
+ *   INPUTS: 		sqe : operation copied from the ring
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	1 if the operation may run, 0 if not
+ *   SIDE EFFECTS: 	none
+ */
+static int32_t sqe_ok (const sqe_t* sqe){
+	switch(sqe->opcode){
+		case RING_OP_READ:
+		case RING_OP_WRITE:
+			return sqe->buf != NULL && sqe->nbytes >= 0 && access_ok(sqe->buf, sqe->nbytes);
+		case RING_OP_OPEN:
+			return access_ok(sqe->buf, 1);
+		default:
+			return 1;
+	}
+}
+
+/*
+ * submit
+ *   DESCRIPTION: 	Runs the operations a program queued on its submission
+ *					ring, in order, and posts the result of each one to the
+ *					completion queue. Lets a program do a batch of reads,
+ *					writes, opens and closes with a single trap. Stops early
+ *					when the completion queue is full; the rest stay queued.
+ *					An operation whose buffer is not the program's completes
+ *					with -1 without running.
+ *   INPUTS: 		ring : submission and completion queues in user memory, which
+ *						   may be a shared memory segment
+ *   OUTPUTS: 		advances sq_head and cq_tail and fills completions
+ *   RETURN VALUE: 	number of operations run, -1 for failure
+ *   SIDE EFFECTS: 	Those of the queued operations, may put the process to sleep
+ */
+int32_t submit (ring_t* ring){
+	sqe_t sqe; // Operation being run, copied so the program cannot change it midway
+	cqe_t cqe; // Completion being posted
+	uint32_t head, tail; // Submission queue indices
+	uint32_t cq_head, cq_tail; // Completion queue indices
+	int32_t result; // Result of the operation
+	int32_t done; // Number of operations run
+
+	// ring must lie in user memory
+	if(!access_ok(ring, sizeof(*ring))
+	   || copy_from_user(&head, &ring->sq_head, sizeof(head)) != 0
+	   || copy_from_user(&tail, &ring->sq_tail, sizeof(tail)) != 0
+	   || copy_from_user(&cq_head, &ring->cq_head, sizeof(cq_head)) != 0
+	   || copy_from_user(&cq_tail, &ring->cq_tail, sizeof(cq_tail)) != 0)
+		return -1;
+	if(tail - head > RING_ENTRIES || cq_tail - cq_head > RING_ENTRIES)
+		return -1;
+
+	done = 0;
+	while(head != tail && cq_tail - cq_head < RING_ENTRIES){
+		if(copy_from_user(&sqe, &ring->sq[head & RING_MASK], sizeof(sqe)) != 0)
+			return -1;
+		switch(sqe_ok(&sqe) ? sqe.opcode : 0){
+			case RING_OP_READ:
+				result = read(sqe.fd, sqe.buf, sqe.nbytes);
+				break;
+			case RING_OP_WRITE:
+				result = write(sqe.fd, sqe.buf, sqe.nbytes);
+				break;
+			case RING_OP_OPEN:
+				result = open((uint8_t*)sqe.buf);
+				break;
+			case RING_OP_CLOSE:
+				result = close(sqe.fd);
+				break;
+			default:
+				result = -1;
+				break;
+		}
+		cqe.user_data = sqe.user_data;
+		cqe.result = result;
+		head++;
+		if(copy_to_user(&ring->cq[cq_tail & RING_MASK], &cqe, sizeof(cqe)) != 0)
+			return -1;
+		cq_tail++;
+		// the program may have read completions while an operation slept
+		if(copy_to_user(&ring->cq_tail, &cq_tail, sizeof(cq_tail)) != 0
+		   || copy_to_user(&ring->sq_head, &head, sizeof(head)) != 0
+		   || copy_from_user(&cq_head, &ring->cq_head, sizeof(cq_head)) != 0)
+			return -1;
+		done++;
+	}
+	return done;
+}
+
+/*
+ * pipe
+ *   DESCRIPTION: 	Creates a pipe and opens both of its ends on the two lowest
+ *					free file descriptors. Data written to the write end is read
+ *					back from the read end in order. Children started with
+ *					execute inherit stdin and stdout, so the shell connects two
+ *					programs by moving the ends there with dup2.
+ *   INPUTS: 		fds : array of two ints in user space
+ *   OUTPUTS: 		fds[0] gets the read end, fds[1] the write end
+ *   RETURN VALUE: 	0 for success, -1 for failure
+ *   SIDE EFFECTS: 	none
+ */
+int32_t pipe (int32_t* fds){
+	fd_entry_t* fd_array; // Array of file descriptors in this pcb
+	int32_t read_fd, write_fd; // Descriptors for the two ends
+	int32_t ends[2]; // The two descriptors, copied out to fds
+
+	// fds must lie in user memory
+	if(!access_ok(fds, sizeof(ends)))
+		return -1;
+
+	fd_array = get_current_executing_pcb()->fd_array;
+	for(read_fd = 2; read_fd < FD_ARRAY_LEN && fd_array[read_fd].active; read_fd++);
+	for(write_fd = read_fd + 1; write_fd < FD_ARRAY_LEN && fd_array[write_fd].active; write_fd++);
+	if(write_fd >= FD_ARRAY_LEN)
+		return -1;
+
+	if(pipe_create(&fd_array[read_fd], &fd_array[write_fd]) != 0)
+		return -1;
+	ends[0] = read_fd;
+	ends[1] = write_fd;
+	if(copy_to_user(fds, ends, sizeof(ends)) != 0){
+		// the program could not learn the descriptors, so close them
+		pipe_release(&fd_array[read_fd]);
+		pipe_release(&fd_array[write_fd]);
+		fd_array[read_fd].flags = 0;
+		fd_array[write_fd].flags = 0;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * dup2
+ *   DESCRIPTION: 	Makes new_fd refer to the same file, device or pipe end as
+ *					old_fd, closing whatever new_fd had open first. Unlike close,
+ *					this may replace stdin and stdout. A copied file descriptor
+ *					keeps its own file position.
+ *   INPUTS: 		old_fd : descriptor to copy
+ *					new_fd : descriptor to replace
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	new_fd for success, -1 for failure
+ *   SIDE EFFECTS: 	none
+ */
+int32_t dup2 (int32_t old_fd, int32_t new_fd){
+	fd_entry_t* fd_array; // Array of file descriptors in this pcb
+
+	if (old_fd < 0 || old_fd >= FD_ARRAY_LEN || new_fd < 0 || new_fd >= FD_ARRAY_LEN)
+		return -1;
+	fd_array = get_current_executing_pcb()->fd_array;
+	if (!fd_array[old_fd].active)
+		return -1;
+	if (old_fd == new_fd)
+		return new_fd;
+
+	pipe_release(&fd_array[new_fd]);
+	fd_array[new_fd] = fd_array[old_fd];
+	pipe_dup(&fd_array[new_fd]);
+	return new_fd;
 }
 
 /*
@@ -600,8 +1622,9 @@ void boot(){
 		reload_cr3();	
 
 		//PROGRAM LOADER: COPY IMAGE INTO VIRTUAL ADDRESS________________________________
-		bytes_to_read = inodes[dentry.inode_index].length;
+		bytes_to_read = inode_length(dentry.inode_index);
 		exec_term_id = i;
+		set_current(i);
 		read_data(dentry.inode_index, 0, (uint8_t*)PROGRAM_LOAD_VIRT_ADDRESS, bytes_to_read);
 		read_data(dentry.inode_index, ENTRY_POINT_OFFSET, (uint8_t*)(&entry_point), 4); // get entry point
 
@@ -612,17 +1635,22 @@ void boot(){
 		// initialize stdin and stdout
 		pcb->fd_array[0].fo_jump_table_ptr = &stdin_jump_table;
 		pcb->fd_array[1].fo_jump_table_ptr = &stdout_jump_table;
+		pcb->fd_array[0].flags = 0;
+		pcb->fd_array[1].flags = 0;
 		pcb->fd_array[0].active = 1;
 		pcb->fd_array[1].active = 1;
 		//fill entry point into program
 		pcb->entry = entry_point;
-		//fill argument string in pcb
-		pcb->args[0] = '\0';
+		// no arguments, and the default environment for its children
+		pcb->argc = 0;
+		pcb->argv = NULL;
+		pcb->envp = NULL;
 		// Clear the rest of the FD array
 		for (j = 2; j < FD_ARRAY_LEN; j++) {
-			pcb->fd_array[j].active = 0;
+			pcb->fd_array[j].flags = 0;
 		}
 		pcb->process_id = i; // PID
+		pcb->state = TASK_RUNNING;
 
 		//save parent ebp and esp
 		asm volatile("movl %%esp, %0":"=g"(pcb->parent_esp));
@@ -630,14 +1658,22 @@ void boot(){
 
 		pcb->parent_pcb = NULL;
 		pcb->child_pcb = NULL;
+		pcb->term_id = i;
+		pcb->spawned = 0;
+		pcb->ldisc_mode = LDISC_COOKED;
+		pcb->exit_status = 0;
+		init_wait_queue(&pcb->child_wq);
+		init_signals(pcb);
+		init_process_timers(pcb);
 	}
 	curr_term_id = 0;
 	exec_term_id = 0;
+	set_current(0);
 	create_user_4mb_page(exec_term_id + 2, USER_PD_INDEX); //remap to first shell (index 2)
 	reload_cr3();	
 	// CONTEXT SWITCH_______________________________________________________________
 	//update tss
-	tss.esp0 = (uint32_t)(get_pcb_by_PID(exec_term_id -1) - 4);		//kernel stack pointer
+	tss.esp0 = get_kernel_stack_by_PID(exec_term_id);		//kernel stack pointer
 	tss.ss0 = KERNEL_DS;			//kernal data segment = kernal stack segment
 
 	processes[0] = 1;				//set first process to active
@@ -701,19 +1737,30 @@ pcb_t* get_pcb_by_PID(int PID){
 }
 
 /*
- * get_current_executing_pcb
- *   DESCRIPTION: 	Obtains the pcb_t pointer based upon the currently executing terminal id.
- * 					Then we walk down the list of child nodes inorder to find the child executing
- *					on the specific executing terminal. Once we have obtained the child node we return
- * 					the pcb pointer to it. 
- *   INPUTS: 		none
+ * get_kernel_stack_by_PID
+ *   DESCRIPTION: 	Obtains the address the kernel stack of a process starts at,
+ *					the last word below the block holding the process's pcb.
+ *   INPUTS: 		int PID : PID value we want the kernel stack for
  *   OUTPUTS: 		none
- *   RETURN VALUE: 	pcb_t* : pointer to pcb based on currently executing terminal id
+ *   RETURN VALUE: 	uint32_t : value for esp0 when running this process
  *   SIDE EFFECTS: 	none
  */
-pcb_t* get_current_executing_pcb() {
+uint32_t get_kernel_stack_by_PID(int PID){
+	return _8MEGA - (PID * _8KILO) - 4;		//-4 to stay inside the block
+}
+
+/*
+ * get_terminal_pcb
+ *   DESCRIPTION: 	Obtains the pcb_t pointer of the process running on a terminal
+ *					by walking down from the terminal's shell to the leaf child.
+ *   INPUTS: 		int term_id : terminal to look at
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	pcb_t* : pointer to pcb of the terminal's running process
+ *   SIDE EFFECTS: 	none
+ */
+pcb_t* get_terminal_pcb(int term_id) {
 	// Get the current top-level node
-	pcb_t* curr_node = get_pcb_by_PID(exec_term_id);
+	pcb_t* curr_node = get_pcb_by_PID(term_id);
 	// Traverse its children (if any) until you find a task
 	// with no children
 	while (curr_node->child_pcb != NULL)
@@ -722,6 +1769,22 @@ pcb_t* get_current_executing_pcb() {
 	return curr_node;
 }
 
+/*
+ * fd_is_nonblocking
+ *   DESCRIPTION: 	Checks whether O_NONBLOCK is set on a file descriptor of the
+ *					currently executing process. Used by device reads to decide
+ *					between sleeping and returning ERR_AGAIN.
+ *   INPUTS: 		int32_t fd : file descriptor to check
+ *   OUTPUTS: 		none
+ *   RETURN VALUE: 	1 if non-blocking, 0 otherwise
+ *   SIDE EFFECTS: 	none
+ */
+int fd_is_nonblocking(int32_t fd){
+	if (fd < 0 || fd >= FD_ARRAY_LEN)
+		return 0;
+	return get_current_executing_pcb()->fd_array[fd].nonblock;
+}
+
 /*
  * get_current_displaying_pcb
  *   DESCRIPTION: 	Obtains the pcb_t pointer based upon the currently displaying terminal id.
@@ -734,14 +1797,7 @@ pcb_t* get_current_executing_pcb() {
  *   SIDE EFFECTS: 	none
  */
 pcb_t* get_current_displaying_pcb() {
-	// Get the current top-level node
-	pcb_t* curr_node = get_pcb_by_PID(curr_term_id);
-	// Traverse its children (if any) until you find a task
-	// with no children
-	while (curr_node->child_pcb != NULL)
-		curr_node = curr_node->child_pcb;
-	// At leaf node
-	return curr_node;
+	return get_terminal_pcb(curr_term_id);
 }
 
 
@@ -9,9 +9,12 @@
 #include "fs.h"
 #include "x86_desc.h"
 #include "rtc.h"
+#include "wait.h"
+#include "signal.h"
+#include "timer.h"
+#include "bcache.h"
 
 #define FD_ARRAY_LEN 8                   // file descriptor array length
-#define MAX_CMD_SIZE 128                 // max size of a command 
 
 #define _8MEGA	0x800000 		//8mb
 #define _8KILO	0x1000			//4kb
@@ -19,6 +22,89 @@
 
 #define MAX_NUM_PROCESSES 7
 
+/* process states */
+#define TASK_RUNNING 0                   // may be picked by the scheduler
+#define TASK_SLEEPING 1                  // waiting on a wait queue
+#define TASK_ZOMBIE 2                    // halted spawned process not yet waited for
+#define TASK_NEW 3                       // being loaded, not runnable yet
+
+/* waitpid options */
+#define WNOHANG 1                        // return 0 instead of sleeping
+
+/* error returned by a non-blocking read that would block */
+#define ERR_AGAIN -2
+
+/* poll events */
+#define POLLIN 0x0001                    // data may be read without blocking
+#define POLLOUT 0x0004                   // data may be written without blocking
+#define POLLNVAL 0x0020                  // fd is not open
+#define POLL_MAX_FDS FD_ARRAY_LEN        // most entries one poll call may watch
+
+/* fcntl commands and flags */
+#define F_GETFL 1                        // returns the fd's flags
+#define F_SETFL 2                        // sets the fd's flags
+#define O_NONBLOCK 0x1                   // reads return ERR_AGAIN instead of blocking
+
+/* The structure poll reads the fds to watch from and writes results to. */
+typedef struct pollfd_t {
+    int32_t fd;                                 // file descriptor to watch
+    int16_t events;                             // events the caller is interested in
+    int16_t revents;                            // events that are ready, filled by poll
+} pollfd_t;
+
+/* One directory entry as getdents returns it. Records are packed one after
+ * the other in the caller's buffer. */
+typedef struct dirent_t {
+    uint32_t inode_index;                       // inode of the entry, 0 for the RTC
+    uint32_t file_type;                         // one of the FS_TYPE_*
+    uint32_t length;                            // size in bytes
+    uint8_t name[FS_FILE_NAME_LEN + 1];         // NUL terminated
+    uint8_t reserved[3];                        // pads the record to 48 bytes
+} dirent_t;
+
+/* What stat and fstat report about a file, directory or the RTC. */
+typedef struct stat_t {
+    uint32_t inode_index;                       // inode of the file, 0 for the RTC
+    uint32_t file_type;                         // one of the FS_TYPE_*
+    uint32_t length;                            // size in bytes
+    uint32_t blocks;                            // data blocks the file uses
+} stat_t;
+
+/* submission ring operations */
+#define RING_OP_READ 1                   // read(fd, buf, nbytes)
+#define RING_OP_WRITE 2                  // write(fd, buf, nbytes)
+#define RING_OP_OPEN 3                   // open(buf), buf holds the filename
+#define RING_OP_CLOSE 4                  // close(fd)
+#define RING_ENTRIES 16                  // slots in each queue, a power of two
+#define RING_MASK (RING_ENTRIES - 1)     // turns a free running index into a slot
+
+/* An operation queued by a user program. */
+typedef struct sqe_t {
+    int32_t opcode;                             // one of RING_OP_*
+    int32_t fd;                                 // file descriptor to act on
+    void* buf;                                  // data buffer or filename
+    int32_t nbytes;                             // bytes to read or write
+    uint32_t user_data;                         // copied to the completion
+} sqe_t;
+
+/* The result of one operation, posted by the kernel. */
+typedef struct cqe_t {
+    uint32_t user_data;                         // user_data of the operation
+    int32_t result;                             // what the system call returned
+} cqe_t;
+
+/* Submission and completion queues shared between a program and the kernel.
+ * Indices run freely and are masked with RING_MASK. The program owns sq_tail
+ * and cq_head, the kernel owns sq_head and cq_tail. */
+typedef struct ring_t {
+    uint32_t sq_head;                           // next operation the kernel takes
+    uint32_t sq_tail;                           // next free submission slot
+    uint32_t cq_head;                           // next completion the program reads
+    uint32_t cq_tail;                           // next free completion slot
+    sqe_t sq[RING_ENTRIES];                     // submission queue
+    cqe_t cq[RING_ENTRIES];                     // completion queue
+} ring_t;
+
 /* Terminates a process and returns specific value to parent process. */    
 int32_t halt (uint8_t status);
 /* Loads and executes a new program. */
@@ -39,6 +125,40 @@ int32_t vidmap (uint8_t** screen_start);
 int32_t set_handler (int32_t signum, void* handler_address);
 /* Signal handling. */
 int32_t sigreturn (void);
+/* Waits until one of a set of file descriptors is ready. */
+int32_t poll (pollfd_t* fds, int32_t nfds, int32_t timeout);
+/* Gets or sets the flags of a file descriptor. */
+int32_t fcntl (int32_t fd, int32_t cmd, int32_t arg);
+/* Sends a device specific command to a file descriptor. */
+int32_t ioctl (int32_t fd, int32_t cmd, int32_t arg);
+/* Runs the operations queued on a submission ring. */
+int32_t submit (ring_t* ring);
+/* Creates a pipe and returns its read and write ends. */
+int32_t pipe (int32_t* fds);
+/* Makes one file descriptor a copy of another. */
+int32_t dup2 (int32_t old_fd, int32_t new_fd);
+/* Starts a new program without waiting for it to halt. */
+int32_t spawn (const uint8_t* command);
+/* Waits for a spawned child to halt and collects its status. */
+int32_t waitpid (int32_t pid, int32_t* status, int32_t options);
+/* Sleeps for a length of time. */
+int32_t nanosleep (const timespec_t* req, timespec_t* rem);
+/* Reads a clock. */
+int32_t clock_gettime (int32_t clock_id, timespec_t* tp);
+/* Arms or disarms the interval timer that sends ALARM. */
+int32_t setitimer (int32_t which, const itimerval_t* new_value, itimerval_t* old_value);
+/* Creates or empties a file and opens it. */
+int32_t create (const uint8_t* filename);
+/* Sets the length of an open file. */
+int32_t truncate (int32_t fd, int32_t length);
+/* Reads the block cache counters. */
+int32_t bcache_stats (bcache_stats_t* stats);
+/* Reads as many entries of an open directory as fit in the buffer. */
+int32_t getdents (int32_t fd, dirent_t* buf, int32_t nbytes);
+/* Reads the type, size and inode of a file by its path. */
+int32_t stat (const uint8_t* filename, stat_t* buf);
+/* Reads the type, size and inode of an open file, directory or RTC. */
+int32_t fstat (int32_t fd, stat_t* buf);
 
 
 /* loads 3 shells */
@@ -48,26 +168,31 @@ typedef int32_t (*open_t)(const uint8_t* filename);
 typedef int32_t (*read_t)(int32_t fd, void* buf, int32_t nbytes);
 typedef int32_t (*write_t)(int32_t fd, const void* buf, int32_t nbytes);
 typedef int32_t (*close_t)(int32_t fd);
+typedef int32_t (*poll_t)(int32_t fd);
+typedef int32_t (*ioctl_t)(int32_t fd, int32_t cmd, int32_t arg);
 
-/* The structure for the file operations jump table containing open, read, write, close. */
+/* The structure for the file operations jump table containing open, read, write, close, poll, ioctl. */
 typedef struct fo_jump_table_t {
     open_t open;
     read_t read;
     write_t write;
     close_t close;
+    poll_t poll;                                // returns the POLL* events that are ready
+    ioctl_t ioctl;                              // device specific control
 } fo_jump_table_t;
 
 
 /* The structure for an entry in a file descriptor table. */
 typedef struct fd_entry_t {
     fo_jump_table_t* fo_jump_table_ptr;         // Pointer to the jump table allocated for this entry
-    uint32_t inode_index;                       // Index of the inode, 0 if not a file
+    uint32_t inode_index;                       // Inode of a file or directory, else 0
     uint32_t file_position;                     // Position in the file that's been read
     union {
         uint32_t flags;                         // bit 0 is whether or not the fd is in use
         struct {
             uint32_t active       :1;           // Is fd active or not
-            uint32_t reserved     :31;          // reserved for future use
+            uint32_t nonblock     :1;           // O_NONBLOCK, reads fail instead of sleeping
+            uint32_t reserved     :30;          // reserved for future use
         } __attribute__ ((packed));
     };
 } fd_entry_t;
@@ -81,20 +206,60 @@ typedef struct pcb_t {
     uint32_t parent_esp;                       //this process's stack pointer
     struct pcb_t * parent_pcb;                 //pointer to process's parent pcb
     struct pcb_t * child_pcb;                  //pointer to process's child pcb
-    uint8_t args[MAX_CMD_SIZE];
-    uint32_t return_ebp;
-    uint32_t return_esp;
+    uint32_t argc;                             //number of words in the command
+    uint8_t** argv;                            //the words, on the user stack
+    uint8_t** envp;                            //environment strings, on the user stack
+    uint32_t user_esp;                         //user stack pointer to start with
+    uint32_t return_esp;                       //kernel stack pointer saved by switch_context
     uint32_t entry;
+    volatile uint32_t state;                   //one of the TASK_* states
+    uint8_t term_id;                           //terminal the process reads and writes
+    uint8_t spawned;                           //started by spawn, reaped by waitpid
+    uint8_t ldisc_mode;                        //terminal's line discipline mode at execute
+    int32_t exit_status;                       //status passed to halt, for waitpid
+    wait_queue_t child_wq;                     //woken when a spawned child halts
+    uint32_t sig_pending;                      //one bit for each signal waiting for delivery
+    uint32_t sig_masked;                       //set while a signal handler runs
+    void* sig_handlers[NUM_SIGNALS];           //user handler for each signal, NULL for default
+    ktimer_t sleep_timer;                      //wakes the process from nanosleep and poll
+    ktimer_t alarm_timer;                      //sends ALARM for setitimer
+    uint32_t alarm_interval;                   //ticks between alarms, 0 for one alarm
 } pcb_t;
 
 /* Obtains the PCB given a specified process ID. */
 pcb_t* get_pcb_by_PID(int PID);
-/* returns a pointer to the PCB of the current task */
-pcb_t* get_current_executing_pcb();
+/* Obtains the top of the kernel stack given a specified process ID. */
+uint32_t get_kernel_stack_by_PID(int PID);
+/* returns a pointer to the PCB of the task running on a terminal */
+pcb_t* get_terminal_pcb(int term_id);
+/* returns whether a file descriptor of the current task is non-blocking */
+int fd_is_nonblocking(int32_t fd);
 /* returns a pointer to teh PCB of the current displaying task */
 pcb_t* get_current_displaying_pcb();
 
 /* array of active process ids; active high */
 uint8_t processes[MAX_NUM_PROCESSES];
+/* PID of the process the processor is running */
+int current_pid;
+/* PCB of that process, kept next to current_pid so finding it is one load */
+pcb_t* current_pcb;
+
+/* set_current
+ * Description: Makes a process the current one. Every switch of kernel
+ *              stacks goes through here, so current_pcb always matches the
+ *              stack the processor runs on.
+ * Inputs: pid - process about to run
+ * Outputs: None
+ * Side Effects: sets current_pid and current_pcb
+ */
+static inline void set_current(int pid) {
+    current_pid = pid;
+    current_pcb = (pcb_t*)(_8MEGA - ((pid + 1) * _8KILO));
+}
+
+/* returns a pointer to the PCB of the current task */
+static inline pcb_t* get_current_executing_pcb() {
+    return current_pcb;
+}
 
 #endif /* _SYSCALL_H */
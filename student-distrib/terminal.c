@@ -1,7 +1,19 @@
 #include "terminal.h"
+#include "serial.h"
+#include "ldisc.h"
+#include "shm.h"
+#include "uaccess.h"
 
 #define VIDEO       0xB8000
 #define ATTRIB      0x7
+#define FG_MASK     0x0F
+#define BG_MASK     0xF0 // color and intensity, like the foreground
+#define BRIGHT      0x08
+
+/* VGA color index for each ANSI color (black red green yellow blue magenta cyan white) */
+static const uint8_t ansi_to_vga[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+static void term_putc(uint8_t c, int term_id);
 // stores all terminals
 
 /* init_terminal 
@@ -19,6 +31,11 @@ void init_terminal() {
 		terms[i].buff_save[0] = '\0';
 		terms[i].enters_save = 0;
 		terms[i].buff_index_save = 0;
+		terms[i].attrib_save = ATTRIB;
+		terms[i].esc_state = ANSI_NORMAL;
+		terms[i].esc_nparams = 0;
+		init_wait_queue(&terms[i].input_wq);
+		terms[i].ldisc_mode = LDISC_COOKED;
 		// initialize nondisplay buffers to blank
 		for (j = 0; j < NUM_ROWS * NUM_COLS; j++) {
 	        *(uint8_t *)(terms[i].vid_save + (j << 1)) = ' ';
@@ -38,39 +55,74 @@ void init_terminal() {
  */
 void switch_displaying_term(int term_id) {
 	pcb_t * pcb;
+	pcb_t * prev_pcb;
+	uint32_t dirty_rows;
+	int row;
 	//printf("REACHED\n");
 	// save curr terminal data: key_buff, video memory, coordinates, num_enters
 	memcpy(terms[curr_term_id].buff_save, (uint8_t*)key_buff, (uint32_t)KEY_BUFF_SIZE);
-	memcpy(terms[curr_term_id].vid_save, (uint8_t*)VIDEO, (uint32_t)VID_SIZE);
+	// only rows written since the last switch differ from the saved screen
+	dirty_rows = take_vga_dirty_rows();
+	if(take_vid_page_dirty())
+		dirty_rows = VGA_ALL_ROWS;
+	for(row = 0; row < NUM_ROWS; row++){
+		if(dirty_rows & (1 << row))
+			memcpy(terms[curr_term_id].vid_save + row * ROW_SIZE, (uint8_t*)VIDEO + row * ROW_SIZE, ROW_SIZE);
+	}
 	terms[curr_term_id].x_save = get_x();
 	terms[curr_term_id].y_save = get_y();
 	terms[curr_term_id].enters_save = num_enters;
 	terms[curr_term_id].buff_index_save = buff_index;
+	terms[curr_term_id].attrib_save = get_attrib();
 
 	// load new terminal data: key_buff, video memory, coordinates
 	memcpy((uint8_t*)key_buff, terms[term_id].buff_save, (uint32_t)KEY_BUFF_SIZE);
-	memcpy((uint8_t*)VIDEO, terms[term_id].vid_save, (uint32_t)VID_SIZE);
+	// the screen now matches the old terminal's buffer, so only rows that
+	// differ between the two terminals need to be written to video memory
+	for(row = 0; row < NUM_ROWS; row++){
+		if(memcmp(terms[curr_term_id].vid_save + row * ROW_SIZE, terms[term_id].vid_save + row * ROW_SIZE, ROW_SIZE))
+			memcpy((uint8_t*)VIDEO + row * ROW_SIZE, terms[term_id].vid_save + row * ROW_SIZE, ROW_SIZE);
+	}
 	set_x(terms[term_id].x_save);
 	set_y(terms[term_id].y_save);
 	num_enters = terms[term_id].enters_save;
 	buff_index = terms[term_id].buff_index_save;
+	set_attrib(terms[term_id].attrib_save);
 
 	curr_term_id = term_id;
 	send_eoi(KEYBOARD_IRQ);
 
+	// a vidmap user on either terminal must now draw into the right buffer
+	remap_vid(exec_term_id);
+	reload_cr3();
+
+	//a reader on the new terminal may have a line waiting
+	wake_up(&terms[term_id].input_wq);
+
 	//start shell execution if not already initialized
 	if(!processes[curr_term_id]){
 		//intialize shell id and remap
 		processes[curr_term_id] = 1;
 		create_user_4mb_page(term_id + 2, 32);
+		remap_shm(term_id);
 		reload_cr3();	
 
 		pcb = get_pcb_by_PID(term_id);
-		tss.esp0 = (uint32_t)(get_pcb_by_PID(term_id - 1) - 4);		//kernel stack pointer
+		prev_pcb = get_current_executing_pcb();
+		tss.esp0 = get_kernel_stack_by_PID(term_id);		//kernel stack pointer
 		tss.ss0 = KERNEL_DS;			//kernal data segment = kernal stack segment	
 		exec_term_id = term_id;
+		set_current(term_id);
+		/* Save our context the way switch_context does so the scheduler
+		 * can resume the interrupted process at label 1 later. */
 		asm volatile ("            \n\
 	        cli                    \n\
+	        pushl $1f              \n\
+	        pushl %%ebp            \n\
+	        pushl %%ebx            \n\
+	        pushl %%esi            \n\
+	        pushl %%edi            \n\
+	        movl %%esp, (%3)       \n\
 	        movl %0, %%edx         \n\
 	        movw %%dx, %%ds        \n\
 	        pushl %0               \n\
@@ -85,84 +137,371 @@ void switch_displaying_term(int term_id) {
 	        pushl %1               \n\
 	        pushl %2               \n\
 	        iret                   \n\
+		1:                         \n\
 			"
 			:
-			: "r" (USER_DS), "r" (USER_CS), "r" (pcb->entry)
-			: "edx" // clobbers %EDX
+			: "a" (USER_DS), "b" (USER_CS), "c" (pcb->entry), "S" (&prev_pcb->return_esp)
+			: "edx", "edi", "memory" // clobbers %EDX
 		);
 	}
 }
 
-/* next_executing_term
- *
- * Description: moves to the next terminal for the scheduler
- * Inputs: None
- * Ouputs: None
- * Side Effects: Changes the currently executing terminal
- */
-void next_executing_term() {
-	while(1){
-		exec_term_id++;
-		if(exec_term_id > 2)
-			exec_term_id = 0;
-		if(processes[exec_term_id])
-			return;
-	}
-}
-
 /* terminal_write
- * Description: writes to current operating terminal
+ * Description: writes to current operating terminal, copying the program's
+ *              buffer a piece at a time
  * Inputs: fd: none
  		   buf: buffer to write to screen
- * Outputs: number of bytes read from buf
+ * Outputs: number of bytes read from buf, -1 if none could be read
  * Side Effects: prints to screen
  */
 int32_t terminal_write (int32_t fd, const void* buf, int32_t nbytes) {
-    int bytes_read;
+    uint8_t chunk[TERM_WRITE_CHUNK];
+    int bytes_read, n, i;
 
 	cli();
 	if(buf != NULL){
         bytes_read = 0;
-        //while ((((char*)buf)[bytes_read] != '\0') && bytes_read < nbytes) {
         while (bytes_read < nbytes) {
-        	if(curr_term_id == exec_term_id)
-            	putc(((char*)buf)[bytes_read]);								//print to display
-            else
-            	non_display_putc(((char*)buf)[bytes_read], exec_term_id);	//print to nondisplay buffer
-            bytes_read++;
+            n = nbytes - bytes_read;
+            if (n > TERM_WRITE_CHUNK)
+                n = TERM_WRITE_CHUNK;
+            if (copy_from_user(chunk, (const uint8_t*)buf + bytes_read, n) != 0)
+                break;
+            for (i = 0; i < n; i++)
+                ansi_putc(chunk[i], exec_term_id);
+            bytes_read += n;
         }
 		sti();
-		return bytes_read;
+		return (bytes_read || !nbytes) ? bytes_read : -1;
 	}
 	sti();
 	return 0;
 }
 
-/* terminal_read
- * Description: waits for enter. if enter has been pressed, pops first newline 
- *              terminated string from keyboard buffer and copies to buf.
- * Inputs: fd: none; buf: buffer to copy data to; nbytes: none
- * Outputs: Number of bytes copied to buf
+/* term_putc
+ * Description: prints a character to a terminal, on screen if it is
+ *              displayed or to its nondisplay buffer otherwise
+ * Inputs: c: character to print; term_id: terminal to print to
+ * Outputs: None
+ * Side Effects: prints to screen or nondisplay buffer
+ */
+static void term_putc(uint8_t c, int term_id) {
+	if(curr_term_id == term_id)
+		putc(c);								//print to display
+	else
+		non_display_putc(c, term_id);			//print to nondisplay buffer
+}
+
+/* term_video
+ * Description: returns the video memory a terminal currently draws into
+ * Inputs: term_id: terminal
+ * Outputs: VGA memory if displayed, the nondisplay buffer otherwise
  * Side Effects: None
  */
-int32_t terminal_read (int32_t fd, void* buf, int32_t nbytes) {
-	int i = 0;
-	char temp[BUFF_SIZE];
-	//while(exec_term_id != curr_term_id); blocks read until at current terminal
-	while(1){
-		cli();
-		if(exec_term_id == curr_term_id && num_enters > 0)
+static uint8_t* term_video(int term_id) {
+	if(curr_term_id == term_id)
+		return (uint8_t*)VIDEO;
+	return terms[term_id].vid_save;
+}
+
+/* term_get_pos / term_set_pos
+ * Description: reads or moves the cursor of a terminal whether or not it
+ *              is displayed. The new position is clamped to the screen.
+ * Inputs: term_id: terminal; x, y: new column and row
+ * Outputs: None
+ * Side Effects: moves the hardware cursor for the displayed terminal
+ */
+static void term_get_pos(int term_id, int* x, int* y) {
+	if(curr_term_id == term_id) {
+		*x = get_x();
+		*y = get_y();
+	} else {
+		*x = terms[term_id].x_save;
+		*y = terms[term_id].y_save;
+	}
+}
+
+static void term_set_pos(int term_id, int x, int y) {
+	if(x < 0) x = 0;
+	if(x >= NUM_COLS) x = NUM_COLS - 1;
+	if(y < 0) y = 0;
+	if(y >= NUM_ROWS) y = NUM_ROWS - 1;
+	if(curr_term_id == term_id) {
+		set_x(x);
+		set_y(y);
+	} else {
+		terms[term_id].x_save = x;
+		terms[term_id].y_save = y;
+	}
+}
+
+/* term_get_attrib / term_set_attrib
+ * Description: reads or sets the attribute used for new characters
+ * Inputs: term_id: terminal; attrib: VGA attribute byte
+ * Outputs: None
+ * Side Effects: None
+ */
+static uint8_t term_get_attrib(int term_id) {
+	if(curr_term_id == term_id)
+		return get_attrib();
+	return terms[term_id].attrib_save;
+}
+
+static void term_set_attrib(int term_id, uint8_t attrib) {
+	if(curr_term_id == term_id)
+		set_attrib(attrib);
+	else
+		terms[term_id].attrib_save = attrib;
+}
+
+/* term_erase
+ * Description: blanks the cells from start up to (not including) end
+ *              using the terminal's current attribute
+ * Inputs: term_id: terminal; start, end: cell indices (row * NUM_COLS + col)
+ * Outputs: None
+ * Side Effects: changes video memory or the nondisplay buffer
+ */
+static void term_erase(int term_id, int start, int end) {
+	uint8_t* video = term_video(term_id);
+	uint8_t attrib = term_get_attrib(term_id);
+	if(curr_term_id == term_id && start < end)
+		mark_vga_dirty(start / NUM_COLS, (end - 1) / NUM_COLS);
+	for(; start < end; start++) {
+		video[start << 1] = ' ';
+		video[(start << 1) + 1] = attrib;
+	}
+}
+
+/* ansi_param
+ * Description: returns a CSI parameter or a default if it was omitted
+ * Inputs: t: terminal; i: parameter index; def: default value
+ * Outputs: parameter value
+ * Side Effects: None
+ */
+static int ansi_param(term_t* t, int i, int def) {
+	if(i >= t->esc_nparams || t->esc_params[i] == 0)
+		return def;
+	return t->esc_params[i];
+}
+
+/* ansi_sgr
+ * Description: applies a "select graphic rendition" (ESC[...m) sequence
+ *              to the terminal's attribute byte
+ * Inputs: term_id: terminal
+ * Outputs: None
+ * Side Effects: changes the terminal's attribute
+ */
+static void ansi_sgr(int term_id) {
+	term_t* t = &terms[term_id];
+	uint8_t attrib = term_get_attrib(term_id);
+	int i, p;
+
+	// ESC[m is the same as ESC[0m
+	if(t->esc_nparams == 0)
+		t->esc_params[t->esc_nparams++] = 0;
+
+	for(i = 0; i < t->esc_nparams; i++) {
+		p = t->esc_params[i];
+		if(p == 0)
+			attrib = ATTRIB;
+		else if(p == 1)
+			attrib |= BRIGHT;
+		else if(p == 22)
+			attrib &= ~BRIGHT;
+		else if(p == 7)
+			// brightness moves with the color it belongs to
+			attrib = ((attrib & FG_MASK) << 4) | ((attrib & BG_MASK) >> 4);
+		else if(p >= 30 && p <= 37)
+			attrib = (attrib & (BG_MASK | BRIGHT)) | ansi_to_vga[p - 30];
+		else if(p == 39)
+			attrib = (attrib & (BG_MASK | BRIGHT)) | (ATTRIB & 0x07);
+		else if(p >= 40 && p <= 47)
+			attrib = (attrib & FG_MASK) | (ansi_to_vga[p - 40] << 4);
+		else if(p == 49)
+			attrib = (attrib & FG_MASK) | (ATTRIB & BG_MASK);
+		else if(p >= 90 && p <= 97)
+			attrib = (attrib & BG_MASK) | BRIGHT | ansi_to_vga[p - 90];
+	}
+	term_set_attrib(term_id, attrib);
+}
+
+/* ansi_csi
+ * Description: executes a complete control sequence (ESC[ params final).
+ *              Supports cursor movement (A B C D H f), erase in display (J),
+ *              erase in line (K) and colors (m). Anything else is ignored.
+ * Inputs: final: the final byte of the sequence; term_id: terminal
+ * Outputs: None
+ * Side Effects: moves the cursor, erases cells or changes the attribute
+ */
+static void ansi_csi(uint8_t final, int term_id) {
+	term_t* t = &terms[term_id];
+	int x, y, cur;
+
+	term_get_pos(term_id, &x, &y);
+	cur = y * NUM_COLS + x;
+	switch(final) {
+		case 'A':
+			term_set_pos(term_id, x, y - ansi_param(t, 0, 1));
+			break;
+		case 'B':
+			term_set_pos(term_id, x, y + ansi_param(t, 0, 1));
+			break;
+		case 'C':
+			term_set_pos(term_id, x + ansi_param(t, 0, 1), y);
+			break;
+		case 'D':
+			term_set_pos(term_id, x - ansi_param(t, 0, 1), y);
+			break;
+		case 'H':
+		case 'f':
+			// parameters are 1-based row;column
+			term_set_pos(term_id, ansi_param(t, 1, 1) - 1, ansi_param(t, 0, 1) - 1);
+			break;
+		case 'J':
+			if(ansi_param(t, 0, 0) == 0)
+				term_erase(term_id, cur, NUM_ROWS * NUM_COLS);
+			else if(ansi_param(t, 0, 0) == 1)
+				term_erase(term_id, 0, cur + 1);
+			else
+				term_erase(term_id, 0, NUM_ROWS * NUM_COLS);
+			break;
+		case 'K':
+			if(ansi_param(t, 0, 0) == 0)
+				term_erase(term_id, cur, (y + 1) * NUM_COLS);
+			else if(ansi_param(t, 0, 0) == 1)
+				term_erase(term_id, y * NUM_COLS, cur + 1);
+			else
+				term_erase(term_id, y * NUM_COLS, (y + 1) * NUM_COLS);
+			break;
+		case 'm':
+			ansi_sgr(term_id);
+			break;
+		default:
 			break;
-		sti();
 	}
-	num_enters--;
-	while((key_buff[i] != '\n') && (i < nbytes)){
-		temp[i] = key_buff[i];
-		i++;
+}
+
+/* ansi_putc
+ * Description: feeds one output character through the terminal's VT100
+ *              escape parser. Plain characters are printed, escape
+ *              sequences are executed against the terminal's screen. The
+ *              raw sequence is also passed on to a serial console so a host
+ *              terminal renders the same thing.
+ * Inputs: c: character written by the program; term_id: terminal
+ * Outputs: None
+ * Side Effects: prints to screen or nondisplay buffer
+ */
+void ansi_putc(uint8_t c, int term_id) {
+	term_t* t = &terms[term_id];
+
+	if(t->esc_state == ANSI_NORMAL && c != ASCII_ESC) {
+		term_putc(c, term_id);
+		return;
+	}
+
+	if(serial_console_mode != SERIAL_CONSOLE_OFF)
+		serial_putc(c);
+
+	switch(t->esc_state) {
+		case ANSI_NORMAL:
+			t->esc_state = ANSI_ESCAPE;
+			break;
+		case ANSI_ESCAPE:
+			if(c == '[') {
+				t->esc_state = ANSI_CSI;
+				t->esc_nparams = 0;
+				t->esc_params[0] = 0;
+			} else {
+				t->esc_state = ANSI_NORMAL;
+			}
+			break;
+		case ANSI_CSI:
+			if(c >= '0' && c <= '9') {
+				if(t->esc_nparams == 0)
+					t->esc_nparams = 1;
+				// a long run of digits saturates instead of overflowing
+				if(t->esc_nparams <= ANSI_MAX_PARAMS && t->esc_params[t->esc_nparams - 1] <= ANSI_MAX_PARAM)
+					t->esc_params[t->esc_nparams - 1] = t->esc_params[t->esc_nparams - 1] * 10 + (c - '0');
+			} else if(c == ';') {
+				if(t->esc_nparams == 0)
+					t->esc_nparams = 1;
+				if(t->esc_nparams <= ANSI_MAX_PARAMS)
+					t->esc_nparams++;
+				if(t->esc_nparams <= ANSI_MAX_PARAMS)
+					t->esc_params[t->esc_nparams - 1] = 0;
+			} else if(c >= '@' && c <= '~') {
+				// final byte: run the sequence
+				if(t->esc_nparams > ANSI_MAX_PARAMS)
+					t->esc_nparams = ANSI_MAX_PARAMS;
+				t->esc_state = ANSI_NORMAL;
+				if(serial_console_mode != SERIAL_CONSOLE_ONLY)
+					ansi_csi(c, term_id);
+			}
+			// intermediate bytes such as '?' are ignored
+			break;
+		default:
+			t->esc_state = ANSI_NORMAL;
+			break;
+	}
+}
+
+/* terminal_read
+ * Description: sleeps until the line discipline has input for this terminal
+ *              while it is displayed, then copies it to buf: the first line
+ *              in cooked mode, every waiting keystroke in raw mode.
+ * Inputs: fd: checked for O_NONBLOCK; buf: buffer to copy data to;
+ *         nbytes: size of buf
+ * Outputs: Number of bytes copied to buf, ERR_AGAIN if nothing is ready
+ *          and fd is non-blocking
+ * Side Effects: May put the process to sleep
+ */
+int32_t terminal_read (int32_t fd, void* buf, int32_t nbytes) {
+	int32_t ret;
+	//blocks read until at current terminal with input
+	cli();
+	while(!ldisc_ready()){
+		if(fd_is_nonblocking(fd)){
+			sti();
+			return ERR_AGAIN;
+		}
+		sleep_on(&terms[exec_term_id].input_wq);
+	}
+	ret = ldisc_read((uint8_t*)buf, nbytes);
+	sti();
+	return ret;
+}
+
+/* terminal_poll
+ * Description: reports whether terminal_read would return without sleeping
+ *              and registers the caller to be woken when input arrives
+ * Inputs: fd: none
+ * Outputs: POLLIN if input is ready, always POLLOUT
+ * Side Effects: adds the current process to the terminal's wait queue
+ */
+int32_t terminal_poll (int32_t fd) {
+	if(ldisc_ready())
+		return POLLIN | POLLOUT;
+	poll_wait(&terms[exec_term_id].input_wq);
+	return POLLOUT;
+}
+
+/* terminal_ioctl
+ * Description: gets or sets the line discipline mode of the executing
+ *              terminal
+ * Inputs: fd: none; cmd: TERM_GET_MODE or TERM_SET_MODE;
+ *         arg: LDISC_COOKED or LDISC_RAW for TERM_SET_MODE
+ * Outputs: the mode for TERM_GET_MODE, 0 for TERM_SET_MODE, -1 on failure
+ * Side Effects: None
+ */
+int32_t terminal_ioctl (int32_t fd, int32_t cmd, int32_t arg) {
+	switch(cmd){
+		case TERM_GET_MODE:
+			return ldisc_get_mode(exec_term_id);
+		case TERM_SET_MODE:
+			return ldisc_set_mode(exec_term_id, arg);
+		default:
+			return -1;
 	}
-	shift_buffer(i, (uint8_t*)key_buff); //dequeue (discard read string)
-	memcpy(buf, (void*)temp, i);
-	return i;
 }
 
 /* terminal_open
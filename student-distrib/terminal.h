@@ -5,18 +5,28 @@
 #include "lib.h"
 #include "keyboard.h"
 #include "syscall.h"
+#include "wait.h"
 
 /* terminal struct values */
 #define KEY_BUFF_SIZE 128
+#define TERM_WRITE_CHUNK 64 // bytes terminal_write copies from a program at a time
 #define NUM_TERMINALS 3
 #define NUM_COLS 80
 #define NUM_ROWS 25
 #define VID_SIZE NUM_ROWS * NUM_COLS * 2
+#define ROW_SIZE (NUM_COLS * 2)
 /* update term cases */
 #define IS_CLEAR 0
 #define IS_ENTER 1
 #define IS_BACKSPACE 2
 #define IS_CHAR 3
+/* ANSI escape parser states and limits */
+#define ANSI_NORMAL 0
+#define ANSI_ESCAPE 1
+#define ANSI_CSI 2
+#define ANSI_MAX_PARAMS 4
+#define ANSI_MAX_PARAM (NUM_COLS * NUM_ROWS) // larger parameters stop growing, no count or position is this big
+#define ASCII_ESC 0x1B
 
 /* struct for terminals: contains all data needed for switch */
 typedef struct term_t{
@@ -26,6 +36,12 @@ typedef struct term_t{
 	uint8_t vid_save[VID_SIZE]__attribute__((aligned (4096)));
 	int enters_save;
 	int buff_index_save;
+	uint8_t attrib_save;
+	int esc_state;
+	int esc_params[ANSI_MAX_PARAMS];
+	int esc_nparams;
+	wait_queue_t input_wq;		// readers waiting for a line on this terminal
+	int ldisc_mode;				// LDISC_COOKED or LDISC_RAW
 }term_t;
 
 //array of terminals
@@ -38,10 +54,10 @@ volatile int exec_term_id;
 extern void init_terminal();
 //switch operating terminal
 extern void switch_displaying_term(int term_id);
-//switch terminal executing code
-extern void next_executing_term();
 
 
+//prints a character, interpreting ANSI escape sequences
+void ansi_putc(uint8_t c, int term_id);
 //writes to terminal
 int32_t terminal_write (int32_t fd, const void* buf, int32_t nbytes);
 //reads from keyboard
@@ -50,6 +66,10 @@ int32_t terminal_read (int32_t fd, void* buf, int32_t nbytes);
 int32_t terminal_open (const uint8_t * filename);
 //closes terminal
 int32_t terminal_close (int32_t fd);
+//reports whether a line is ready to be read
+int32_t terminal_poll (int32_t fd);
+//gets or sets the line discipline mode
+int32_t terminal_ioctl (int32_t fd, int32_t cmd, int32_t arg);
 
 /* struct for each instance of terminal */
 
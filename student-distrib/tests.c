@@ -9,6 +9,16 @@
 #include "types.h"
 #include "syscall.h"
 #include "tasks.h"
+#include "wait.h"
+#include "ldisc.h"
+#include "pipe.h"
+#include "shm.h"
+#include "idt.h"
+#include "scheduler.h"
+#include "uaccess.h"
+#include "ata.h"
+#include "bcache.h"
+#include "lz4.h"
 
 #define PASS 1
 #define FAIL 0
@@ -27,6 +37,43 @@ static inline void assertion_failure(){
 	asm volatile("int $15");
 }
 
+/* System calls and drivers only take buffers and paths in user memory, so
+ * tests hand them a shared memory page attached at TEST_PAGE. Paths go in
+ * its last TEST_STRING_LEN bytes. */
+#define TEST_PAGE ((uint8_t*)SHM_WINDOW_START)
+#define TEST_STRING_LEN 64
+
+/* test_page
+ * Attaches a page for a test's buffers at TEST_PAGE
+ * Inputs: key -- shm key, one per test
+ * Outputs: TEST_PAGE, NULL if it could not be attached */
+static uint8_t* test_page(int32_t key){
+	int32_t id = shm_create(key, SHM_PAGE_SIZE);
+
+	if (id < 0 || shm_attach(id, TEST_PAGE) != (int32_t)TEST_PAGE)
+		return NULL;
+	return TEST_PAGE;
+}
+
+/* test_page_release
+ * Detaches the page, and any other segment of the current process */
+static void test_page_release(){
+	shm_release(get_current_executing_pcb()->process_id);
+	reload_cr3();
+}
+
+/* test_string
+ * Copies a path to the end of the test page. System calls copy their path
+ * in, so each call may overwrite the last one's
+ * Inputs: str -- the path, shorter than TEST_STRING_LEN
+ * Outputs: the copy */
+static uint8_t* test_string(const int8_t* str){
+	uint8_t* copy = TEST_PAGE + SHM_PAGE_SIZE - TEST_STRING_LEN;
+
+	strncpy((int8_t*)copy, str, TEST_STRING_LEN);
+	return copy;
+}
+
 
 /* Checkpoint 1 tests */
 
@@ -92,20 +139,23 @@ static int provided_fs_test() {
 		assertion_failure();
 		result = FAIL;
 	}
-	// checks that the 4th inode has a length of 0x1445
-	if (inodes[3].length != 0x1445) {
-		assertion_failure();
-		result = FAIL;
-	}
-	// checks that the first data block is empty
-	if (data_blocks[0].data[0] != 0) {
-		assertion_failure();
-		result = FAIL;
-	}
-	// checks that the 3rd data block begins with 0x7f
-	if (data_blocks[2].data[0] != 0x7f) {
-		assertion_failure();
-		result = FAIL;
+	// the inodes and data blocks are only in memory when the module is mounted
+	if (inodes != NULL) {
+		// checks that the 4th inode has a length of 0x1445
+		if (inodes[3].length != 0x1445) {
+			assertion_failure();
+			result = FAIL;
+		}
+		// checks that the first data block is empty
+		if (data_blocks[0].data[0] != 0) {
+			assertion_failure();
+			result = FAIL;
+		}
+		// checks that the 3rd data block begins with 0x7f
+		if (data_blocks[2].data[0] != 0x7f) {
+			assertion_failure();
+			result = FAIL;
+		}
 	}
 	// create a directory entry and populate it with the ls executable, then
 	// check that its inode index is 5
@@ -239,11 +289,16 @@ static void rtc_test() {
     uint32_t ret_value;
     uint32_t fd = NULL;
     int freq = 2;       //default frequency
+    int32_t* user_freq = (int32_t*)test_page(6);
     int32_t nbytes = 4;
     void* read_buf = NULL;
     int rate;
     int curr;
 
+    /* rtc_write reads the frequency from user memory. */
+    if (user_freq == NULL)
+        return;
+
     /* "Open" the RTC file. */
     rtc_open(filename);
 
@@ -251,7 +306,8 @@ static void rtc_test() {
     for(rate = 0; rate < 10; rate++) {
 
         /* Given the frequency, set the rate. */
-        ret_value = rtc_write(fd, &freq, nbytes);
+        *user_freq = freq;
+        ret_value = rtc_write(fd, user_freq, nbytes);
 
         /* Loop through to the given value of the frequency. */
         for(curr = 0; curr < freq; curr++) {
@@ -274,6 +330,7 @@ static void rtc_test() {
             printf("1");
         }
     }
+    test_page_release();
 }
 
 
@@ -292,8 +349,10 @@ static void rtc_test() {
  *   COVERAGE:      terminal
  */
 static void terminal_read_test(){
-    char buf[BUFF_SIZE];
+    char* buf = (char*)test_page(7);
 
+    if (buf == NULL)
+        return;
     while(1){
         if(terminal_read(0, (void*)buf, 0) > 0){      
             printf("TERMINAL HAS READ: %s \n", buf);
@@ -342,7 +401,7 @@ static int fs_test_ls() {
 			strncpy(file_string, dentry.file_name, 32);
 			file_string[32] = '\0';
 			// print off the info for this dentry
-			printf("file name: %s, file type: %d, file size: %d\n", file_string, dentry.file_type, inodes[dentry.inode_index].length);
+			printf("file name: %s, file type: %d, file size: %d\n", file_string, dentry.file_type, inode_length(dentry.inode_index));
 		}
 	}
 	return result;
@@ -370,7 +429,7 @@ static int fs_print_by_name(const uint8_t * fname) {
 		assertion_failure();
 	}
     index = dentry.inode_index;
-    length = inodes[index].length;
+    length = inode_length(index);
     buf[length] = '\0';
 
     if (read_data(index, 0, buf, length) != 0) {
@@ -403,7 +462,7 @@ static int fs_print_by_index(uint32_t index){
 		assertion_failure();
 	}
     inode_idx = dentry.inode_index;
-    length = inodes[inode_idx].length;
+    length = inode_length(inode_idx);
     buf[length] = '\0'; // ensure null terminated buffer
 
 	// Now try to read the data
@@ -436,13 +495,18 @@ static int syscall_test() {
     int fd, fd2; // file descriptor index
     int rtc_fd;
     int i; // iter
-    char buf[128]; // buffer for reads and writes
+    char* buf = (char*)test_page(10); // buffer for reads and writes
     pcb_t* pcb; // PCB struct to fill in for tests
 
     int result = PASS; // PASS/FAIL
 
+    if (buf == NULL) {
+        assertion_failure();
+        return FAIL;
+    }
+
     // Check to make sure all functions won't work if no user tasks are running
-    if (open((uint8_t*)"frame0.txt") != -1 ||
+    if (open(test_string("frame0.txt")) != -1 ||
         read(0, buf, 10) != -1 ||
         write(0, buf, 10) != -1 ||
         close(2) != -1) {
@@ -482,8 +546,8 @@ static int syscall_test() {
 	pcb->child_pcb = NULL;
 
     // Bad file names should return -1
-    if (open((uint8_t*)"bad_filename.error") != -1 ||
-        open((uint8_t*)"") != -1 ||
+    if (open(test_string("bad_filename.error")) != -1 ||
+        open(test_string("")) != -1 ||
         open((uint8_t*)NULL) != -1) {
             result = FAIL;
             assertion_failure();
@@ -498,20 +562,20 @@ static int syscall_test() {
     }
 
     // Opening a file should have a return val 2-7
-    fd = open((uint8_t*)"frame0.txt");
+    fd = open(test_string("frame0.txt"));
     if (fd < 2 || fd >= FD_ARRAY_LEN) {
 		result = FAIL;
 		assertion_failure();
     }
     // Populate the rest of the fds and check that you can't open any more
     for (i = 3; i < FD_ARRAY_LEN; i++) {
-        fd2 = open((uint8_t*)".");
+        fd2 = open(test_string("."));
         if (fd2 < 2 || fd >= FD_ARRAY_LEN) {
             result = FAIL;
             assertion_failure();
         }
     }
-    if (open((uint8_t*)".") != -1) {
+    if (open(test_string(".")) != -1) {
 		result = FAIL;
 		assertion_failure();
     }
@@ -539,8 +603,14 @@ static int syscall_test() {
             result = FAIL;
             assertion_failure();
     }
-    // Make sure write doesn't do anything in a read-only fs
-    if (write(fd, buf, 10) != -1) {
+    // Kernel memory is not the program's to read into or write out
+    if (read(fd, (void*)pcb, 4) != -1 ||
+        write(1, (void*)pcb, 4) != -1) {
+            result = FAIL;
+            assertion_failure();
+    }
+    // Directories are not written, files are created instead
+    if (write(fd2, buf, 10) != -1) {
 		result = FAIL;
 		assertion_failure();
     }
@@ -563,7 +633,7 @@ static int syscall_test() {
         }
     }
 
-    rtc_fd = open((uint8_t*)"rtc");
+    rtc_fd = open(test_string("rtc"));
     //test bad rtc read write
     if (read(rtc_fd, NULL, 0) != -1 ||
         write(rtc_fd, NULL, 0) != -1) {
@@ -611,6 +681,7 @@ static int syscall_test() {
 
     // Reset active_tasks to 0
     active_tasks = 0;
+    test_page_release();
 
     return result;
 }
@@ -621,6 +692,1045 @@ void exception_test(){
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
+/* ansi_test
+ *
+ * Writes escape sequences through terminal_write and checks that the
+ * cursor moved and the colored character landed in video memory
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Clears the screen
+ *   COVERAGE:      terminal ANSI parser
+ */
+static int ansi_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    uint8_t* video = (uint8_t*)0xB8000;
+    // clear, move to row 3 column 5, print a red X, reset colors
+    char seq[] = "\033[2J\033[3;5H\033[31mX\033[0m";
+    char huge[] = "\033[99999999999999999999;3H";
+    char bold_reverse[] = "\033[1;31;7m";
+    uint8_t* buf = test_page(11);
+
+    if (buf == NULL) {
+        assertion_failure();
+        return FAIL;
+    }
+    memcpy(buf, seq, sizeof(seq) - 1);
+    terminal_write(1, buf, sizeof(seq) - 1);
+    // row 2 column 4 zero-based, 80 columns, 2 bytes per cell
+    if ((video[(2 * 80 + 4) * 2] != 'X') || (video[(2 * 80 + 4) * 2 + 1] != 0x04)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    if ((get_x() != 5) || (get_y() != 2) || (get_attrib() != 0x07)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // a row too long for an int saturates to the bottom row
+    memcpy(buf, huge, sizeof(huge) - 1);
+    terminal_write(1, buf, sizeof(huge) - 1);
+    if ((get_x() != 2) || (get_y() != NUM_ROWS - 1)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // reverse video keeps bright red bright, on the background now
+    memcpy(buf, bold_reverse, sizeof(bold_reverse) - 1);
+    terminal_write(1, buf, sizeof(bold_reverse) - 1);
+    if (get_attrib() != 0xC0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    memcpy(buf, "\033[0m", 4);
+    terminal_write(1, buf, 4);
+    test_page_release();
+    return result;
+}
+
+/* nonblock_test
+ *
+ * Checks wait queue bookkeeping and that O_NONBLOCK set through fcntl
+ * makes an RTC read return ERR_AGAIN instead of sleeping
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Opens and closes the RTC
+ *   COVERAGE:      wait queues, fcntl, rtc_read
+ */
+static int nonblock_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    wait_queue_t wq;
+    int32_t rtc_fd;
+    int32_t* buf = (int32_t*)test_page(12);
+    pcb_t* pcb = get_current_executing_pcb();
+
+    if (buf == NULL) {
+        assertion_failure();
+        return FAIL;
+    }
+
+    // registering and waking must leave the queue empty and us runnable
+    init_wait_queue(&wq);
+    poll_wait(&wq);
+    if (wq.waiters != (1 << pcb->process_id)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    wake_up(&wq);
+    if (wq.waiters != 0 || pcb->state != TASK_RUNNING) {
+        assertion_failure();
+        result = FAIL;
+    }
+
+    rtc_fd = open(test_string("rtc"));
+    if (fcntl(rtc_fd, F_GETFL, 0) != 0 ||
+        fcntl(rtc_fd, F_SETFL, O_NONBLOCK) != 0 ||
+        fcntl(rtc_fd, F_GETFL, 0) != O_NONBLOCK) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // consume any pending tick, the next read has nothing to return
+    read(rtc_fd, buf, 4);
+    if (read(rtc_fd, buf, 4) != ERR_AGAIN) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // bad commands and descriptors
+    if (fcntl(rtc_fd, 0, 0) != -1 || fcntl(FD_ARRAY_LEN, F_GETFL, 0) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    close(rtc_fd);
+    if (fcntl(rtc_fd, F_GETFL, 0) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    test_page_release();
+    return result;
+}
+
+/* ldisc_test
+ *
+ * Feeds characters to the line discipline of the displayed terminal and
+ * reads them back in cooked mode, with erase and kill, and in raw mode,
+ * and checks that a negative size consumes nothing
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Echoes the cooked input to the screen
+ *   COVERAGE:      line discipline, terminal_read
+ */
+static int ldisc_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    uint8_t* buf = test_page(13);
+    const uint8_t cooked[] = {'h', 'i', 'q', LDISC_ERASE, '\n'};
+    const uint8_t killed[] = {'n', 'o', LDISC_KILL, 'o', 'k', '\n'};
+    int i;
+
+    if (buf == NULL) {
+        assertion_failure();
+        return FAIL;
+    }
+
+    for (i = 0; i < sizeof(cooked); i++)
+        ldisc_receive(cooked[i]);
+    if (terminal_read(0, buf, KEY_BUFF_SIZE) != 2 || strncmp((int8_t*)buf, "hi", 2)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    for (i = 0; i < sizeof(killed); i++)
+        ldisc_receive(killed[i]);
+    if (terminal_read(0, buf, KEY_BUFF_SIZE) != 2 || strncmp((int8_t*)buf, "ok", 2)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // a negative size is refused and leaves the line to be read
+    for (i = 0; i < sizeof(killed); i++)
+        ldisc_receive(killed[i]);
+    if (terminal_read(0, buf, -1) != -1
+        || terminal_read(0, buf, KEY_BUFF_SIZE) != 2 || strncmp((int8_t*)buf, "ok", 2)) {
+        assertion_failure();
+        result = FAIL;
+    }
+
+    // raw mode hands over keystrokes without waiting for enter
+    if (ldisc_set_mode(curr_term_id, LDISC_RAW) != 0 || ldisc_get_mode(curr_term_id) != LDISC_RAW) {
+        assertion_failure();
+        result = FAIL;
+    }
+    ldisc_receive('x');
+    ldisc_receive(LDISC_ERASE);
+    if (terminal_read(0, buf, -1) != -1 || terminal_read(0, buf, KEY_BUFF_SIZE) != 2 || buf[0] != 'x' || buf[1] != LDISC_ERASE) {
+        assertion_failure();
+        result = FAIL;
+    }
+    ldisc_set_mode(curr_term_id, LDISC_COOKED);
+    if (ldisc_set_mode(curr_term_id, 7) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    test_page_release();
+    return result;
+}
+
+/* vga_dirty_test
+ *
+ * Checks that kernel writes to video memory mark exactly the rows they
+ * touched, which is what a terminal switch copies
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Prints a character and clears the screen
+ *   COVERAGE:      dirty row tracking in lib.c
+ */
+static int vga_dirty_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    int row;
+
+    clear();
+    if (take_vga_dirty_rows() != VGA_ALL_ROWS || take_vga_dirty_rows() != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    set_x(0);
+    set_y(3);
+    putc('d');
+    row = get_y();
+    if (take_vga_dirty_rows() != (1 << row)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    clear();
+    return result;
+}
+
+/* sysenter_test
+ *
+ * Reads the SYSENTER MSRs back and checks they point at the kernel code
+ * segment, tss.esp0 and the fast entry stub
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  none
+ *   COVERAGE:      init_sysenter
+ */
+static int sysenter_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    uint32_t msr, lo, hi;
+
+    if (!sysenter_enabled) {
+        printf("SYSENTER not supported, skipping\n");
+        return result;
+    }
+    for (msr = 0x174; msr <= 0x176; msr++) {
+        asm volatile("rdmsr" : "=a" (lo), "=d" (hi) : "c" (msr));
+        if ((msr == 0x174 && lo != KERNEL_CS) ||
+            (msr == 0x175 && lo != (uint32_t)&tss.esp0) ||
+            (msr == 0x176 && lo != (uint32_t)sysenter_wrapper)) {
+            assertion_failure();
+            result = FAIL;
+        }
+    }
+    return result;
+}
+
+/* submit_test
+ *
+ * Queues an open, a read into kernel memory, a read and a close on a ring
+ * in a user page and checks their completions and the indices submit
+ * moved, then that submit stops while the completion queue is full
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Opens and closes frame0.txt
+ *   COVERAGE:      submit
+ */
+static int submit_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    ring_t* ring = (ring_t*)test_page(15);
+    uint8_t* buf = (uint8_t*)(ring + 1);
+    pcb_t* pcb = get_current_executing_pcb();
+    int32_t fd = 2;
+    int i;
+
+    if (ring == NULL) {
+        assertion_failure();
+        return FAIL;
+    }
+    // open takes the lowest free descriptor
+    while (fd < FD_ARRAY_LEN - 1 && pcb->fd_array[fd].active)
+        fd++;
+    ring->sq[0].opcode = RING_OP_OPEN;
+    ring->sq[0].buf = test_string("frame0.txt");
+    ring->sq[1].opcode = RING_OP_READ;
+    ring->sq[1].fd = fd;
+    ring->sq[1].buf = pcb;
+    ring->sq[1].nbytes = 4;
+    ring->sq[2] = ring->sq[1];
+    ring->sq[2].buf = buf;
+    ring->sq[3].opcode = RING_OP_CLOSE;
+    ring->sq[3].fd = fd;
+    for (i = 0; i < 4; i++)
+        ring->sq[i].user_data = i + 1;
+    ring->sq_tail = 4;
+    if (submit(ring) != 4 || ring->sq_head != 4 || ring->cq_tail != 4 ||
+        ring->cq[0].result != fd || ring->cq[1].result != -1 ||
+        ring->cq[2].result != 4 || ring->cq[3].result != 0 ||
+        memcmp(buf, "/\\/\\", 4) != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    for (i = 0; i < 4; i++) {
+        if (ring->cq[i].user_data != i + 1) {
+            assertion_failure();
+            result = FAIL;
+        }
+    }
+
+    // one free completion slot runs one of two closes, none runs the other
+    ring->cq_tail = RING_ENTRIES - 1;
+    ring->sq[4].opcode = RING_OP_CLOSE;
+    ring->sq[4].fd = -1;
+    ring->sq[5] = ring->sq[4];
+    ring->sq_tail = 6;
+    if (submit(ring) != 1 || ring->sq_head != 5 || ring->cq_tail != RING_ENTRIES ||
+        ring->cq[RING_MASK].result != -1 || submit(ring) != 0 || ring->sq_head != 5) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // reading the completions makes room for the rest
+    ring->cq_head = RING_ENTRIES;
+    if (submit(ring) != 1 || ring->sq_head != 6 || ring->cq_tail != RING_ENTRIES + 1 ||
+        submit(ring) != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    test_page_release();
+    return result;
+}
+
+/* pipe_test
+ *
+ * Sends data through a pipe, then checks the non-blocking empty read,
+ * dup2 of the write end and end of file once every writer is closed
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Uses fds 5 to 7 of the current pcb
+ *   COVERAGE:      pipe.c, dup2
+ */
+static int pipe_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    uint8_t* buf = test_page(14);
+    pcb_t* pcb = get_current_executing_pcb();
+    uint8_t was_active = processes[pcb->process_id];
+
+    if (buf == NULL) {
+        assertion_failure();
+        return FAIL;
+    }
+
+    // pipe ends only count while their process exists
+    processes[pcb->process_id] = 1;
+    if (pipe_create(&pcb->fd_array[6], &pcb->fd_array[7]) != 0 ||
+        write(7, test_string("hello"), 5) != 5 || read(6, buf, 8) != 5 ||
+        memcmp(buf, "hello", 5) != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    fcntl(6, F_SETFL, O_NONBLOCK);
+    if (read(6, buf, 8) != ERR_AGAIN) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // the copy keeps the pipe open after the original is closed
+    if (dup2(7, 5) != 5 || close(7) != 0 || write(5, test_string("x"), 1) != 1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    close(5);
+    if (read(6, buf, 8) != 1 || read(6, buf, 8) != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    close(6);
+    processes[pcb->process_id] = was_active;
+    test_page_release();
+    return result;
+}
+
+/* shm_test
+ *
+ * Creates a segment, looks it up again by key, attaches it twice and
+ * checks both mappings see the same memory
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Releases the current process's segments
+ *   COVERAGE:      shm.c
+ */
+static int shm_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    int pid = get_current_executing_pcb()->process_id;
+    uint8_t* first = (uint8_t*)SHM_WINDOW_START;
+    uint8_t* second = (uint8_t*)(SHM_WINDOW_START + 2 * SHM_PAGE_SIZE);
+    int32_t id = shm_create(1, SHM_PAGE_SIZE);
+
+    if (id < 0 || shm_create(1, 1) != id || shm_create(1, 2 * SHM_PAGE_SIZE) != -1 ||
+        shm_create(2, (SHM_MAX_PAGES + 1) * SHM_PAGE_SIZE) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    if (shm_attach(id, first) != (int32_t)first || shm_attach(id, first) != -1 ||
+        shm_attach(id, second) != (int32_t)second || shm_attach(id, first + 1) != -1) {
+        assertion_failure();
+        result = FAIL;
+    } else {
+        // a fresh segment reads as zeroes, writes show through both mappings
+        if (first[0] != 0)
+            result = FAIL;
+        first[0] = 'x';
+        if (second[0] != 'x') {
+            assertion_failure();
+            result = FAIL;
+        }
+    }
+    shm_release(pid);
+    reload_cr3();
+    return result;
+}
+
+
+/* signal_test
+ *
+ * Checks the sigframe layout user handlers rely on, that ignored signals
+ * are dropped, that set_handler validates its arguments and that nothing
+ * is delivered on a return to kernel code
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Resets the current process's signal state
+ *   COVERAGE:      signal.c, set_handler
+ */
+static int signal_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    pcb_t* pcb = get_current_executing_pcb();
+    hw_context_t context;
+    sigframe_t frame;
+
+    // handlers find the saved eax seven words above their argument
+    if ((uint32_t*)&frame.context.eax != (uint32_t*)&frame.signum + 7 ||
+        sizeof(hw_context_t) != 14 * sizeof(uint32_t)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    init_signals(pcb);
+    send_signal(pcb, SIG_ALARM);
+    send_signal(pcb, SIG_INTERRUPT);
+    if (pcb->sig_pending != (1 << SIG_INTERRUPT)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    if (set_handler(NUM_SIGNALS, (void*)0x8048000) != -1 ||
+        set_handler(SIG_ALARM, (void*)0x1000) != -1 ||
+        set_handler(SIG_ALARM, (void*)0x8048000) != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // a handler installed, ALARM is no longer dropped, but kernel code is not interrupted
+    send_signal(pcb, SIG_ALARM);
+    context.cs = KERNEL_CS;
+    context.eip = 0;
+    deliver_signals(&context);
+    if (!(pcb->sig_pending & (1 << SIG_ALARM)) || context.eip != 0 || pcb->sig_masked) {
+        assertion_failure();
+        result = FAIL;
+    }
+    init_signals(pcb);
+    return result;
+}
+
+static int timer_test_fired;
+
+/* counts the runs of the timer_test timer */
+static void timer_test_fn(uint32_t data) {
+    timer_test_fired++;
+}
+
+/* timer_test
+ *
+ * Drives the timer wheel by hand, the PIT is not running yet: a timer runs
+ * on its tick and not before, one a full turn away is skipped when its
+ * slot comes around early, and a deleted timer never runs
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Empties the timer wheel
+ *   COVERAGE:      timer.c
+ */
+static int timer_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    uint32_t base = pit_ticks;
+    ktimer_t timer;
+    timespec_t ts;
+
+    init_timers();
+    timer_test_fired = 0;
+    init_timer(&timer, timer_test_fn, 0);
+    add_timer(&timer, base + 2);
+    pit_ticks = base + 1;
+    run_timers();
+    if (timer_test_fired != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    pit_ticks = base + 2;
+    run_timers();
+    if (timer_test_fired != 1 || timer.pending) {
+        assertion_failure();
+        result = FAIL;
+    }
+    add_timer(&timer, base + 3 + TIMER_WHEEL_SLOTS);
+    pit_ticks = base + 3;
+    run_timers();
+    del_timer(&timer);
+    pit_ticks = base + 3 + TIMER_WHEEL_SLOTS;
+    run_timers();
+    if (timer_test_fired != 1 || timer.pending) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // rounding is up, so a timer never runs early
+    ts.tv_sec = 1;
+    ts.tv_nsec = 1;
+    if (timespec_to_ticks(&ts) != 101) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // a time too long for 31 bits of ticks is cut short, not wrapped
+    ts.tv_sec = 0x7FFFFFFF;
+    ts.tv_nsec = NSEC_PER_SEC - 1;
+    if (timespec_to_ticks(&ts) != TIMER_MAX_TICKS) {
+        assertion_failure();
+        result = FAIL;
+    }
+    ts.tv_sec = TIMER_MAX_TICKS / 100;
+    ts.tv_nsec = 0;
+    if (timespec_to_ticks(&ts) != TIMER_MAX_TICKS / 100 * 100) {
+        assertion_failure();
+        result = FAIL;
+    }
+    pit_ticks = base;
+    return result;
+}
+
+/* uaccess_test
+ *
+ * Copies through an attached shared memory page, then checks that kernel
+ * addresses are refused and that copies running into an unmapped page
+ * fail through the exception table instead of faulting
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Releases the current process's segments
+ *   COVERAGE:      uaccess.c, copy_user.S, fixup_exception
+ */
+static int uaccess_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    int pid = get_current_executing_pcb()->process_id;
+    uint8_t* page = (uint8_t*)SHM_WINDOW_START;
+    int8_t buf[8];
+    int32_t id = shm_create(3, SHM_PAGE_SIZE);
+
+    if (id < 0 || shm_attach(id, page) != (int32_t)page) {
+        assertion_failure();
+        return FAIL;
+    }
+    // an odd length takes both the word and the byte loop
+    if (copy_to_user(page + 1, "abcdefg", 7) != 0 || copy_from_user(buf, page + 1, 7) != 0 ||
+        memcmp(buf, "abcdefg", 7) != 0 || strncpy_from_user(buf, (int8_t*)page + 1, 8) != 7 ||
+        strncpy_from_user(buf, (int8_t*)page + 1, 3) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    if (copy_from_user(buf, buf, 1) != -1 || copy_to_user(buf, page, 1) != -1 ||
+        access_ok((void*)(USER_SPACE_END - 4), 8) || !access_ok(page, SHM_PAGE_SIZE)) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // the page after the segment is not mapped
+    if (copy_to_user(page + SHM_PAGE_SIZE - 4, "abcdefg", 8) != -1 ||
+        copy_from_user(buf, page + SHM_PAGE_SIZE, 1) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    shm_release(pid);
+    reload_cr3();
+    if (strncpy_from_user(buf, (int8_t*)page, 8) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    return result;
+}
+
+/* fs_write_test
+ *
+ * Creates a file, writes across a block boundary, reads it back and
+ * truncates it, checking that the image's copy of the directory never
+ * changes
+ *
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Leaves an empty file named fs_write_test
+ *   COVERAGE:      fs.c overlay, write_data, fs_create, fs_truncate
+ */
+static int fs_write_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    dentry_t dentry;
+    uint8_t buf[16];
+    uint32_t offset = FS_BLOCK_SIZE - 4;
+    int i;
+
+    if (fs_create((uint8_t*)"fs_write_test", &dentry) != 0 ||
+        inode_length(dentry.inode_index) != 0) {
+        assertion_failure();
+        return FAIL;
+    }
+    // the image's directory is untouched, the overlay's has the file; on a
+    // disk mount dentries is the current directory
+    for (i = 0; inodes != NULL && i < MAX_NUM_DENTRIES; i++) {
+        if (strncmp(dentries[i].file_name, "fs_write_test", FS_FILE_NAME_LEN) == 0) {
+            assertion_failure();
+            result = FAIL;
+        }
+    }
+    // a write past the end leaves zeroes before it
+    if (fs_truncate(dentry.inode_index, offset) != 0 ||
+        write_data(dentry.inode_index, offset, (uint8_t*)"abcdefgh", 8) != 8 ||
+        inode_length(dentry.inode_index) != offset + 8 ||
+        read_data(dentry.inode_index, offset - 4, buf, 12) != 12 ||
+        memcmp(buf, "\0\0\0\0abcdefgh", 12) != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // shrinking then growing again reads zeroes, not the old bytes
+    if (fs_truncate(dentry.inode_index, offset + 2) != 0 ||
+        fs_truncate(dentry.inode_index, offset + 8) != 0 ||
+        read_data(dentry.inode_index, offset, buf, 8) != 8 ||
+        memcmp(buf, "ab\0\0\0\0\0\0", 8) != 0 ||
+        write_data(dentry.inode_index, offset + 9, buf, 1) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // creating it again empties it
+    if (fs_create((uint8_t*)"fs_write_test", &dentry) != 0 ||
+        inode_length(dentry.inode_index) != 0 ||
+        fs_create((uint8_t*)".", &dentry) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    return result;
+}
+
+/*
+ * ata_test
+ *   DESCRIPTION:   Reads the boot block straight from the disk and checks
+ *                  it against the mounted one, then checks that requests
+ *                  off the end of the disk are refused. Needs QEMU started
+ *                  with the filesystem image as a disk, -hdb filesys_img.
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  none
+ *   COVERAGE:      ata.c reads, fs.c disk mount
+ */
+static int ata_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    uint8_t sector[ATA_SECTOR_SIZE];
+    uint32_t drive;
+
+    if (inodes != NULL) {
+        printf("no filesystem on a disk\n");
+        return FAIL;
+    }
+    // the boot block is on one of the drives
+    for (drive = 0; drive < ATA_DRIVES; drive++) {
+        if (ata_read(drive, 0, 1, sector) == 0 &&
+            memcmp(sector, boot_block, ATA_SECTOR_SIZE) == 0)
+            break;
+    }
+    if (drive == ATA_DRIVES) {
+        assertion_failure();
+        return FAIL;
+    }
+    if (ata_read(drive, ata_sectors(drive), 1, sector) != -1 ||
+        ata_read(drive, ata_sectors(drive) - 1, 2, sector) != -1 ||
+        ata_read(drive, 0, 0, sector) != -1 ||
+        ata_read(ATA_DRIVES, 0, 1, sector) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    return result;
+}
+
+/*
+ * bcache_test
+ *   DESCRIPTION:   Checks that the held boot block is a cache hit, and that
+ *                  a block read ahead is found by bread and counted as used.
+ *                  Needs the filesystem on a disk, like ata_test.
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Evicts a block from the cache
+ *   COVERAGE:      bcache.c lookups, read-ahead and counters
+ */
+static int bcache_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    bcache_stats_t before, after;
+    bcache_buf_t* buf;
+    uint32_t drive, last;
+
+    // the mounted boot block is held in the cache
+    for (drive = 0; drive < ATA_DRIVES; drive++) {
+        buf = bcache_lookup(drive, 0);
+        if (buf != NULL && buf->data == (uint8_t*)boot_block)
+            break;
+    }
+    if (drive == ATA_DRIVES) {
+        printf("no filesystem on a disk\n");
+        return FAIL;
+    }
+    bcache_read_stats(&before);
+    if (bread(drive, 0) != buf) {
+        assertion_failure();
+        return FAIL;
+    }
+    brelse(buf);
+    bcache_read_stats(&after);
+    if (after.hits != before.hits + 1 || after.misses != before.misses) {
+        assertion_failure();
+        result = FAIL;
+    }
+
+    // the last block of the disk is not part of a small image
+    last = ata_sectors(drive) / BCACHE_SECTORS - 1;
+    if (bcache_lookup(drive, last) == NULL) {
+        bcache_read_stats(&before);
+        bcache_prefetch(drive, last);
+        if ((buf = bread(drive, last)) == NULL) {
+            assertion_failure();
+            return FAIL;
+        }
+        brelse(buf);
+        bcache_read_stats(&after);
+        if (after.readaheads != before.readaheads + 1
+            || after.readahead_hits != before.readahead_hits + 1
+            || after.misses != before.misses) {
+            assertion_failure();
+            result = FAIL;
+        }
+    }
+    return result;
+}
+
+/*
+ * fs_path_test
+ *   DESCRIPTION:   Resolves the same file by name and by path, the root by
+ *                  "/", and checks that a file cannot be used as a directory
+ *                  and that the root lists the same entries as the boot block.
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  none
+ *   COVERAGE:      fs.c path resolution and the dentry cache
+ */
+static int fs_path_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    dentry_t a, b;
+    uint32_t i;
+
+    if (read_dentry_by_name((uint8_t*)"frame0.txt", &a) != 0
+        || read_dentry_by_name((uint8_t*)"/frame0.txt", &b) != 0
+        || a.inode_index != b.inode_index) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // the second lookup of a path is served by the dentry cache
+    if (read_dentry_by_name((uint8_t*)"//frame0.txt", &b) != 0
+        || a.inode_index != b.inode_index) {
+        assertion_failure();
+        result = FAIL;
+    }
+    if (read_dentry_by_name((uint8_t*)"/", &b) != 0
+        || b.file_type != FS_TYPE_DIR || b.inode_index != FS_ROOT_INODE) {
+        assertion_failure();
+        result = FAIL;
+    }
+    if (read_dentry_by_name((uint8_t*)"frame0.txt/x", &b) != -1
+        || read_dentry_by_name((uint8_t*)"nonexistent/frame0.txt", &b) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    for (i = 0; read_dentry_by_index(i, &a) == 0; i++) {
+        if (read_dentry_in_dir(FS_ROOT_INODE, i, &b) != 0
+            || strncmp((int8_t*)a.file_name, (int8_t*)b.file_name, FS_FILE_NAME_LEN) != 0) {
+            assertion_failure();
+            result = FAIL;
+        }
+    }
+    if (read_dentry_in_dir(FS_ROOT_INODE, i, &b) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    return result;
+}
+
+/*
+ * getdents_test
+ *   DESCRIPTION:   Lists the root with getdents into a user page and with
+ *                  read, checking both see the same entries and that a
+ *                  record's size is its file's length.
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Releases the current process's segments
+ *   COVERAGE:      getdents, dir_getdents
+ */
+static int getdents_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    int pid = get_current_executing_pcb()->process_id;
+    dirent_t* ents = (dirent_t*)SHM_WINDOW_START;
+    int32_t id = shm_create(4, SHM_PAGE_SIZE);
+    int32_t fd, bytes, count, i;
+    // read() takes names in the page too, below test_string's
+    uint8_t* name = TEST_PAGE + SHM_PAGE_SIZE - 2 * TEST_STRING_LEN;
+    dentry_t dentry;
+
+    if (id < 0 || shm_attach(id, ents) != (int32_t)ents || (fd = open(test_string("."))) < 0) {
+        assertion_failure();
+        return FAIL;
+    }
+    if (getdents(fd, ents, sizeof(dirent_t) - 1) != -1
+        || (bytes = getdents(fd, ents, SHM_PAGE_SIZE - 2 * TEST_STRING_LEN)) <= 0
+        || getdents(fd, ents, SHM_PAGE_SIZE - 2 * TEST_STRING_LEN) != 0) {
+        assertion_failure();
+        close(fd);
+        shm_release(pid);
+        reload_cr3();
+        return FAIL;
+    }
+    close(fd);
+    count = bytes / sizeof(dirent_t);
+
+    fd = open(test_string("."));
+    for (i = 0; i < count; i++) {
+        memset(name, 0, FS_FILE_NAME_LEN + 1);
+        if (read(fd, name, FS_FILE_NAME_LEN) <= 0
+            || strncmp((int8_t*)name, (int8_t*)ents[i].name, FS_FILE_NAME_LEN) != 0) {
+            assertion_failure();
+            result = FAIL;
+        }
+        if (ents[i].file_type == FS_TYPE_FILE
+            && (read_dentry_by_name(ents[i].name, &dentry) != 0
+                || ents[i].length != inode_length(dentry.inode_index))) {
+            assertion_failure();
+            result = FAIL;
+        }
+    }
+    if (read(fd, name, FS_FILE_NAME_LEN) != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    close(fd);
+    shm_release(pid);
+    reload_cr3();
+    return result;
+}
+
+/*
+ * stat_test
+ *   DESCRIPTION:   Checks that stat and fstat agree on a file and report its
+ *                  length and block count, that the root has no data blocks
+ *                  and that the terminal cannot be described.
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Releases the current process's segments
+ *   COVERAGE:      stat, fstat, dentry_stat
+ */
+static int stat_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    int pid = get_current_executing_pcb()->process_id;
+    stat_t* st = (stat_t*)SHM_WINDOW_START;
+    int32_t id = shm_create(5, SHM_PAGE_SIZE);
+    int32_t fd;
+    dentry_t dentry;
+    uint32_t length;
+
+    if (id < 0 || shm_attach(id, st) != (int32_t)st
+        || read_dentry_by_name((uint8_t*)"frame0.txt", &dentry) != 0) {
+        assertion_failure();
+        return FAIL;
+    }
+    length = inode_length(dentry.inode_index);
+    if (stat(test_string("frame0.txt"), &st[0]) != 0 || st[0].file_type != FS_TYPE_FILE
+        || st[0].inode_index != dentry.inode_index || st[0].length != length
+        || st[0].blocks != (length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE) {
+        assertion_failure();
+        result = FAIL;
+    }
+    fd = open(test_string("frame0.txt"));
+    if (fstat(fd, &st[1]) != 0 || memcmp(&st[0], &st[1], sizeof(stat_t)) != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    close(fd);
+    if (stat(test_string("/"), &st[0]) != 0 || st[0].file_type != FS_TYPE_DIR || st[0].blocks != 0
+        || fstat(0, &st[0]) != -1 || fstat(fd, &st[0]) != -1
+        || stat(test_string("nonexistent"), &st[0]) != -1 || stat(test_string("frame0.txt"), NULL) != -1
+        || stat((uint8_t*)"frame0.txt", &st[0]) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    shm_release(pid);
+    reload_cr3();
+    return result;
+}
+
+/*
+ * lz4_test
+ *   DESCRIPTION:   Decompresses a block with a match that overlaps its own
+ *                  output, and checks that a match reaching back before the
+ *                  start and output that does not fit are refused.
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  none
+ *   COVERAGE:      lz4.c
+ */
+static int lz4_test() {
+    TEST_HEADER;
+
+    int result = PASS;
+    // "abc", then 14 bytes from 3 back, then "xyz"
+    uint8_t block[] = { 0x3A, 'a', 'b', 'c', 0x03, 0x00, 0x30, 'x', 'y', 'z' };
+    uint8_t out[32];
+
+    if (lz4_decompress(block, sizeof(block), out, sizeof(out)) != 20
+        || strncmp((int8_t*)out, (int8_t*)"abcabcabcabcabcabxyz", 20) != 0) {
+        assertion_failure();
+        result = FAIL;
+    }
+    if (lz4_decompress(block, sizeof(block), out, 19) != -1
+        || lz4_decompress(block, 5, out, sizeof(out)) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    block[4] = 0x04;
+    if (lz4_decompress(block, sizeof(block), out, sizeof(out)) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    return result;
+}
+
+/*
+ * fs_scan_test
+ *   DESCRIPTION:   Writes a new file of three blocks and reads it back in
+ *                  one read. Its blocks were allocated one after the other,
+ *                  but in the module they are in the overlay, so the read
+ *                  must not take them as a run in the image. Then checks
+ *                  that the block count follows the file as it shrinks and
+ *                  that an inode past the end cannot be read. In the module,
+ *                  also points a file of the image at a block past its end
+ *                  and mounts it again, which must find the file bad.
+ *   INPUTS:        none
+ *   OUTPUTS:       PASS/FAIL
+ *   SIDE EFFECTS:  Leaves a file named fs_scan_test of one block, mounts the
+ *                  module again
+ *   COVERAGE:      fs.c scan_inode, read_data, dentry_stat
+ */
+static int fs_scan_test() {
+    TEST_HEADER;
+
+    static uint8_t data[3 * FS_BLOCK_SIZE];
+    static uint8_t buf[3 * FS_BLOCK_SIZE];
+    int result = PASS;
+    dentry_t dentry;
+    uint32_t length, blocks, saved;
+    int i;
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = i * 7;
+    if (fs_create((uint8_t*)"fs_scan_test", &dentry) != 0
+        || write_data(dentry.inode_index, 0, data, sizeof(data)) != sizeof(data)) {
+        assertion_failure();
+        return FAIL;
+    }
+    dentry_stat(&dentry, &length, &blocks);
+    if (read_data(dentry.inode_index, 0, buf, sizeof(buf)) != sizeof(buf)
+        || memcmp(buf, data, sizeof(buf)) != 0 || length != sizeof(data) || blocks != 3) {
+        assertion_failure();
+        result = FAIL;
+    }
+    if (fs_truncate(dentry.inode_index, FS_BLOCK_SIZE) != 0) {
+        assertion_failure();
+        return FAIL;
+    }
+    dentry_stat(&dentry, &length, &blocks);
+    if (blocks != 1 || read_data(dentry.inode_index, 0, buf, FS_BLOCK_SIZE) != FS_BLOCK_SIZE
+        || memcmp(buf, data, FS_BLOCK_SIZE) != 0
+        || read_data(boot_block->num_inodes, 0, buf, 1) != -1) {
+        assertion_failure();
+        result = FAIL;
+    }
+    // only the module's indexed inodes can be changed in place; no block
+    // written since boot is this far past the image
+    if (inodes != NULL && read_dentry_by_name((uint8_t*)"frame1.txt", &dentry) == 0) {
+        saved = inodes[dentry.inode_index].data_index[0];
+        inodes[dentry.inode_index].data_index[0] = boot_block->num_data_blocks + FS_OVERLAY_BLOCKS;
+        init_fs((uint32_t)boot_block);
+        dentry_stat(&dentry, &length, &blocks);
+        if (blocks != 0 || read_data(dentry.inode_index, 0, buf, 1) != -1) {
+            assertion_failure();
+            result = FAIL;
+        }
+        inodes[dentry.inode_index].data_index[0] = saved;
+        init_fs((uint32_t)boot_block);
+        if (read_data(dentry.inode_index, 0, buf, 1) != 1) {
+            assertion_failure();
+            result = FAIL;
+        }
+    }
+    return result;
+}
 
 /* Test suite entry point */
 void launch_tests(){
@@ -647,4 +1757,42 @@ void launch_tests(){
         fs_print_by_index(10);
     if(SYSCALL_TEST_FLAG)
     	TEST_OUTPUT("syscall_test", syscall_test());
+    if(ANSI_TEST_FLAG)
+        TEST_OUTPUT("ansi_test", ansi_test());
+    if(NONBLOCK_TEST_FLAG)
+        TEST_OUTPUT("nonblock_test", nonblock_test());
+    if(LDISC_TEST_FLAG)
+        TEST_OUTPUT("ldisc_test", ldisc_test());
+    if(VGA_DIRTY_TEST_FLAG)
+        TEST_OUTPUT("vga_dirty_test", vga_dirty_test());
+    if(SYSENTER_TEST_FLAG)
+        TEST_OUTPUT("sysenter_test", sysenter_test());
+    if(SUBMIT_TEST_FLAG)
+        TEST_OUTPUT("submit_test", submit_test());
+    if(PIPE_TEST_FLAG)
+        TEST_OUTPUT("pipe_test", pipe_test());
+    if(SHM_TEST_FLAG)
+        TEST_OUTPUT("shm_test", shm_test());
+    if(SIGNAL_TEST_FLAG)
+        TEST_OUTPUT("signal_test", signal_test());
+    if(TIMER_TEST_FLAG)
+        TEST_OUTPUT("timer_test", timer_test());
+    if(UACCESS_TEST_FLAG)
+        TEST_OUTPUT("uaccess_test", uaccess_test());
+    if(FS_WRITE_TEST_FLAG)
+        TEST_OUTPUT("fs_write_test", fs_write_test());
+    if(ATA_TEST_FLAG)
+        TEST_OUTPUT("ata_test", ata_test());
+    if(BCACHE_TEST_FLAG)
+        TEST_OUTPUT("bcache_test", bcache_test());
+    if(FS_PATH_TEST_FLAG)
+        TEST_OUTPUT("fs_path_test", fs_path_test());
+    if(GETDENTS_TEST_FLAG)
+        TEST_OUTPUT("getdents_test", getdents_test());
+    if(STAT_TEST_FLAG)
+        TEST_OUTPUT("stat_test", stat_test());
+    if(LZ4_TEST_FLAG)
+        TEST_OUTPUT("lz4_test", lz4_test());
+    if(FS_SCAN_TEST_FLAG)
+        TEST_OUTPUT("fs_scan_test", fs_scan_test());
 }
@@ -12,6 +12,25 @@
 #define FS_PRINT_BY_NAME_TEST_FLAG 0
 #define FS_PRINT_BY_INDEX_TEST_FLAG 0
 #define SYSCALL_TEST_FLAG 1
+#define ANSI_TEST_FLAG 0
+#define NONBLOCK_TEST_FLAG 0
+#define LDISC_TEST_FLAG 0
+#define VGA_DIRTY_TEST_FLAG 0
+#define SYSENTER_TEST_FLAG 0
+#define SUBMIT_TEST_FLAG 0
+#define PIPE_TEST_FLAG 0
+#define SHM_TEST_FLAG 0
+#define SIGNAL_TEST_FLAG 0
+#define TIMER_TEST_FLAG 0
+#define UACCESS_TEST_FLAG 0
+#define FS_WRITE_TEST_FLAG 0
+#define ATA_TEST_FLAG 0
+#define BCACHE_TEST_FLAG 0
+#define FS_PATH_TEST_FLAG 0
+#define GETDENTS_TEST_FLAG 0
+#define STAT_TEST_FLAG 0
+#define LZ4_TEST_FLAG 0
+#define FS_SCAN_TEST_FLAG 0
 
 // test launcher
 void launch_tests();
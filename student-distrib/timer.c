@@ -0,0 +1,255 @@
+/* timer.c -- kernel timers on a timer wheel driven by the PIT
+ * vim:ts=4 noexpandtab
+ */
+
+#include "timer.h"
+#include "scheduler.h"
+
+#define NSEC_PER_TICK	(PIT_TICK_MS * 1000000)
+#define TICKS_PER_SEC	(1000 / PIT_TICK_MS)
+#define CPUID_FEATURES	1
+#define CPUID_TSC		0x10				// EDX bit 4, time stamp counter present
+
+/* One list of timers per slot. */
+static ktimer_t* wheel[TIMER_WHEEL_SLOTS];
+
+/* Set when rdtsc can be used to read time between two ticks. */
+static int has_tsc = 0;
+/* Time stamp counter sampled by the last tick. */
+static uint32_t tick_tsc = 0;
+/* Time stamp counter cycles per tick, 0 until measured. */
+static uint32_t tsc_per_tick = 0;
+
+/*
+ * rdtsc_low
+ *   DESCRIPTION:	Reads the low half of the time stamp counter. Differences
+ *					are taken modulo 2^32, which is enough for one tick.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	low 32 bits of the counter
+ *   SIDE EFFECTS: 	none
+ */
+static inline uint32_t rdtsc_low() {
+	uint32_t lo, hi;
+
+	asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return lo;
+}
+
+/*
+ * mul_div
+ *   DESCRIPTION:	Computes a * b / c with a 64 bit intermediate product,
+ *					since there is no library for 64 bit division.
+ *   INPUTS: 		a, b, c : operands, a must be less than c
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	the quotient, which fits since a < c
+ *   SIDE EFFECTS: 	none
+ */
+static inline uint32_t mul_div(uint32_t a, uint32_t b, uint32_t c) {
+	uint32_t q, r;
+
+	asm("mull %2		\n\
+		divl %3"
+		: "=a" (q), "=&d" (r)
+		: "r" (b), "r" (c), "0" (a)
+		: "cc");
+	return q;
+}
+
+/*
+ * init_timers
+ *   DESCRIPTION:	Empties the timer wheel and checks whether the processor
+ *					has a time stamp counter to interpolate between ticks.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void init_timers() {
+	uint32_t eax, ebx, ecx, edx;
+	int i;
+
+	for (i = 0; i < TIMER_WHEEL_SLOTS; i++)
+		wheel[i] = NULL;
+
+	asm volatile("cpuid"
+				 : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+				 : "a" (CPUID_FEATURES));
+	has_tsc = (edx & CPUID_TSC) != 0;
+}
+
+/*
+ * init_timer
+ *   DESCRIPTION:	Sets the function a timer runs. The timer is not armed.
+ *   INPUTS: 		ktimer_t* timer : timer to set up
+ *					timer_fn_t fn : function to call when it expires
+ *					uint32_t data : argument to fn
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void init_timer(ktimer_t* timer, timer_fn_t fn, uint32_t data) {
+	timer->next = NULL;
+	timer->expires = 0;
+	timer->fn = fn;
+	timer->data = data;
+	timer->pending = 0;
+}
+
+/*
+ * add_timer
+ *   DESCRIPTION:	Arms a timer to run on a PIT tick. A tick that has already
+ *					passed runs on the next one.
+ *   INPUTS: 		ktimer_t* timer : timer to arm
+ *					uint32_t expires : value of pit_ticks to run at
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Puts the timer in the wheel
+ */
+void add_timer(ktimer_t* timer, uint32_t expires) {
+	uint32_t flags;
+	ktimer_t** slot;
+
+	cli_and_save(flags);
+	del_timer(timer);
+	if ((int32_t)(expires - pit_ticks) <= 0)
+		expires = pit_ticks + 1;
+	timer->expires = expires;
+	slot = &wheel[expires & TIMER_WHEEL_MASK];
+	timer->next = *slot;
+	*slot = timer;
+	timer->pending = 1;
+	restore_flags(flags);
+}
+
+/*
+ * del_timer
+ *   DESCRIPTION:	Takes a timer out of the wheel before it runs.
+ *   INPUTS: 		ktimer_t* timer : timer to disarm
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void del_timer(ktimer_t* timer) {
+	uint32_t flags;
+	ktimer_t** link;
+
+	cli_and_save(flags);
+	if (timer->pending) {
+		link = &wheel[timer->expires & TIMER_WHEEL_MASK];
+		while (*link != timer)
+			link = &(*link)->next;
+		*link = timer->next;
+		timer->next = NULL;
+		timer->pending = 0;
+	}
+	restore_flags(flags);
+}
+
+/*
+ * run_timers
+ *   DESCRIPTION:	Called by the PIT handler after counting the tick. Samples
+ *					the time stamp counter for clock_monotonic, then runs every
+ *					timer in this tick's slot that is due. Due timers are taken
+ *					out first, so a function may arm its own timer again.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Runs timer functions with interrupts off
+ */
+void run_timers() {
+	ktimer_t** link;
+	ktimer_t* timer;
+	ktimer_t* due = NULL;
+	uint32_t now, cycles;
+
+	if (has_tsc) {
+		now = rdtsc_low();
+		cycles = now - tick_tsc;
+		// a late tick would stretch the estimate, so it is not counted
+		if (tsc_per_tick == 0 || cycles < 2 * tsc_per_tick)
+			tsc_per_tick = tsc_per_tick ? tsc_per_tick - tsc_per_tick / 8 + cycles / 8 : cycles;
+		tick_tsc = now;
+	}
+
+	link = &wheel[pit_ticks & TIMER_WHEEL_MASK];
+	while ((timer = *link) != NULL) {
+		if ((int32_t)(pit_ticks - timer->expires) >= 0) {
+			*link = timer->next;
+			timer->pending = 0;
+			timer->next = due;
+			due = timer;
+		} else {
+			link = &timer->next;
+		}
+	}
+
+	while ((timer = due) != NULL) {
+		due = timer->next;
+		timer->next = NULL;
+		timer->fn(timer->data);
+	}
+}
+
+/*
+ * timespec_to_ticks
+ *   DESCRIPTION:	Turns a length of time into PIT ticks, rounding up so that
+ *					a timer never runs early. Timers compare ticks as signed
+ *					differences, so longer times are cut to TIMER_MAX_TICKS
+ *					rather than wrapping into the past.
+ *   INPUTS: 		const timespec_t* ts : length of time, already validated
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	number of ticks, at most TIMER_MAX_TICKS
+ *   SIDE EFFECTS: 	none
+ */
+uint32_t timespec_to_ticks(const timespec_t* ts) {
+	uint32_t ticks = (ts->tv_nsec + NSEC_PER_TICK - 1) / NSEC_PER_TICK;
+
+	if ((uint32_t)ts->tv_sec > (TIMER_MAX_TICKS - ticks) / TICKS_PER_SEC)
+		return TIMER_MAX_TICKS;
+	return ts->tv_sec * TICKS_PER_SEC + ticks;
+}
+
+/*
+ * ticks_to_timespec
+ *   DESCRIPTION:	Turns a number of PIT ticks into a length of time.
+ *   INPUTS: 		uint32_t ticks : number of ticks
+ *   OUTPUTS:		timespec_t* ts : the length of time
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void ticks_to_timespec(uint32_t ticks, timespec_t* ts) {
+	ts->tv_sec = ticks / TICKS_PER_SEC;
+	ts->tv_nsec = (ticks % TICKS_PER_SEC) * NSEC_PER_TICK;
+}
+
+/*
+ * clock_monotonic
+ *   DESCRIPTION:	Reads the time since the PIT started. Ticks give the time
+ *					to 10ms; the time stamp counter cycles since the last tick,
+ *					scaled by the measured cycles per tick, fill in the rest.
+ *					The part within a tick is kept below one tick, so the clock
+ *					never runs backwards across a tick.
+ *   INPUTS: 		none
+ *   OUTPUTS:		timespec_t* ts : time since boot
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void clock_monotonic(timespec_t* ts) {
+	uint32_t flags, ticks, cycles, per_tick;
+	uint32_t nsec = 0;
+
+	cli_and_save(flags);
+	ticks = pit_ticks;
+	per_tick = tsc_per_tick;
+	cycles = has_tsc ? rdtsc_low() - tick_tsc : 0;
+	restore_flags(flags);
+
+	if (per_tick != 0) {
+		if (cycles >= per_tick)
+			cycles = per_tick - 1;
+		nsec = mul_div(cycles, NSEC_PER_TICK, per_tick);
+	}
+	ticks_to_timespec(ticks, ts);
+	ts->tv_nsec += nsec;
+}
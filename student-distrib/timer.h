@@ -0,0 +1,62 @@
+/* timer.h - Kernel timers on a timer wheel driven by the PIT
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _TIMER_H
+#define _TIMER_H
+
+#include "types.h"
+
+#define TIMER_WHEEL_SLOTS	64							// one slot per tick, must be a power of two
+#define TIMER_WHEEL_MASK	(TIMER_WHEEL_SLOTS - 1)
+
+#define NSEC_PER_SEC		1000000000
+#define TIMER_MAX_TICKS		0x7FFFFFFE					// longest delay, kept below 2^31 ticks with nanosleep's extra one
+#define CLOCK_MONOTONIC		1							// time since boot, the only clock
+#define ITIMER_REAL			0							// sends ALARM, the only interval timer
+
+/* A point in time or a length of time. */
+typedef struct timespec_t {
+	int32_t tv_sec;
+	int32_t tv_nsec;									// 0 to NSEC_PER_SEC - 1
+} timespec_t;
+
+/* An interval timer: it_value until the first ALARM, it_interval between
+ * the ones after it. A zero it_value disarms the timer. */
+typedef struct itimerval_t {
+	timespec_t it_interval;
+	timespec_t it_value;
+} itimerval_t;
+
+typedef void (*timer_fn_t)(uint32_t data);
+
+/* A timer sits in the wheel slot of the tick it expires on. Slots are
+ * visited once per tick, so a timer more than one turn away is skipped
+ * until its tick comes around. */
+typedef struct ktimer_t {
+	struct ktimer_t* next;								// next timer in the same slot
+	uint32_t expires;									// PIT tick to run on
+	timer_fn_t fn;										// called with interrupts off
+	uint32_t data;										// argument to fn
+	uint32_t pending;									// set while in the wheel
+} ktimer_t;
+
+/* Empties the wheel and checks for a time stamp counter. */
+void init_timers();
+/* Sets up a timer that is not in the wheel. */
+void init_timer(ktimer_t* timer, timer_fn_t fn, uint32_t data);
+/* Arms a timer, or moves it if it is already armed. */
+void add_timer(ktimer_t* timer, uint32_t expires);
+/* Disarms a timer, does nothing if it is not armed. */
+void del_timer(ktimer_t* timer);
+/* Runs the timers due on this tick, called by the PIT handler. */
+void run_timers();
+
+/* Turns a length of time into PIT ticks, rounded up. */
+uint32_t timespec_to_ticks(const timespec_t* ts);
+/* Turns a number of PIT ticks into a length of time. */
+void ticks_to_timespec(uint32_t ticks, timespec_t* ts);
+/* Reads the time since boot, to the nanosecond where the TSC allows. */
+void clock_monotonic(timespec_t* ts);
+
+#endif /* _TIMER_H */
@@ -0,0 +1,114 @@
+/* uaccess.c -- copying between kernel and user memory
+ * vim:ts=4 noexpandtab
+ */
+
+#include "uaccess.h"
+
+#define PAGE_FAULT_VECTOR	14
+#define RPL_MASK			0x3					// privilege bits of a selector
+
+/*
+ * access_ok
+ *   DESCRIPTION:	Checks that a range lies between the vidmap page and the
+ *					end of the shared memory window, the only memory a
+ *					program may hand the kernel. Part of the range may still
+ *					be unmapped; the copy routines catch that when they fault.
+ *   INPUTS: 		addr : start of the range
+ *					n : length of the range in bytes
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	1 if the range is in user memory, 0 if not
+ *   SIDE EFFECTS: 	none
+ */
+int32_t access_ok(const void* addr, uint32_t n) {
+	uint32_t start = (uint32_t)addr;
+
+	return start >= USER_SPACE_START && start <= USER_SPACE_END
+		&& n <= USER_SPACE_END - start;
+}
+
+/*
+ * copy_from_user
+ *   DESCRIPTION:	Copies a buffer out of the current program a word at a
+ *					time. A page fault on an unmapped user page makes the
+ *					copy fail instead of killing the program.
+ *   INPUTS: 		to : kernel buffer
+ *					from : address in the program
+ *					n : number of bytes
+ *   OUTPUTS:		the bytes at to
+ *   RETURN VALUE: 	0 on success, -1 if from is not user memory or faulted
+ *   SIDE EFFECTS: 	to may be partly written on failure
+ */
+int32_t copy_from_user(void* to, const void* from, uint32_t n) {
+	if (!access_ok(from, n))
+		return -1;
+	return uaccess_copy(to, from, n);
+}
+
+/*
+ * copy_to_user
+ *   DESCRIPTION:	Copies a buffer into the current program a word at a time.
+ *					A page fault on an unmapped user page makes the copy fail
+ *					instead of killing the program.
+ *   INPUTS: 		to : address in the program
+ *					from : kernel buffer
+ *					n : number of bytes
+ *   OUTPUTS:		the bytes at to
+ *   RETURN VALUE: 	0 on success, -1 if to is not user memory or faulted
+ *   SIDE EFFECTS: 	to may be partly written on failure
+ */
+int32_t copy_to_user(void* to, const void* from, uint32_t n) {
+	if (!access_ok(to, n))
+		return -1;
+	return uaccess_copy(to, from, n);
+}
+
+/*
+ * strncpy_from_user
+ *   DESCRIPTION:	Copies a NUL terminated string out of the current program.
+ *					Reading stops at the end of user memory, so n may be
+ *					larger than what is left of it. to may itself be user
+ *					memory checked with access_ok, faults are caught on
+ *					both sides.
+ *   INPUTS: 		to : buffer of n bytes
+ *					from : string in the program
+ *					n : most bytes to copy, the NUL included
+ *   OUTPUTS:		the string at to
+ *   RETURN VALUE: 	length of the string, -1 if from is not user memory,
+ *					faulted or has no NUL in the first n bytes
+ *   SIDE EFFECTS: 	to may be partly written on failure
+ */
+int32_t strncpy_from_user(int8_t* to, const int8_t* from, uint32_t n) {
+	uint32_t start = (uint32_t)from;
+
+	if (!access_ok(from, 0))
+		return -1;
+	if (n > USER_SPACE_END - start)
+		n = USER_SPACE_END - start;
+	return uaccess_strncpy(to, from, n);
+}
+
+/*
+ * fixup_exception
+ *   DESCRIPTION:	Called first for every exception. If a page fault hit one
+ *					of the instructions in the exception table while in the
+ *					kernel, the saved eip is moved to its fixup, so the copy
+ *					returns -1 when the handler returns.
+ *   INPUTS: 		context : registers saved by the exception wrapper
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	1 if the fault was fixed up, 0 if it should be handled
+ *					as before
+ *   SIDE EFFECTS: 	Changes the saved eip
+ */
+int32_t fixup_exception(hw_context_t* context) {
+	uaccess_fixup_t* entry;
+
+	if (context->vector != PAGE_FAULT_VECTOR || (context->cs & RPL_MASK) != 0)
+		return 0;
+	for (entry = uaccess_fixups; entry < uaccess_fixups_end; entry++) {
+		if (entry->insn == context->eip) {
+			context->eip = entry->fixup;
+			return 1;
+		}
+	}
+	return 0;
+}
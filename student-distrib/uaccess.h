@@ -0,0 +1,40 @@
+/* uaccess.h - Copying between kernel and user memory
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _UACCESS_H
+#define _UACCESS_H
+
+#include "types.h"
+#include "signal.h"
+#include "paging.h"
+#include "shm.h"
+
+#define USER_SPACE_START	(VID_MAP_VIRTUAL_INDEX << 22)	// 124mb, the vidmap page
+#define USER_SPACE_END		SHM_WINDOW_END					// 140mb, end of the shared memory window
+
+/* An instruction in copy_user.S that may fault on a user address, and the
+ * code that makes the copy fail instead. */
+typedef struct uaccess_fixup_t {
+	uint32_t insn;
+	uint32_t fixup;
+} uaccess_fixup_t;
+
+/* Checks that n bytes at addr lie in the part of memory user programs own. */
+int32_t access_ok(const void* addr, uint32_t n);
+/* Copies n bytes from a program, 0 on success, -1 if from is bad. */
+int32_t copy_from_user(void* to, const void* from, uint32_t n);
+/* Copies n bytes to a program, 0 on success, -1 if to is bad. */
+int32_t copy_to_user(void* to, const void* from, uint32_t n);
+/* Copies a string from a program, returns its length or -1. */
+int32_t strncpy_from_user(int8_t* to, const int8_t* from, uint32_t n);
+/* Resumes a page fault in the copy routines at their fixup, 1 if it did. */
+int32_t fixup_exception(hw_context_t* context);
+
+/* in copy_user.S */
+int32_t uaccess_copy(void* to, const void* from, uint32_t n);
+int32_t uaccess_strncpy(int8_t* to, const int8_t* from, uint32_t n);
+extern uaccess_fixup_t uaccess_fixups[];
+extern uaccess_fixup_t uaccess_fixups_end[];
+
+#endif /* _UACCESS_H */
@@ -0,0 +1,108 @@
+/* wait.c -- wait queues for processes blocked on a device
+ * vim:ts=4 noexpandtab
+ */
+
+#include "wait.h"
+#include "syscall.h"
+#include "scheduler.h"
+
+/*
+ * init_wait_queue
+ *   DESCRIPTION:	Empties a wait queue.
+ *   INPUTS: 		wait_queue_t* wq : queue to empty
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void init_wait_queue(wait_queue_t* wq) {
+	wq->waiters = 0;
+}
+
+/*
+ * poll_wait
+ *   DESCRIPTION:	Adds the current process to a wait queue without putting it
+ *					to sleep. Used by poll, which registers on the queue of every
+ *					device it watches before sleeping once.
+ *   INPUTS: 		wait_queue_t* wq : queue to wait on
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void poll_wait(wait_queue_t* wq) {
+	wq->waiters |= 1 << get_current_executing_pcb()->process_id;
+}
+
+/*
+ * sleep_current
+ *   DESCRIPTION:	Marks the current process as sleeping and gives up the
+ *					processor. Returns once a wake_up on any queue the process
+ *					registered on has run. Interrupts must be disabled so that
+ *					a wakeup cannot slip in between the caller's readiness check
+ *					and the sleep. A signal that kills the process ends the
+ *					sleep for good.
+ *   INPUTS: 		none
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Runs the scheduler, may halt the process
+ */
+void sleep_current() {
+	get_current_executing_pcb()->state = TASK_SLEEPING;
+	schedule();
+	handle_fatal_signals();
+}
+
+/*
+ * sleep_on
+ *   DESCRIPTION:	Adds the current process to a wait queue and sleeps until it
+ *					is woken. Callers recheck their condition in a loop since
+ *					wakeups may be spurious.
+ *   INPUTS: 		wait_queue_t* wq : queue to wait on
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Runs the scheduler
+ */
+void sleep_on(wait_queue_t* wq) {
+	poll_wait(wq);
+	sleep_current();
+}
+
+/*
+ * sleep_on_uninterruptible
+ *   DESCRIPTION:	Like sleep_on, but a fatal signal does not end the sleep.
+ *					For waits that must finish, such as a disk transfer into a
+ *					buffer on the kernel stack; the signal kills the process
+ *					once it returns to user space.
+ *   INPUTS: 		wait_queue_t* wq : queue to wait on
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	Runs the scheduler
+ */
+void sleep_on_uninterruptible(wait_queue_t* wq) {
+	poll_wait(wq);
+	get_current_executing_pcb()->state = TASK_SLEEPING;
+	schedule();
+}
+
+/*
+ * wake_up
+ *   DESCRIPTION:	Makes every process sleeping on a wait queue runnable and
+ *					empties the queue. Safe to call from interrupt handlers.
+ *   INPUTS: 		wait_queue_t* wq : queue to wake
+ *   OUTPUTS:		none
+ *   RETURN VALUE: 	none
+ *   SIDE EFFECTS: 	none
+ */
+void wake_up(wait_queue_t* wq) {
+	uint32_t waiters, flags;
+	int pid;
+
+	cli_and_save(flags);
+	waiters = wq->waiters;
+	wq->waiters = 0;
+	for (pid = 0; pid < MAX_NUM_PROCESSES; pid++) {
+		// a process that halted since it registered stays a zombie
+		if ((waiters & (1 << pid)) && get_pcb_by_PID(pid)->state == TASK_SLEEPING)
+			get_pcb_by_PID(pid)->state = TASK_RUNNING;
+	}
+	restore_flags(flags);
+}
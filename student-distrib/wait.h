@@ -0,0 +1,30 @@
+/* wait.h - Wait queues for sleeping until a device is ready
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _WAIT_H
+#define _WAIT_H
+
+#include "types.h"
+
+/* A wait queue is the set of PIDs sleeping on it, one bit per PID. A
+ * process may sit on several queues at once (poll); stale bits only
+ * cause a spurious wakeup, so every sleeper must recheck its condition. */
+typedef struct wait_queue_t {
+	volatile uint32_t waiters;
+} wait_queue_t;
+
+/* Empties a wait queue. */
+void init_wait_queue(wait_queue_t* wq);
+/* Registers the current process on a queue without sleeping. */
+void poll_wait(wait_queue_t* wq);
+/* Sleeps the current process until something wakes it, call with interrupts off. */
+void sleep_current();
+/* Registers the current process on a queue and sleeps, call with interrupts off. */
+void sleep_on(wait_queue_t* wq);
+/* Like sleep_on, but fatal signals wait until the sleep is over. */
+void sleep_on_uninterruptible(wait_queue_t* wq);
+/* Wakes every process sleeping on a queue. */
+void wake_up(wait_queue_t* wq);
+
+#endif /* _WAIT_H */
@@ -0,0 +1,64 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define READSIZE 4096
+#define NUMBUF 16
+
+static void
+put_count (const char* name, uint32_t value)
+{
+    uint8_t num[NUMBUF];
+
+    ece391_itoa (value, num, 10);
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, num);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/*
+ * cachestat <file>: reads a file through and reports how long it took and
+ * what the block cache did meanwhile.  Reading the same file twice shows
+ * the cache; a large file read once shows read-ahead.
+ */
+int main ()
+{
+    int32_t fd, cnt;
+    uint8_t name[BUFSIZE];
+    static uint8_t buf[READSIZE];
+    uint32_t bytes = 0;
+    struct ece391_bcache_stats before, after;
+    struct ece391_timespec start, end;
+
+    if (0 != ece391_getargs (name, BUFSIZE)) {
+        ece391_fdputs (1, (uint8_t*)"usage: cachestat <file>\n");
+        return 3;
+    }
+    if (-1 == (fd = ece391_open (name))) {
+        ece391_fdputs (1, (uint8_t*)"file not found\n");
+        return 2;
+    }
+
+    ece391_bcache_stats (&before);
+    ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, &start);
+    while (0 < (cnt = ece391_read (fd, buf, READSIZE)))
+        bytes += cnt;
+    ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, &end);
+    ece391_bcache_stats (&after);
+    ece391_close (fd);
+    if (-1 == cnt) {
+        ece391_fdputs (1, (uint8_t*)"file read failed\n");
+        return 3;
+    }
+
+    put_count ("bytes: ", bytes);
+    put_count ("us: ", (end.tv_sec - start.tv_sec) * 1000000
+                       + (end.tv_nsec - start.tv_nsec) / 1000);
+    put_count ("hits: ", after.hits - before.hits);
+    put_count ("misses: ", after.misses - before.misses);
+    put_count ("read ahead: ", after.readaheads - before.readaheads);
+    put_count ("read ahead used: ", after.readahead_hits - before.readahead_hits);
+    return 0;
+}
@@ -6,17 +6,17 @@
 #define BUFSIZE 1024
 #define SBUFSIZE 33
 
+/*
+ * Prints the lines read from fd that contain s, each prefixed with
+ * "fname:" unless fname is 0.
+ */
 int32_t
-do_one_file (const char* s, const char* fname) 
+do_one_fd (const char* s, int32_t fd, const char* fname)
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
+    int32_t cnt, last, line_start, line_end, check, s_len;
     uint8_t data[BUFSIZE+1];
 
     s_len = ece391_strlen ((uint8_t*)s);
-    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
-        ece391_fdputs (1, (uint8_t*)"file open failed\n");
-        return -1;
-    }
     last = 0;
     while (1) {
         cnt = ece391_read (fd, data + last, BUFSIZE - last);
@@ -30,7 +30,9 @@ do_one_file (const char* s, const char* fname)
 	    line_end = line_start;
 	    while (line_end < last && '\n' != data[line_end])
 		line_end++;
-	    if ('\n' != data[line_end] && 0 != cnt && line_start != 0) {
+	    /* a pipe may hand over part of a line; wait for the rest */
+	    if (line_end == last && 0 != cnt &&
+	        (line_start != 0 || last < BUFSIZE)) {
 		/* copy from line_start to last down to 0 and fix last */
 		data[line_end] = '\0';
 		ece391_strcpy (data, data + line_start);
@@ -42,8 +44,10 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
+		    if (0 != fname) {
+			ece391_fdputs (1, (uint8_t*)fname);
+			ece391_fdputs (1, (uint8_t*)":");
+		    }
 		    ece391_fdputs (1, data + line_start);
 		    ece391_fdputs (1, (uint8_t*)"\n");
 		    break;
@@ -58,6 +62,20 @@ do_one_file (const char* s, const char* fname)
 	if (0 == cnt)
 	    break;
     }
+    return 0;
+}
+
+int32_t
+do_one_file (const char* s, const char* fname) 
+{
+    int32_t fd;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
+        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+        return -1;
+    }
+    if (0 != do_one_fd (s, fd, fname))
+        return -1;
     if (-1 == ece391_close (fd)) {
         ece391_fdputs (1, (uint8_t*)"file close failed\n");
         return -1;
@@ -70,12 +88,17 @@ int main ()
     int32_t fd, cnt;
     uint8_t buf[SBUFSIZE];
     uint8_t search[BUFSIZE];
+    struct ece391_stat st;
 
     if (0 != ece391_getargs (search, BUFSIZE)) {
         ece391_fdputs (1, (uint8_t*)"could not read argument\n");
         return 3;
     }
 
+    /* stdin that is not the terminal is a pipe; search it instead */
+    if (-1 == ece391_ioctl (0, ECE391_TERM_GET_MODE, 0))
+        return (0 == do_one_fd ((char*)search, 0, 0)) ? 0 : 3;
+
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
 	return 2;
@@ -86,9 +109,10 @@ int main ()
 	    ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	    return 3;
 	}
-	if ('.' == buf[0]) /* a directory... */
-	    continue;
 	buf[cnt] = '\0';
+	/* search files only, not directories or the RTC */
+	if (0 != ece391_stat (buf, &st) || ECE391_TYPE_FILE != st.type)
+	    continue;
 	if (0 != do_one_file ((char*)search, (char*)buf))
 	    return 3;
     }
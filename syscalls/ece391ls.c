@@ -3,26 +3,48 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define SBUFSIZE 33
+#define BATCH 16
+#define NAME_COLUMN 34
 
+/*
+ * Reads directory entries BATCH at a time with getdents, which also gives
+ * each entry's type and size, and prints a batch with a single write.
+ * Directories are marked with a trailing '/'.
+ */
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, i, len, start;
+    struct ece391_dirent ents[BATCH];
+    uint8_t num[12];
+    uint8_t out[BATCH * (NAME_COLUMN + sizeof (num))];
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    while (0 != (cnt = ece391_getdents (fd, ents, sizeof (ents)))) {
         if (-1 == cnt) {
-	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
-	        return 3;
-	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
-	        return 3;
+            ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
+            return 3;
+        }
+        len = 0;
+        for (i = 0; i < cnt / (int32_t)sizeof (ents[0]); i++) {
+            start = len;
+            ece391_strcpy (&out[len], ents[i].name);
+            len += ece391_strlen (ents[i].name);
+            if (ECE391_TYPE_DIR == ents[i].type)
+                out[len++] = '/';
+            do {
+                out[len++] = ' ';
+            } while (len - start < NAME_COLUMN);
+            ece391_itoa (ents[i].length, num, 10);
+            ece391_strcpy (&out[len], num);
+            len += ece391_strlen (num);
+            out[len++] = '\n';
+        }
+        if (len != ece391_write (1, out, len))
+            return 3;
     }
 
     return 0;
@@ -11,6 +11,36 @@
 #define LOOPMAX BUFMAX-ENDING-1
 #define STARTCHAR 'A'
 #define ENDCHAR 'Z'
+#define LINEMAX 128
+
+/*
+ * Waits for the next RTC tick while also watching the keyboard.
+ * Returns 1 once the user presses a key, 0 after a tick.
+ */
+static int32_t wait_tick (int32_t rtc_fd)
+{
+    struct ece391_pollfd fds[2];
+    uint8_t line[LINEMAX];
+    int garbage;
+
+    fds[0].fd = 0;
+    fds[0].events = ECE391_POLLIN;
+    fds[1].fd = rtc_fd;
+    fds[1].events = ECE391_POLLIN;
+
+    while (1) {
+        if (ece391_poll (fds, 2, -1) < 0)
+            return 1;
+        if (fds[0].revents & ECE391_POLLIN) {
+            ece391_read (0, line, LINEMAX);
+            return 1;
+        }
+        if (fds[1].revents & ECE391_POLLIN) {
+            ece391_read (rtc_fd, &garbage, 4);
+            return 0;
+        }
+    }
+}
 
 int main ()
 {
@@ -19,7 +49,6 @@ int main ()
     uint8_t curchar = STARTCHAR;
     uint8_t update = 1;
     int ret_val;
-    int garbage;
     int rtc_fd;
     uint8_t buf[BUFMAX];
     
@@ -33,6 +62,10 @@ int main ()
     buf[BUFMAX-3]='|';
     buf[START]='|';
 
+    // Deliver each keystroke at once so any key stops the animation;
+    // the kernel gives the shell back the mode it had when we halt
+    ece391_ioctl (0, ECE391_TERM_SET_MODE, ECE391_TERM_RAW);
+
     // Open and set RTC Frequency
     rtc_fd = ece391_open((uint8_t*)"rtc");
     ret_val = 32;
@@ -53,8 +86,9 @@ int main ()
 		buf[j] = curchar;
 		ece391_fdputs (1, buf);
 
-		// Wait for RTC tick
-		ece391_read(rtc_fd, &garbage, 4);
+		// Wait for RTC tick, stop on a keystroke
+		if (wait_tick (rtc_fd))
+			goto quit;
 	}
 	
 	// Bounce back
@@ -70,8 +104,9 @@ int main ()
 		buf[j] = curchar;
 		ece391_fdputs (1, buf);
 
-		// Wait for RTC tick
-		ece391_read(rtc_fd, &garbage, 4);
+		// Wait for RTC tick, stop on a keystroke
+		if (wait_tick (rtc_fd))
+			goto quit;
     	}
 
 	// Edge case on characters
@@ -85,5 +120,8 @@ int main ()
 		curchar = curchar + update;
 	}
     }
+
+quit:
+    ece391_close(rtc_fd);
     return 0;
 }
@@ -4,14 +4,140 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define SAVED_STDIN 6
+#define SAVED_STDOUT 7
+#define SAVED_REDIRECT 5
+#define NUMBUF 12
+
+/* Strips the spaces around a command in place. */
+static uint8_t* trim (uint8_t* s)
+{
+    uint8_t* end;
+
+    while (' ' == *s)
+        s++;
+    end = s + ece391_strlen (s);
+    while (end > s && ' ' == end[-1])
+        *--end = '\0';
+    return s;
+}
+
+/*
+ * Runs "left | right": left's stdout is the write end of a pipe and
+ * right's stdin the read end.  Each program inherits the stdin and stdout
+ * the shell has when it starts it, so the shell points its own at the
+ * pipe and puts the terminal back afterwards.  left is spawned so both
+ * run at once; returns right's status.
+ */
+static int32_t run_pipeline (uint8_t* left, uint8_t* right)
+{
+    int32_t fds[2];
+    int32_t left_pid, rval;
+
+    if (-1 == ece391_pipe (fds))
+        return -1;
+    ece391_dup2 (0, SAVED_STDIN);
+    ece391_dup2 (1, SAVED_STDOUT);
+
+    ece391_dup2 (fds[1], 1);
+    ece391_close (fds[1]);
+    left_pid = ece391_spawn (left);
+    ece391_dup2 (SAVED_STDOUT, 1);
+
+    ece391_dup2 (fds[0], 0);
+    ece391_close (fds[0]);
+    rval = (-1 == left_pid) ? -1 : ece391_execute (right);
+    ece391_dup2 (SAVED_STDIN, 0);
+
+    /* with the read end gone left sees its writes fail and halts */
+    if (-1 != left_pid)
+        ece391_waitpid (left_pid, 0, 0);
+
+    ece391_close (SAVED_STDIN);
+    ece391_close (SAVED_STDOUT);
+    return rval;
+}
+
+/* Runs a command or a pipeline of two; returns the status of the last. */
+static int32_t run_command (uint8_t* buf)
+{
+    uint8_t* bar;
+
+    for (bar = buf; '\0' != *bar && '|' != *bar; bar++);
+    if ('|' == *bar) {
+        *bar = '\0';
+        return run_pipeline (trim (buf), trim (bar + 1));
+    }
+    return ece391_execute (buf);
+}
+
+/*
+ * Runs "command > file" with the shell's stdout pointed at the file, which
+ * create makes empty first.  The command may be a pipeline; its last
+ * program inherits the file as stdout.  Returns -2 if the file cannot be
+ * created.
+ */
+static int32_t run_redirect (uint8_t* command, uint8_t* file)
+{
+    int32_t fd, rval;
+
+    if (-1 == (fd = ece391_create (file)))
+        return -2;
+    ece391_dup2 (1, SAVED_REDIRECT);
+    ece391_dup2 (fd, 1);
+    ece391_close (fd);
+    rval = run_command (command);
+    ece391_dup2 (SAVED_REDIRECT, 1);
+    ece391_close (SAVED_REDIRECT);
+    return rval;
+}
+
+/* Reports background jobs that have finished since the last prompt. */
+static void reap_jobs (void)
+{
+    int32_t pid, status;
+    uint8_t num[NUMBUF];
+
+    while (0 < (pid = ece391_waitpid (-1, &status, ECE391_WNOHANG))) {
+        ece391_itoa (pid, num, 10);
+        ece391_fdputs (1, (uint8_t*)"[");
+        ece391_fdputs (1, num);
+        ece391_fdputs (1, (uint8_t*)"] done\n");
+    }
+}
+
+/* Ctrl+C only interrupts the foreground program, not the shell. */
+static void ignore_interrupt (int signum)
+{
+}
+
+/* Starts "command &" and reports its PID without waiting for it. */
+static void run_background (uint8_t* command)
+{
+    int32_t pid;
+    uint8_t num[NUMBUF];
+
+    if (-1 == (pid = ece391_spawn (command))) {
+        ece391_fdputs (1, (uint8_t*)"no such command\n");
+        return;
+    }
+    ece391_itoa (pid, num, 10);
+    ece391_fdputs (1, (uint8_t*)"[");
+    ece391_fdputs (1, num);
+    ece391_fdputs (1, (uint8_t*)"]\n");
+}
 
 int main ()
 {
     int32_t cnt, rval;
+    uint8_t* cmd;
+    uint8_t* arrow;
     uint8_t buf[BUFSIZE];
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
+    ece391_set_handler (INTERRUPT, ignore_interrupt);
 
     while (1) {
+        reap_jobs ();
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -24,8 +150,23 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
-	rval = ece391_execute (buf);
-	if (-1 == rval)
+	cmd = trim (buf);
+	cnt = ece391_strlen (cmd);
+	if (cnt > 0 && '&' == cmd[cnt - 1]) {
+	    cmd[cnt - 1] = '\0';
+	    run_background (trim (cmd));
+	    continue;
+	}
+	for (arrow = cmd; '\0' != *arrow && '>' != *arrow; arrow++);
+	if ('>' == *arrow) {
+	    *arrow = '\0';
+	    rval = run_redirect (trim (cmd), trim (arrow + 1));
+	} else {
+	    rval = run_command (cmd);
+	}
+	if (-2 == rval)
+	    ece391_fdputs (1, (uint8_t*)"cannot create file\n");
+	else if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
 	else if (256 == rval)
 	    ece391_fdputs (1, (uint8_t*)"program terminated by exception\n");
@@ -0,0 +1,105 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BENCH_KEY 391
+#define BENCH_BYTES 16384
+#define LINE_LEN 80
+#define NUMBUF 16
+
+/* What the producer and the consumer share. */
+struct bench_shm {
+    uint32_t consumer_cycles;
+    uint32_t checksum;
+    uint8_t data[BENCH_BYTES];
+};
+
+/* Low 32 bits of the time stamp counter, plenty for one run. */
+static uint32_t rdtsc_low (void)
+{
+    uint32_t lo, hi;
+
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+static void report (const char* label, uint32_t cycles)
+{
+    uint8_t num[NUMBUF];
+
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_itoa (cycles / (BENCH_BYTES / 1024), num, 10);
+    ece391_fdputs (1, num);
+    ece391_fdputs (1, (uint8_t*)" cycles per KB\n");
+}
+
+/*
+ * Runs as "shmbench consume": attaches the producer's segment at another
+ * address and reads every byte of it in place.
+ */
+static int32_t consume (void)
+{
+    struct bench_shm* shm;
+    uint32_t start, sum, i;
+    int32_t id;
+
+    id = ece391_shm_create (BENCH_KEY, sizeof (struct bench_shm));
+    shm = (struct bench_shm*)ece391_shm_attach
+        (id, (void*)(ECE391_SHM_BASE + ECE391_SHM_MAX_SIZE));
+    if (-1 == id || (struct bench_shm*)-1 == shm)
+        return 1;
+
+    start = rdtsc_low ();
+    for (sum = 0, i = 0; i < BENCH_BYTES; i++)
+        sum += shm->data[i];
+    shm->consumer_cycles = rdtsc_low () - start;
+    shm->checksum = sum;
+    return 0;
+}
+
+/*
+ * Moves BENCH_BYTES from this program to a child through a shared segment,
+ * then writes the same amount to the terminal, and prints the cost of each.
+ */
+int main ()
+{
+    struct bench_shm* shm;
+    uint8_t args[LINE_LEN];
+    uint8_t line[LINE_LEN];
+    uint32_t start, shm_cycles, term_cycles, sum, i;
+    int32_t id;
+
+    if (0 == ece391_getargs (args, LINE_LEN) &&
+        0 == ece391_strcmp (args, (uint8_t*)"consume"))
+        return consume ();
+
+    id = ece391_shm_create (BENCH_KEY, sizeof (struct bench_shm));
+    shm = (struct bench_shm*)ece391_shm_attach (id, (void*)ECE391_SHM_BASE);
+    if (-1 == id || (struct bench_shm*)-1 == shm) {
+        ece391_fdputs (1, (uint8_t*)"could not attach shared memory\n");
+        return 2;
+    }
+
+    start = rdtsc_low ();
+    for (sum = 0, i = 0; i < BENCH_BYTES; i++)
+        sum += (shm->data[i] = 'a' + i % 26);
+    shm_cycles = rdtsc_low () - start;
+    if (0 != ece391_execute ((uint8_t*)"shmbench consume") || shm->checksum != sum) {
+        ece391_fdputs (1, (uint8_t*)"consumer saw the wrong data\n");
+        return 3;
+    }
+    shm_cycles += shm->consumer_cycles;
+
+    for (i = 0; i < LINE_LEN - 1; i++)
+        line[i] = '.';
+    line[LINE_LEN - 1] = '\n';
+    start = rdtsc_low ();
+    for (i = 0; i < BENCH_BYTES; i += LINE_LEN)
+        ece391_write (1, line, LINE_LEN);
+    term_cycles = rdtsc_low () - start;
+
+    report ("shared memory: ", shm_cycles);
+    report ("terminal:      ", term_cycles);
+    return 0;
+}
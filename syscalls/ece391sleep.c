@@ -0,0 +1,49 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 32
+#define NUMBUF 16
+
+/*
+ * sleep <ms>: sleeps for the given number of milliseconds and reports how
+ * long the sleep took by the monotonic clock, in microseconds.
+ */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint8_t num[NUMBUF];
+    uint32_t ms = 0, us;
+    int32_t i;
+    struct ece391_timespec req, start, end;
+
+    if (0 != ece391_getargs (buf, BUFSIZE)) {
+        ece391_fdputs (1, (uint8_t*)"usage: sleep <milliseconds>\n");
+        return 3;
+    }
+    for (i = 0; '\0' != buf[i]; i++) {
+        if (buf[i] < '0' || buf[i] > '9') {
+            ece391_fdputs (1, (uint8_t*)"usage: sleep <milliseconds>\n");
+            return 3;
+        }
+        ms = ms * 10 + (buf[i] - '0');
+    }
+
+    req.tv_sec = ms / 1000;
+    req.tv_nsec = (ms % 1000) * 1000000;
+    ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, &start);
+    if (0 != ece391_nanosleep (&req, 0)) {
+        ece391_fdputs (1, (uint8_t*)"sleep interrupted\n");
+        return 1;
+    }
+    ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, &end);
+
+    us = (end.tv_sec - start.tv_sec) * 1000000
+       + (end.tv_nsec - start.tv_nsec) / 1000;
+    ece391_itoa (us, num, 10);
+    ece391_fdputs (1, (uint8_t*)"slept ");
+    ece391_fdputs (1, num);
+    ece391_fdputs (1, (uint8_t*)" us\n");
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ITERATIONS 10000
+#define NUMBUF 16
+
+/* Low 32 bits of the time stamp counter, plenty for one timing run. */
+static uint32_t rdtsc_low (void)
+{
+    uint32_t lo, hi;
+
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+/*
+ * Times ITERATIONS calls that fail at once in the kernel, so the count is
+ * dominated by the cost of entering and leaving it.
+ */
+static uint32_t time_null_calls (void)
+{
+    uint32_t start, i;
+
+    start = rdtsc_low ();
+    for (i = 0; i < ITERATIONS; i++)
+        ece391_fcntl (-1, 0, 0);
+    return (rdtsc_low () - start) / ITERATIONS;
+}
+
+static void report (const char* label, uint32_t cycles)
+{
+    uint8_t num[NUMBUF];
+
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_itoa (cycles, num, 10);
+    ece391_fdputs (1, num);
+    ece391_fdputs (1, (uint8_t*)" cycles per call\n");
+}
+
+int main ()
+{
+    int32_t has_sysenter = ece391_use_sysenter;
+
+    ece391_use_sysenter = 0;
+    report ("int $0x80: ", time_null_calls ());
+
+    if (has_sysenter) {
+        ece391_use_sysenter = 1;
+        report ("sysenter:  ", time_null_calls ());
+    } else {
+        ece391_fdputs (1, (uint8_t*)"sysenter:  not supported\n");
+    }
+
+    return 0;
+}
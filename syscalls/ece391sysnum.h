@@ -11,5 +11,24 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_POLL    11
+#define SYS_FCNTL   12
+#define SYS_IOCTL   13
+#define SYS_SUBMIT  14
+#define SYS_PIPE    15
+#define SYS_DUP2    16
+#define SYS_SHM_CREATE  17
+#define SYS_SHM_ATTACH  18
+#define SYS_SPAWN   19
+#define SYS_WAITPID 20
+#define SYS_NANOSLEEP   21
+#define SYS_CLOCK_GETTIME   22
+#define SYS_SETITIMER   23
+#define SYS_CREATE  24
+#define SYS_TRUNCATE    25
+#define SYS_BCACHE_STATS    26
+#define SYS_GETDENTS    27
+#define SYS_STAT    28
+#define SYS_FSTAT    29
 
 #endif /* ECE391SYSNUM_H */
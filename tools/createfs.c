@@ -0,0 +1,318 @@
+/* createfs.c - Builds a 391 filesystem image from a directory.
+ *
+ * The root directory holds a "." entry, an "rtc" entry and one entry per
+ * regular file or subdirectory of the input directory, sorted by name.
+ * A subdirectory is a file of dentries, one per entry it holds. Names
+ * longer than 32 characters are cut short, as the kernel does. Each
+ * file's data blocks are laid out one after the other.
+ *
+ * With -x the image uses the extent format: inodes are packed 32 to a
+ * block and each file is one extent, so reading a file is a single run
+ * of blocks and the kernel can copy it in one go. Such an image is
+ * mounted read only.
+ *
+ * With -z, which implies -x, each file is also compressed a block at a
+ * time with LZ4, and kept compressed if that makes it shorter. Its data
+ * starts with where each block's compressed data ends, then the blocks;
+ * a block that does not shrink is kept as it is.
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fsimg.h"
+#include "lz4enc.h"
+
+#define DEFAULT_INODES  64
+#define MAX_NODES       4096
+#define MAX_DEPTH       16
+
+/* A file or directory below the input directory. The entries of a
+ * directory are next to each other in nodes[]. */
+typedef struct node_t {
+    char name[FS_FILE_NAME_LEN + 1];
+    char path[4096];
+    int is_dir;
+    uint32_t length;
+    uint8_t* stored;            /* compressed data, NULL if not compressed */
+    uint32_t stored_length;     /* bytes of data blocks */
+    uint32_t start;             /* first data block */
+    int first_child;
+    int num_children;
+} node_t;
+
+/* nodes[0] is the root, node i has inode i */
+static node_t nodes[MAX_NODES];
+static int num_nodes = 1;
+
+static void
+usage (const char* prog)
+{
+    fprintf (stderr, "usage: %s -i <input directory> -o <output image> "
+             "[-n <inodes>] [-x] [-z]\n"
+             "  -n  number of inodes, default %d or as many as needed\n"
+             "  -x  extent format with every file contiguous\n"
+             "  -z  extent format with files compressed\n",
+             prog, DEFAULT_INODES);
+    exit (2);
+}
+
+static int
+by_name (const void* a, const void* b)
+{
+    return strcmp (((const node_t*)a)->name, ((const node_t*)b)->name);
+}
+
+/* Adds the regular files and subdirectories of a directory, then theirs. */
+static void
+read_dir (int parent, int depth)
+{
+    DIR* d;
+    struct dirent* ent;
+    struct stat st;
+    char path[sizeof (nodes[0].path)];
+    node_t* n;
+    int i;
+
+    if (NULL == (d = opendir (nodes[parent].path))) {
+        perror (nodes[parent].path);
+        exit (1);
+    }
+    nodes[parent].first_child = num_nodes;
+    while (NULL != (ent = readdir (d))) {
+        if ('.' == ent->d_name[0])
+            continue;
+        if (MAX_NODES == num_nodes) {
+            fprintf (stderr, "more than %d files\n", MAX_NODES - 1);
+            exit (1);
+        }
+        n = &nodes[num_nodes];
+        strcpy (path, nodes[parent].path);
+        strcat (path, "/");
+        strncat (path, ent->d_name, sizeof (path) - strlen (path) - 1);
+        strcpy (n->path, path);
+        if (0 != stat (n->path, &st)) {
+            perror (n->path);
+            exit (1);
+        }
+        if (S_ISDIR (st.st_mode) && depth < MAX_DEPTH) {
+            n->is_dir = 1;
+        } else if (S_ISREG (st.st_mode)) {
+            n->is_dir = 0;
+            n->length = st.st_size;
+        } else {
+            fprintf (stderr, "%s: skipped\n", n->path);
+            continue;
+        }
+        snprintf (n->name, sizeof (n->name), "%.*s", FS_FILE_NAME_LEN,
+                  ent->d_name);
+        num_nodes++;
+    }
+    closedir (d);
+    nodes[parent].num_children = num_nodes - nodes[parent].first_child;
+    qsort (&nodes[nodes[parent].first_child], nodes[parent].num_children,
+           sizeof (node_t), by_name);
+    if (0 == parent && nodes[0].num_children > MAX_NUM_DENTRIES - 2) {
+        fprintf (stderr, "%s: more than %d entries\n", nodes[0].path,
+                 MAX_NUM_DENTRIES - 2);
+        exit (1);
+    }
+
+    for (i = 0; i < nodes[parent].num_children; i++) {
+        n = &nodes[nodes[parent].first_child + i];
+        if (n->is_dir) {
+            read_dir (n - nodes, depth + 1);
+            n->length = n->num_children * sizeof (dentry_t);
+        }
+    }
+}
+
+static uint32_t
+node_blocks (const node_t* n)
+{
+    return (n->stored_length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+}
+
+/* Reads a file into a new buffer. */
+static uint8_t*
+read_file (const node_t* n)
+{
+    uint8_t* data = malloc (n->length + 1);
+    FILE* fp;
+
+    if (NULL == data || NULL == (fp = fopen (n->path, "rb")) ||
+        n->length != fread (data, 1, n->length, fp) || 0 != fclose (fp)) {
+        perror (n->path);
+        exit (1);
+    }
+    return data;
+}
+
+/* Compresses a file, keeping the result only if it is shorter. */
+static void
+compress_file (node_t* n)
+{
+    uint32_t blocks = (n->length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+    uint32_t b, size, out, len;
+    uint8_t* data = read_file (n);
+    uint8_t* stored = malloc (blocks * (sizeof (uint32_t) + FS_BLOCK_SIZE));
+    uint32_t* ends = (uint32_t*)stored;
+
+    if (NULL == stored) {
+        perror ("createfs");
+        exit (1);
+    }
+    out = blocks * sizeof (uint32_t);
+    for (b = 0; b < blocks; b++) {
+        size = n->length - b * FS_BLOCK_SIZE;
+        if (size > FS_BLOCK_SIZE)
+            size = FS_BLOCK_SIZE;
+        len = lz4_compress (data + b * FS_BLOCK_SIZE, size, stored + out,
+                            size - 1);
+        if (0 == len) {
+            memcpy (stored + out, data + b * FS_BLOCK_SIZE, size);
+            len = size;
+        }
+        out += len;
+        ends[b] = out;
+    }
+    free (data);
+    if (out >= n->length) {
+        free (stored);
+        return;
+    }
+    n->stored = stored;
+    n->stored_length = out;
+}
+
+/* Fills in the dentry of node i. */
+static void
+fill_dentry (dentry_t* dentry, int i)
+{
+    memcpy (dentry->file_name, nodes[i].name, FS_FILE_NAME_LEN);
+    dentry->file_type = nodes[i].is_dir ? FS_TYPE_DIR : FS_TYPE_FILE;
+    dentry->inode_index = i;
+}
+
+int
+main (int argc, char* argv[])
+{
+    const char* out = NULL;
+    uint32_t num_inodes = DEFAULT_INODES;
+    int extents = 0, compress = 0;
+    uint32_t raw_blocks = 0;
+    int opt, i, j;
+    uint32_t b, inode_blocks, data_blocks = 0;
+    uint8_t* image;
+    size_t size;
+    boot_block_t* boot;
+    dentry_t* dentry;
+    FILE* fp;
+
+    while (-1 != (opt = getopt (argc, argv, "i:o:n:xz"))) {
+        switch (opt) {
+            case 'i': snprintf (nodes[0].path, sizeof (nodes[0].path), "%s", optarg); break;
+            case 'o': out = optarg; break;
+            case 'n': num_inodes = strtoul (optarg, NULL, 0); break;
+            case 'x': extents = 1; break;
+            case 'z': extents = compress = 1; break;
+            default: usage (argv[0]);
+        }
+    }
+    if ('\0' == nodes[0].path[0] || NULL == out || optind != argc)
+        usage (argv[0]);
+
+    read_dir (0, 0);
+    /* inode 0 is the root directory's */
+    if (num_inodes < (uint32_t)num_nodes)
+        num_inodes = num_nodes;
+    for (i = 1; i < num_nodes; i++) {
+        nodes[i].stored_length = nodes[i].length;
+        raw_blocks += node_blocks (&nodes[i]);
+        if (compress && !nodes[i].is_dir && 0 != nodes[i].length)
+            compress_file (&nodes[i]);
+        if (!extents && node_blocks (&nodes[i]) > MAX_FILE_BLOCKS) {
+            fprintf (stderr, "%s: too large for an inode\n", nodes[i].path);
+            return 1;
+        }
+        nodes[i].start = data_blocks;
+        data_blocks += node_blocks (&nodes[i]);
+    }
+
+    image = calloc (1, FS_BLOCK_SIZE);
+    boot = (boot_block_t*)image;
+    boot->num_inodes = num_inodes;
+    boot->num_data_blocks = data_blocks;
+    boot->format = extents ? FS_FORMAT_EXTENTS : FS_FORMAT_INDEXED;
+    inode_blocks = fsimg_inode_blocks (boot);
+    size = (size_t)(1 + inode_blocks + data_blocks) * FS_BLOCK_SIZE;
+    if (NULL == (image = realloc (image, size))) {
+        perror ("createfs");
+        return 1;
+    }
+    memset (image + FS_BLOCK_SIZE, 0, size - FS_BLOCK_SIZE);
+    boot = (boot_block_t*)image;
+    dentry = (dentry_t*)(image + FS_METADATA_SEGMENT_SIZE);
+
+    strcpy (dentry[0].file_name, ".");
+    dentry[0].file_type = FS_TYPE_DIR;
+    strcpy (dentry[1].file_name, "rtc");
+    dentry[1].file_type = FS_TYPE_RTC;
+    for (i = 0; i < nodes[0].num_children; i++)
+        fill_dentry (&dentry[2 + i], nodes[0].first_child + i);
+    boot->num_dentries = 2 + nodes[0].num_children;
+
+    for (i = 1; i < num_nodes; i++) {
+        node_t* n = &nodes[i];
+        uint8_t* data = image + (1 + inode_blocks + n->start) * FS_BLOCK_SIZE;
+
+        if (extents) {
+            extent_inode_t* node = (extent_inode_t*)(image + FS_BLOCK_SIZE) + i;
+            node->length = n->length;
+            if (NULL != n->stored) {
+                node->flags = FS_INODE_COMPRESSED;
+                node->stored_length = n->stored_length;
+            }
+            if (0 != n->length) {
+                node->num_extents = 1;
+                node->extents[0].start = n->start;
+                node->extents[0].count = node_blocks (n);
+            }
+        } else {
+            inode_block_t* node = (inode_block_t*)(image + (1 + i) * FS_BLOCK_SIZE);
+            node->length = n->length;
+            for (b = 0; b < node_blocks (n); b++)
+                node->data_index[b] = n->start + b;
+        }
+
+        if (n->is_dir) {
+            for (j = 0; j < n->num_children; j++)
+                fill_dentry ((dentry_t*)data + j, n->first_child + j);
+        } else if (NULL != n->stored) {
+            memcpy (data, n->stored, n->stored_length);
+            free (n->stored);
+        } else if (NULL == (fp = fopen (n->path, "rb")) ||
+                   n->length != fread (data, 1, n->length, fp) ||
+                   0 != fclose (fp)) {
+            perror (n->path);
+            return 1;
+        }
+    }
+
+    if (NULL == (fp = fopen (out, "wb")) || size != fwrite (image, 1, size, fp) ||
+        0 != fclose (fp)) {
+        perror (out);
+        return 1;
+    }
+    printf ("%s: %d files and directories, %u inodes in %u blocks, "
+            "%u data blocks\n", out, num_nodes - 1, num_inodes, inode_blocks,
+            data_blocks);
+    if (compress)
+        printf ("%s: compressed from %u data blocks\n", out, raw_blocks);
+    free (image);
+    return 0;
+}
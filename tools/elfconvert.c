@@ -0,0 +1,170 @@
+/* elfconvert.c - Converts a 32-bit x86 ELF executable to the OS's format.
+ *
+ * The OS copies a program file as it is to 0x08048000 and starts it at
+ * the entry point in its ELF header, so the converted file is the memory
+ * image of the program from that address on: each loadable segment is
+ * written at its address less 0x08048000, with its .bss as zeroes. The
+ * ELF header stays where it is, at the start of the first segment.
+ *
+ * The output is <exename>.converted. The headers are printed on stderr.
+ */
+
+#include <elf.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define IMAGE_BASE      0x08048000
+
+/* Checks that the file is an ELF executable the OS can run. */
+static int
+verify_magic (const char* name, const Elf32_Ehdr* eh)
+{
+    if (0 != strncmp ((const char*)eh->e_ident, ELFMAG, SELFMAG)) {
+        fprintf (stderr, "%s is not an ELF file.\n", name);
+        return -1;
+    }
+    if (ELFCLASS32 != eh->e_ident[EI_CLASS] ||
+        ELFDATA2LSB != eh->e_ident[EI_DATA] ||
+        EV_CURRENT != eh->e_ident[EI_VERSION] || ET_EXEC != eh->e_type ||
+        EM_386 != eh->e_machine || EV_CURRENT != eh->e_version) {
+        fprintf (stderr, "%s is not a compatible ELF file.\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+static void
+print_header (const Elf32_Ehdr* eh)
+{
+    fprintf (stderr, "e_entry    : 0x%08x\n", eh->e_entry);
+    fprintf (stderr, "e_phoff    : 0x%08x\n", eh->e_phoff);
+    fprintf (stderr, "e_shoff    : 0x%08x\n", eh->e_shoff);
+    fprintf (stderr, "e_flags    : 0x%08x\n", eh->e_flags);
+    fprintf (stderr, "e_ehsize   : 0x%08x\n", eh->e_ehsize);
+    fprintf (stderr, "e_phentsize: 0x%08x\n", eh->e_phentsize);
+    fprintf (stderr, "e_phnum    : 0x%08x\n", eh->e_phnum);
+    fprintf (stderr, "e_shentsize: 0x%08x\n", eh->e_shentsize);
+    fprintf (stderr, "e_shnum    : 0x%08x\n", eh->e_shnum);
+}
+
+static void
+print_pheader (const Elf32_Phdr* ph)
+{
+    fprintf (stderr, "p_type  : 0x%08x\n", ph->p_type);
+    fprintf (stderr, "p_offset: 0x%08x\n", ph->p_offset);
+    fprintf (stderr, "p_vaddr : 0x%08x\n", ph->p_vaddr);
+    fprintf (stderr, "p_paddr : 0x%08x\n", ph->p_paddr);
+    fprintf (stderr, "p_filesz: 0x%08x\n", ph->p_filesz);
+    fprintf (stderr, "p_memsz : 0x%08x\n", ph->p_memsz);
+    fprintf (stderr, "p_flags : 0x%08x\n", ph->p_flags);
+    fprintf (stderr, "p_align : 0x%08x\n", ph->p_align);
+}
+
+/* Copies a loadable segment from the executable to the converted file,
+ * zeroing what is past the end of its data in the file. */
+static int
+copy_segment (int in, int out, const Elf32_Phdr* ph)
+{
+    uint8_t* seg;
+
+    if (ph->p_vaddr < IMAGE_BASE || ph->p_filesz > ph->p_memsz) {
+        fprintf (stderr, "segment at 0x%08x is not in the program image\n",
+                 ph->p_vaddr);
+        return -1;
+    }
+    if (NULL == (seg = malloc (ph->p_memsz))) {
+        perror ("malloc");
+        return -1;
+    }
+    memset (seg, 0, ph->p_memsz);
+    if (ph->p_offset != lseek (in, ph->p_offset, SEEK_SET)) {
+        perror ("lseek for pheader read");
+        free (seg);
+        return -1;
+    }
+    if (ph->p_filesz != read (in, seg, ph->p_filesz)) {
+        perror ("pheader read");
+        free (seg);
+        return -1;
+    }
+    if (ph->p_vaddr - IMAGE_BASE != lseek (out, ph->p_vaddr - IMAGE_BASE,
+                                           SEEK_SET)) {
+        perror ("lseek for pheader write");
+        free (seg);
+        return -1;
+    }
+    if (ph->p_memsz != write (out, seg, ph->p_memsz)) {
+        perror ("pheader write");
+        free (seg);
+        return -1;
+    }
+    free (seg);
+    return 0;
+}
+
+int
+main (int argc, char* argv[])
+{
+    Elf32_Ehdr eh;
+    Elf32_Phdr ph;
+    char* out_name;
+    int in, out, i, loaded = 0;
+
+    if (2 != argc) {
+        fprintf (stderr, "Usage: elfconvert <exename>\n");
+        return 2;
+    }
+    if (-1 == (in = open (argv[1], O_RDONLY))) {
+        perror (argv[1]);
+        return 1;
+    }
+    if (sizeof (eh) != read (in, &eh, sizeof (eh))) {
+        perror ("Reading elf header");
+        return 1;
+    }
+    if (0 != verify_magic (argv[1], &eh))
+        return 1;
+    print_header (&eh);
+
+    /* unlike the prebuilt elfconvert, this truncates the output, so an old
+       converted file does not leave its end past a shorter program's */
+    if (NULL == (out_name = malloc (strlen (argv[1]) + sizeof (".converted")))) {
+        perror ("malloc");
+        return 1;
+    }
+    strcpy (out_name, argv[1]);
+    strcat (out_name, ".converted");
+    if (-1 == (out = open (out_name, O_RDWR | O_CREAT | O_TRUNC, 0644))) {
+        perror (out_name);
+        return 1;
+    }
+
+    for (i = 0; i < eh.e_phnum; i++) {
+        if (eh.e_phoff + i * eh.e_phentsize !=
+            lseek (in, eh.e_phoff + i * eh.e_phentsize, SEEK_SET)) {
+            perror ("lseek to program header");
+            return 1;
+        }
+        if (sizeof (ph) != read (in, &ph, sizeof (ph))) {
+            perror ("read program header");
+            fprintf (stderr, "Error reading header %d, skipping...\n", i);
+            continue;
+        }
+        print_pheader (&ph);
+        if (PT_LOAD != ph.p_type)
+            continue;
+        if (0 != copy_segment (in, out, &ph))
+            return 1;
+        loaded++;
+    }
+    if (0 == loaded) {
+        fprintf (stderr, "No loadable segments found...\n");
+        return 1;
+    }
+    close (out);
+    close (in);
+    return 0;
+}
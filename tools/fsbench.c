@@ -0,0 +1,231 @@
+/* fsbench.c - Times the kernel's filesystem code on an image.
+ *
+ * Builds student-distrib/fs.c, with its block and dentry caches, for
+ * Linux (see host/) and mounts an image with it, as a module in memory
+ * the way the OS gets it from GRUB, or with -d as a disk read through the
+ * block cache. Then times looking up every path with the dentry cache
+ * empty and with it full, reading every directory entry, reading the first
+ * bytes of every file the way execute checks for an executable, and
+ * reading every file whole.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fs.h"
+#include "bcache.h"
+#include "dcache.h"
+
+#define DEFAULT_ROUNDS  1000
+#define MAX_PATH        4096
+#define HEADER_BYTES    40
+
+typedef struct file_t {
+    char path[MAX_PATH];
+    dentry_t dentry;
+    uint32_t length;
+} file_t;
+
+static file_t* files;
+static uint32_t num_files;
+
+static double
+now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Adds what a directory holds to files[], and what its subdirectories do. */
+static void
+add_dir (const char* path, uint32_t dir)
+{
+    dentry_t dentry;
+    file_t* f;
+    uint32_t i;
+
+    for (i = 0; 0 == read_dentry_in_dir (dir, i, &dentry); i++) {
+        if ('\0' == dentry.file_name[0] ||
+            (FS_ROOT_INODE == dir && 0 == i))
+            continue;
+        if (NULL == (files = realloc (files, (num_files + 1) * sizeof (file_t)))) {
+            perror ("fsbench");
+            exit (1);
+        }
+        f = &files[num_files++];
+        snprintf (f->path, sizeof (f->path), "%s/%.*s", path,
+                  FS_FILE_NAME_LEN, dentry.file_name);
+        f->dentry = dentry;
+        f->length = FS_TYPE_RTC == dentry.file_type ? 0 :
+                    inode_length (dentry.inode_index);
+        if (FS_TYPE_DIR == dentry.file_type)
+            add_dir (f->path, dentry.inode_index);
+    }
+}
+
+/* Reads an image into memory the kernel's 32-bit addresses can reach. */
+static uint8_t*
+load_image (const char* name, uint32_t* size)
+{
+    uint8_t* image;
+    long len;
+    FILE* fp;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_32BIT
+    flags |= MAP_32BIT;
+#endif
+    if (NULL == (fp = fopen (name, "rb")) || 0 != fseek (fp, 0, SEEK_END) ||
+        0 > (len = ftell (fp)) || 0 != fseek (fp, 0, SEEK_SET)) {
+        perror (name);
+        exit (1);
+    }
+    /* whole sectors, for the disk */
+    *size = (len + ATA_SECTOR_SIZE - 1) / ATA_SECTOR_SIZE * ATA_SECTOR_SIZE;
+    image = mmap (NULL, *size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (MAP_FAILED == image || (uintptr_t)image + *size > 0xFFFFFFFFU) {
+        fprintf (stderr, "%s: no memory below 4GB for the image\n", name);
+        exit (1);
+    }
+    if ((size_t)len != fread (image, 1, len, fp)) {
+        perror (name);
+        exit (1);
+    }
+    fclose (fp);
+    return image;
+}
+
+static void
+usage (const char* prog)
+{
+    fprintf (stderr, "usage: %s [-d] [-r <rounds>] <image>\n"
+             "  -d  mount the image as a disk rather than as a module\n",
+             prog);
+    exit (2);
+}
+
+int
+main (int argc, char* argv[])
+{
+    uint8_t* buf;
+    bcache_stats_t stats;
+    dentry_t dentry;
+    uint8_t* image;
+    uint64_t bytes = 0;
+    uint64_t dir_reads = 0;
+    uint32_t size, i, f, r, rounds = DEFAULT_ROUNDS, num_regular = 0;
+    uint32_t longest = HEADER_BYTES;
+    double t, t_cold, t_warm, t_dir, t_head, t_read;
+    int opt, disk = 0;
+
+    while (-1 != (opt = getopt (argc, argv, "dr:"))) {
+        switch (opt) {
+            case 'd': disk = 1; break;
+            case 'r': rounds = strtoul (optarg, NULL, 0); break;
+            default: usage (argv[0]);
+        }
+    }
+    if (optind != argc - 1 || 0 == rounds)
+        usage (argv[0]);
+
+    image = load_image (argv[optind], &size);
+    init_bcache ();
+    if (disk) {
+        host_disk = image;
+        host_disk_sectors = size / ATA_SECTOR_SIZE;
+    }
+    init_fs ((uint32_t)(uintptr_t)image);
+    /* the module is mounted instead when the disk does not hold a
+       filesystem; run fsck on images the kernel might not read */
+    if (disk && NULL != data_blocks) {
+        fprintf (stderr, "%s: not a filesystem image\n", argv[optind]);
+        return 1;
+    }
+    add_dir ("", FS_ROOT_INODE);
+    for (i = 0; i < num_files; i++) {
+        if (FS_TYPE_FILE == files[i].dentry.file_type)
+            num_regular++;
+        if (FS_TYPE_RTC != files[i].dentry.file_type)
+            bytes += files[i].length;
+        if (files[i].length > longest)
+            longest = files[i].length;
+    }
+    if (NULL == (buf = malloc (longest))) {
+        perror ("fsbench");
+        return 1;
+    }
+    if (0 == num_regular) {
+        fprintf (stderr, "%s: no files to read\n", argv[optind]);
+        return 1;
+    }
+
+    /* every lookup walks the path from the root when the cache is empty */
+    t_cold = 0;
+    for (r = 0; r < rounds; r++) {
+        init_dcache ();
+        t = now ();
+        for (i = 0; i < num_files; i++)
+            read_dentry_by_name ((uint8_t*)files[i].path, &dentry);
+        t_cold += now () - t;
+    }
+    t = now ();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < num_files; i++)
+            read_dentry_by_name ((uint8_t*)files[i].path, &dentry);
+    }
+    t_warm = now () - t;
+
+    /* each directory is read an entry at a time, as getdents does */
+    t = now ();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; 0 == read_dentry_in_dir (FS_ROOT_INODE, i, &dentry); i++);
+        dir_reads += i + 1;
+        for (f = 0; f < num_files; f++) {
+            if (FS_TYPE_DIR != files[f].dentry.file_type)
+                continue;
+            for (i = 0; 0 == read_dentry_in_dir (files[f].dentry.inode_index,
+                                                 i, &dentry); i++);
+            dir_reads += i + 1;
+        }
+    }
+    t_dir = now () - t;
+
+    t = now ();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < num_files; i++) {
+            if (FS_TYPE_FILE == files[i].dentry.file_type)
+                read_data (files[i].dentry.inode_index, 0, buf, HEADER_BYTES);
+        }
+    }
+    t_head = now () - t;
+
+    t = now ();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < num_files; i++) {
+            if (FS_TYPE_RTC != files[i].dentry.file_type)
+                read_data (files[i].dentry.inode_index, 0, buf,
+                           files[i].length);
+        }
+    }
+    t_read = now () - t;
+
+    printf ("%s, %s: %u entries, %llu bytes of files, %u rounds\n",
+            argv[optind], disk ? "disk" : "module", num_files,
+            (unsigned long long)bytes, rounds);
+    printf ("lookup, uncached: %8.1f ns\n", t_cold * 1e9 / rounds / num_files);
+    printf ("lookup, cached:   %8.1f ns\n", t_warm * 1e9 / rounds / num_files);
+    printf ("directory entry:  %8.1f ns\n", t_dir * 1e9 / dir_reads);
+    printf ("file header:      %8.1f ns\n", t_head * 1e9 / rounds / num_regular);
+    printf ("whole files:      %8.1f MB/s\n", rounds * bytes / t_read / 1e6);
+    if (disk) {
+        bcache_read_stats (&stats);
+        printf ("disk: %u requests, block cache %u hits, %u misses\n",
+                host_disk_requests, stats.hits, stats.misses);
+    }
+    return 0;
+}
@@ -0,0 +1,416 @@
+/* fsck.c - Checks a 391 filesystem image.
+ *
+ * Walks the directory tree from the root and checks every entry: its
+ * type, that its inode is in the image and used only once, and that the
+ * data blocks of the file are in the image and used by no other file.
+ * Compressed files are decompressed block by block. Then reports how
+ * fragmented the files are: a fragment is a run of data blocks that
+ * follow each other, so a file laid out in one piece has one.
+ *
+ * Exits with 0 if the image is good, 1 if anything is wrong with it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fsimg.h"
+#include "lz4enc.h"
+
+#define MAX_DEPTH       16
+#define WORST_FILES     5
+#define MAX_PATH        4096
+
+static uint8_t* image;
+static uint32_t image_blocks;
+static boot_block_t* boot;
+static uint32_t inode_blocks;
+/* Data blocks files may use. The kernel gives files it writes the blocks
+ * of the disk past the image's own, so in the indexed format that is all
+ * of them. */
+static uint32_t data_limit;
+
+static int errors;
+static int verbose;
+
+/* The inode that uses each data block, + 1, 0 if none. */
+static uint32_t* block_owner;
+/* Whether each inode was found in a directory. */
+static uint8_t* inode_seen;
+
+/* Totals for the fragmentation report. */
+static uint32_t num_files, num_dirs, non_empty, used_blocks, fragmented,
+                fragments;
+static struct {
+    char path[MAX_PATH];
+    uint32_t fragments;
+} worst[WORST_FILES];
+
+static void
+error (const char* path, const char* fmt, uint32_t a, uint32_t b)
+{
+    printf ("%s: ", path);
+    printf (fmt, a, b);
+    printf ("\n");
+    errors++;
+}
+
+static uint8_t*
+data_block (uint32_t d)
+{
+    return image + (1 + inode_blocks + d) * FS_BLOCK_SIZE;
+}
+
+/* Remembers one of the most fragmented files. */
+static void
+note_fragments (const char* path, uint32_t n)
+{
+    int i, j;
+
+    for (i = 0; i < WORST_FILES && worst[i].fragments >= n; i++);
+    if (i == WORST_FILES)
+        return;
+    for (j = WORST_FILES - 1; j > i; j--)
+        worst[j] = worst[j - 1];
+    snprintf (worst[i].path, sizeof (worst[i].path), "%s", path);
+    worst[i].fragments = n;
+}
+
+/* Checks the data blocks of a file and claims them for it. Fills in
+ * blocks[] with the data block of each block of the file, so the caller
+ * can read it; returns the number of blocks, or -1 if they are bad. */
+static int32_t
+check_blocks (const char* path, uint32_t inode, uint32_t stored,
+              uint32_t* blocks)
+{
+    uint32_t n = (stored + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+    uint32_t i, j, b, frags = 0;
+    int bad = 0;
+
+    if (FS_FORMAT_EXTENTS == boot->format) {
+        extent_inode_t* node = (extent_inode_t*)(image + FS_BLOCK_SIZE) + inode;
+
+        if (node->num_extents > FS_INODE_EXTENTS) {
+            error (path, "%u extents, at most %u", node->num_extents,
+                   FS_INODE_EXTENTS);
+            return -1;
+        }
+        for (i = 0, b = 0; i < node->num_extents && b < n; i++) {
+            if (node->extents[i].start >= data_limit ||
+                node->extents[i].count > data_limit - node->extents[i].start) {
+                error (path, "extent at block %u of %u blocks is past the end",
+                       node->extents[i].start, node->extents[i].count);
+                return -1;
+            }
+            for (j = 0; j < node->extents[i].count && b < n; j++)
+                blocks[b++] = node->extents[i].start + j;
+        }
+        if (b < n) {
+            error (path, "extents cover %u of %u blocks", b, n);
+            return -1;
+        }
+    } else {
+        inode_block_t* node = (inode_block_t*)(image + (1 + inode) * FS_BLOCK_SIZE);
+
+        if (n > MAX_FILE_BLOCKS) {
+            error (path, "%u blocks, at most %u", n, MAX_FILE_BLOCKS);
+            return -1;
+        }
+        for (i = 0; i < n; i++) {
+            blocks[i] = node->data_index[i];
+            if (blocks[i] >= data_limit) {
+                error (path, "block %u is data block %u, past the end", i,
+                       blocks[i]);
+                bad = 1;
+            }
+        }
+        if (bad)
+            return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (0 != block_owner[blocks[i]] && inode + 1 != block_owner[blocks[i]]) {
+            error (path, "data block %u is also used by inode %u", blocks[i],
+                   block_owner[blocks[i]] - 1);
+            bad = 1;
+        }
+        block_owner[blocks[i]] = inode + 1;
+        if (0 == i || blocks[i] != blocks[i - 1] + 1)
+            frags++;
+    }
+    used_blocks += n;
+    if (n > 0)
+        non_empty++;
+    fragments += frags;
+    if (frags > 1) {
+        fragmented++;
+        note_fragments (path, frags);
+    }
+    if (verbose)
+        printf ("%-40s inode %4u %8u bytes %4u blocks %3u fragments\n", path,
+                inode, stored, n, frags);
+    return bad ? -1 : (int32_t)n;
+}
+
+/* Copies bytes of a file's data, as stored, out of its blocks. */
+static void
+read_stored (const uint32_t* blocks, uint32_t offset, uint8_t* buf,
+             uint32_t len)
+{
+    uint32_t chunk;
+
+    while (len > 0) {
+        chunk = FS_BLOCK_SIZE - offset % FS_BLOCK_SIZE;
+        if (chunk > len)
+            chunk = len;
+        memcpy (buf, data_block (blocks[offset / FS_BLOCK_SIZE]) +
+                offset % FS_BLOCK_SIZE, chunk);
+        buf += chunk;
+        offset += chunk;
+        len -= chunk;
+    }
+}
+
+/* Checks that every block of a compressed file decompresses to its size. */
+static void
+check_compressed (const char* path, const extent_inode_t* node,
+                  const uint32_t* blocks)
+{
+    uint32_t n = (node->length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+    uint32_t i, start, end, size;
+    uint8_t in[FS_BLOCK_SIZE], out[FS_BLOCK_SIZE];
+
+    if (n * sizeof (uint32_t) > node->stored_length) {
+        error (path, "compressed data of %u bytes is shorter than its %u "
+               "block ends", node->stored_length, n);
+        return;
+    }
+    start = n * sizeof (uint32_t);
+    for (i = 0; i < n; i++, start = end) {
+        read_stored (blocks, i * sizeof (uint32_t), (uint8_t*)&end,
+                     sizeof (end));
+        size = (i == n - 1 && 0 != node->length % FS_BLOCK_SIZE) ?
+               node->length % FS_BLOCK_SIZE : FS_BLOCK_SIZE;
+        if (end < start || end > node->stored_length || end - start > size) {
+            error (path, "compressed block %u ends at %u", i, end);
+            return;
+        }
+        if (end - start == size)
+            continue;
+        read_stored (blocks, start, in, end - start);
+        if ((int32_t)size != lz4_decompress (in, end - start, out, size)) {
+            error (path, "compressed block %u does not decompress", i, 0);
+            return;
+        }
+    }
+}
+
+static uint32_t check_dir (const char* path, uint32_t inode,
+                           const dentry_t* ents, uint32_t n, int depth);
+
+/* Checks one directory entry, and what it names. */
+static void
+check_entry (const char* dir, const dentry_t* ent, int depth)
+{
+    char path[MAX_PATH];
+    uint32_t blocks[MAX_FILE_BLOCKS + 1];
+    uint32_t length, stored, n;
+    extent_inode_t* ext = NULL;
+    dentry_t* ents;
+    int32_t num;
+
+    snprintf (path, sizeof (path), "%s/%.*s", dir, FS_FILE_NAME_LEN,
+              ent->file_name);
+    if (FS_TYPE_RTC == ent->file_type)
+        return;
+    if (FS_TYPE_DIR != ent->file_type && FS_TYPE_FILE != ent->file_type) {
+        error (path, "type %u", ent->file_type, 0);
+        return;
+    }
+    if (ent->inode_index >= boot->num_inodes || 0 == ent->inode_index) {
+        error (path, "inode %u, the image has %u", ent->inode_index,
+               boot->num_inodes);
+        return;
+    }
+    if (inode_seen[ent->inode_index]) {
+        error (path, "inode %u is in another directory entry too",
+               ent->inode_index, 0);
+        return;
+    }
+    inode_seen[ent->inode_index] = 1;
+
+    if (FS_FORMAT_EXTENTS == boot->format) {
+        ext = (extent_inode_t*)(image + FS_BLOCK_SIZE) + ent->inode_index;
+        length = ext->length;
+        stored = (ext->flags & FS_INODE_COMPRESSED) ? ext->stored_length : length;
+        if (0 != (ext->flags & ~FS_INODE_COMPRESSED))
+            error (path, "inode flags %#x", ext->flags, 0);
+    } else {
+        length = ((inode_block_t*)(image + (1 + ent->inode_index) *
+                                   FS_BLOCK_SIZE))->length;
+        stored = length;
+    }
+    if ((uint64_t)stored > (uint64_t)MAX_FILE_BLOCKS * FS_BLOCK_SIZE &&
+        FS_FORMAT_EXTENTS != boot->format) {
+        error (path, "%u bytes long", length, 0);
+        return;
+    }
+    if ((uint64_t)stored > (uint64_t)data_limit * FS_BLOCK_SIZE) {
+        error (path, "%u bytes stored, more than the image holds", stored, 0);
+        return;
+    }
+    if (-1 == (num = check_blocks (path, ent->inode_index, stored, blocks)))
+        return;
+    if (NULL != ext && (ext->flags & FS_INODE_COMPRESSED))
+        check_compressed (path, ext, blocks);
+
+    if (FS_TYPE_FILE == ent->file_type) {
+        num_files++;
+        return;
+    }
+    num_dirs++;
+    if (NULL != ext && (ext->flags & FS_INODE_COMPRESSED)) {
+        error (path, "directory is compressed", 0, 0);
+        return;
+    }
+    if (0 != length % sizeof (dentry_t)) {
+        error (path, "directory of %u bytes, not a whole number of entries",
+               length, 0);
+        return;
+    }
+    if (depth == MAX_DEPTH) {
+        error (path, "more than %u directories deep", MAX_DEPTH, 0);
+        return;
+    }
+    n = length / sizeof (dentry_t);
+    if (NULL == (ents = malloc (length + 1))) {
+        perror ("fsck");
+        exit (1);
+    }
+    read_stored (blocks, 0, (uint8_t*)ents, length);
+    check_dir (path, ent->inode_index, ents, n, depth + 1);
+    free (ents);
+}
+
+/* Checks the entries of a directory, skipping free ones. Returns the
+ * number of entries in use. */
+static uint32_t
+check_dir (const char* path, uint32_t inode, const dentry_t* ents, uint32_t n,
+           int depth)
+{
+    uint32_t i, j, used = 0;
+
+    for (i = 0; i < n; i++) {
+        if ('\0' == ents[i].file_name[0])
+            continue;
+        used++;
+        for (j = 0; j < i; j++) {
+            if (0 == strncmp (ents[i].file_name, ents[j].file_name,
+                              FS_FILE_NAME_LEN))
+                error (path, "entries %u and %u have the same name", j, i);
+        }
+        if (FS_ROOT_INODE == inode && 0 == i)
+            continue;
+        check_entry (path, &ents[i], depth);
+    }
+    return used;
+}
+
+static void
+usage (const char* prog)
+{
+    fprintf (stderr, "usage: %s [-v] <image>\n"
+             "  -v  list every file and its fragments\n", prog);
+    exit (2);
+}
+
+int
+main (int argc, char* argv[])
+{
+    dentry_t* root;
+    long size;
+    FILE* fp;
+    int opt, i;
+    uint32_t unused = 0, used, inode;
+
+    while (-1 != (opt = getopt (argc, argv, "v"))) {
+        switch (opt) {
+            case 'v': verbose = 1; break;
+            default: usage (argv[0]);
+        }
+    }
+    if (optind != argc - 1)
+        usage (argv[0]);
+
+    if (NULL == (fp = fopen (argv[optind], "rb")) ||
+        0 != fseek (fp, 0, SEEK_END) || 0 > (size = ftell (fp)) ||
+        0 != fseek (fp, 0, SEEK_SET) || size < FS_BLOCK_SIZE ||
+        NULL == (image = malloc (size)) ||
+        (size_t)size != fread (image, 1, size, fp)) {
+        perror (argv[optind]);
+        return 1;
+    }
+    fclose (fp);
+    image_blocks = size / FS_BLOCK_SIZE;
+    boot = (boot_block_t*)image;
+    root = (dentry_t*)(image + FS_METADATA_SEGMENT_SIZE);
+
+    /* the boot block has to be right before anything else can be read */
+    if (boot->format > FS_FORMAT_EXTENTS) {
+        error (argv[optind], "unknown format %u", boot->format, 0);
+        return 1;
+    }
+    inode_blocks = fsimg_inode_blocks (boot);
+    if (0 == boot->num_dentries || boot->num_dentries > MAX_NUM_DENTRIES)
+        error (argv[optind], "%u directory entries, 1 to %u", boot->num_dentries,
+               MAX_NUM_DENTRIES);
+    if (0 == boot->num_inodes ||
+        (uint64_t)1 + inode_blocks + boot->num_data_blocks > image_blocks) {
+        error (argv[optind], "%u inodes and %u data blocks do not fit",
+               boot->num_inodes, boot->num_data_blocks);
+        return 1;
+    }
+    if (0 != strncmp (root->file_name, ".", FS_FILE_NAME_LEN) ||
+        FS_TYPE_DIR != root->file_type || FS_ROOT_INODE != root->inode_index)
+        error (argv[optind], "the first entry is not the root directory", 0, 0);
+    if (errors)
+        return 1;
+    data_limit = FS_FORMAT_EXTENTS == boot->format ? boot->num_data_blocks :
+                 image_blocks - 1 - inode_blocks;
+
+    block_owner = calloc (data_limit + 1, sizeof (uint32_t));
+    inode_seen = calloc (boot->num_inodes, 1);
+    if (NULL == block_owner || NULL == inode_seen) {
+        perror ("fsck");
+        return 1;
+    }
+    /* the kernel looks through all of the root's entries, and counts the
+       ones in use in the boot block */
+    used = check_dir ("", FS_ROOT_INODE, root, MAX_NUM_DENTRIES, 0);
+    if (used != boot->num_dentries)
+        error (argv[optind], "%u directory entries in use, the boot block "
+               "says %u", used, boot->num_dentries);
+
+    /* an inode no entry names may be left over, which is not an error */
+    for (inode = 1; inode < boot->num_inodes; inode++) {
+        if (!inode_seen[inode])
+            unused++;
+    }
+
+    printf ("%s: %s format, %u files, %u directories, %u of %u inodes "
+            "unused\n", argv[optind],
+            FS_FORMAT_EXTENTS == boot->format ? "extent" : "indexed",
+            num_files, num_dirs, unused, boot->num_inodes - 1);
+    printf ("%s: %u of %u data blocks used\n", argv[optind], used_blocks,
+            data_limit);
+    if (non_empty > 0)
+        printf ("%s: %u of %u files fragmented (%.1f%%), %.2f fragments per "
+                "file\n", argv[optind], fragmented, non_empty,
+                100.0 * fragmented / non_empty, (double)fragments / non_empty);
+    for (i = 0; i < WORST_FILES && 0 != worst[i].fragments; i++)
+        printf ("  %-40s %u fragments\n", worst[i].path, worst[i].fragments);
+    if (errors)
+        printf ("%s: %d errors\n", argv[optind], errors);
+    return errors ? 1 : 0;
+}
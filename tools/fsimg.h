@@ -0,0 +1,70 @@
+/* fsimg.h - Layout of a 391 filesystem image, for the host tools.
+ * Matches the structures in student-distrib/fs.h.
+ */
+
+#ifndef _FSIMG_H
+#define _FSIMG_H
+
+#include <stdint.h>
+
+#define FS_BLOCK_SIZE           4096
+#define FS_METADATA_SEGMENT_SIZE 64
+#define MAX_NUM_DENTRIES        63
+#define FS_FILE_NAME_LEN        32
+#define MAX_FILE_BLOCKS         1023
+#define FS_ROOT_INODE           0
+
+#define FS_TYPE_RTC             0
+#define FS_TYPE_DIR             1
+#define FS_TYPE_FILE            2
+
+#define FS_FORMAT_INDEXED       0
+#define FS_FORMAT_EXTENTS       1
+#define FS_INODE_EXTENTS        14
+#define FS_EXTENT_INODES_PER_BLOCK 32
+#define FS_INODE_COMPRESSED     0x1
+
+typedef struct boot_block_t {
+    uint32_t num_dentries;
+    uint32_t num_inodes;
+    uint32_t num_data_blocks;
+    uint32_t format;
+    uint32_t reserved[12];
+} boot_block_t;
+
+typedef struct dentry_t {
+    char file_name[FS_FILE_NAME_LEN];
+    uint32_t file_type;
+    uint32_t inode_index;
+    uint32_t reserved[6];
+} dentry_t;
+
+typedef struct inode_block_t {
+    uint32_t length;
+    uint32_t data_index[MAX_FILE_BLOCKS];
+} inode_block_t;
+
+typedef struct fs_extent_t {
+    uint32_t start;
+    uint32_t count;
+} fs_extent_t;
+
+typedef struct extent_inode_t {
+    uint32_t length;
+    uint32_t num_extents;
+    uint32_t flags;
+    uint32_t stored_length;
+    fs_extent_t extents[FS_INODE_EXTENTS];
+} extent_inode_t;
+
+/* Blocks the inodes of an image take. */
+static inline uint32_t
+fsimg_inode_blocks (const boot_block_t* boot)
+{
+    if (boot->format == FS_FORMAT_EXTENTS)
+        return (boot->num_inodes + FS_EXTENT_INODES_PER_BLOCK - 1) /
+               FS_EXTENT_INODES_PER_BLOCK;
+    return boot->num_inodes;
+}
+
+#endif /* _FSIMG_H */
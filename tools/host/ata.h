@@ -0,0 +1,48 @@
+/* ata.h - Stand-in for the kernel's ATA driver when fs.c is built for
+ * Linux. The master drive is a disk image in memory, set up by the
+ * caller, and requests are carried out when they are waited for.
+ */
+
+#ifndef _ATA_H
+#define _ATA_H
+
+#include "types.h"
+#include "lib.h"
+#include "wait.h"
+
+#define ATA_SECTOR_SIZE     512
+#define ATA_DRIVES          2
+#define ATA_MASTER          0
+#define ATA_SLAVE           1
+
+struct ata_request_t;
+typedef void (*ata_callback_t) (struct ata_request_t* req);
+
+/* Matches the kernel's request. */
+typedef struct ata_request_t {
+    struct ata_request_t* next;
+    uint32_t drive;
+    uint32_t lba;
+    uint32_t count;
+    uint32_t done;
+    uint8_t* buf;
+    uint8_t write;
+    uint8_t dma;
+    volatile uint8_t finished;
+    int32_t status;
+    wait_queue_t wait;
+    ata_callback_t callback;
+    void* owner;
+} ata_request_t;
+
+/* The master drive's contents and size; no disk while host_disk is NULL. */
+extern uint8_t* host_disk;
+extern uint32_t host_disk_sectors;
+/* Requests carried out on it. */
+extern uint32_t host_disk_requests;
+
+uint32_t ata_sectors (uint32_t drive);
+int32_t ata_queue (ata_request_t* req);
+void ata_wait (ata_request_t* req);
+
+#endif /* _ATA_H */
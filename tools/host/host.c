@@ -0,0 +1,62 @@
+/* host.c - What the filesystem needs from the rest of the kernel, for
+ * building fs.c on Linux: the current process and the disk.
+ */
+
+#include "ata.h"
+#include "syscall.h"
+
+int current_pid;
+pcb_t host_pcb;
+
+uint8_t* host_disk;
+uint32_t host_disk_sectors;
+uint32_t host_disk_requests;
+
+static ata_request_t* queue_head;
+static ata_request_t* queue_tail;
+
+uint32_t
+ata_sectors (uint32_t drive)
+{
+    return (ATA_MASTER == drive && NULL != host_disk) ? host_disk_sectors : 0;
+}
+
+int32_t
+ata_queue (ata_request_t* req)
+{
+    if (0 == req->count || req->lba >= ata_sectors (req->drive) ||
+        req->count > ata_sectors (req->drive) - req->lba)
+        return -1;
+    req->next = NULL;
+    req->finished = 0;
+    req->status = -1;
+    if (NULL != queue_tail)
+        queue_tail->next = req;
+    else
+        queue_head = req;
+    queue_tail = req;
+    return 0;
+}
+
+/* Carries out the queued requests in order, up to the one waited for. */
+void
+ata_wait (ata_request_t* req)
+{
+    ata_request_t* head;
+    uint8_t* sectors;
+
+    while (!req->finished && NULL != (head = queue_head)) {
+        if (NULL == (queue_head = head->next))
+            queue_tail = NULL;
+        sectors = host_disk + head->lba * ATA_SECTOR_SIZE;
+        if (head->write)
+            memcpy (sectors, head->buf, head->count * ATA_SECTOR_SIZE);
+        else
+            memcpy (head->buf, sectors, head->count * ATA_SECTOR_SIZE);
+        host_disk_requests++;
+        head->status = 0;
+        if (NULL != head->callback)
+            head->callback (head);
+        head->finished = 1;
+    }
+}
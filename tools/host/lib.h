@@ -0,0 +1,16 @@
+/* lib.h - Stand-in for the kernel's lib.h when fs.c is built for Linux.
+ * The string functions are the C library's. There are no interrupts to
+ * turn off: the benchmark is the only process.
+ */
+
+#ifndef _LIB_H
+#define _LIB_H
+
+#include <string.h>
+
+#include "types.h"
+
+#define cli_and_save(flags)     ((flags) = 0)
+#define restore_flags(flags)    ((void)(flags))
+
+#endif /* _LIB_H */
@@ -0,0 +1,12 @@
+/* scheduler.h - Stand-in for the kernel's scheduler.h when fs.c is built
+ * for Linux.
+ */
+
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include "types.h"
+#include "syscall.h"
+#include "wait.h"
+
+#endif /* _SCHEDULER_H */
@@ -0,0 +1,42 @@
+/* syscall.h - Stand-in for the kernel's syscall.h when fs.c is built for
+ * Linux: the parts of a process that the file operations use.
+ */
+
+#ifndef _SYSCALL_H
+#define _SYSCALL_H
+
+#include "types.h"
+
+#define FD_ARRAY_LEN    8
+
+typedef struct fd_entry_t {
+    void* fo_jump_table_ptr;
+    uint32_t inode_index;
+    uint32_t file_position;
+    uint32_t flags;
+} fd_entry_t;
+
+typedef struct pcb_t {
+    fd_entry_t fd_array[FD_ARRAY_LEN];
+} pcb_t;
+
+/* Matches the kernel's, the record getdents fills in. */
+typedef struct dirent_t {
+    uint32_t inode_index;
+    uint32_t file_type;
+    uint32_t length;
+    uint8_t name[32 + 1];
+    uint8_t reserved[3];
+} dirent_t;
+
+/* The one process, defined in host.c. */
+extern int current_pid;
+extern pcb_t host_pcb;
+
+static inline pcb_t*
+get_current_executing_pcb (void)
+{
+    return &host_pcb;
+}
+
+#endif /* _SYSCALL_H */
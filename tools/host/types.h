@@ -0,0 +1,11 @@
+/* types.h - Stand-in for the kernel's types.h when fs.c is built for Linux.
+ * The C library's types have the same sizes.
+ */
+
+#ifndef _TYPES_H
+#define _TYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#endif /* _TYPES_H */
@@ -0,0 +1,24 @@
+/* uaccess.h - Stand-in for the kernel's uaccess.h when fs.c is built for
+ * Linux, where "user" buffers are just memory.
+ */
+
+#ifndef _UACCESS_H
+#define _UACCESS_H
+
+#include "types.h"
+
+static inline int32_t
+copy_from_user (void* to, const void* from, uint32_t n)
+{
+    memcpy (to, from, n);
+    return 0;
+}
+
+static inline int32_t
+copy_to_user (void* to, const void* from, uint32_t n)
+{
+    memcpy (to, from, n);
+    return 0;
+}
+
+#endif /* _UACCESS_H */
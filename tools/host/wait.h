@@ -0,0 +1,19 @@
+/* wait.h - Stand-in for the kernel's wait queues when fs.c is built for
+ * Linux. Nothing ever waits: the only process never finds the filesystem
+ * lock taken, and disk requests are done by the time ata_wait returns.
+ */
+
+#ifndef _WAIT_H
+#define _WAIT_H
+
+#include "types.h"
+
+typedef struct wait_queue_t {
+    volatile uint32_t waiters;
+} wait_queue_t;
+
+static inline void init_wait_queue (wait_queue_t* wq) { wq->waiters = 0; }
+static inline void sleep_on_uninterruptible (wait_queue_t* wq) { }
+static inline void wake_up (wait_queue_t* wq) { }
+
+#endif /* _WAIT_H */
@@ -0,0 +1,109 @@
+/* lz4enc.c - LZ4 block compressor for the host tools.
+ *
+ * A greedy compressor: each position is looked up in a table of where its
+ * first four bytes were last seen, and a match found there is extended as
+ * far as it goes. The output follows the LZ4 block format, including its
+ * rule that the last five bytes are literals and the last match starts
+ * twelve bytes before the end, so any LZ4 decoder reads it.
+ */
+
+#include <string.h>
+
+#include "lz4enc.h"
+
+#define HASH_BITS       12
+#define MIN_MATCH       4
+#define MAX_OFFSET      65535
+#define LAST_LITERALS   5
+#define MATCH_LIMIT     12
+
+static uint32_t
+hash4 (const uint8_t* p)
+{
+    uint32_t v;
+
+    memcpy (&v, p, sizeof (v));
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/* Writes a length that did not fit in the token's 4 bits. */
+static int
+put_length (uint8_t** out, uint8_t* end, uint32_t len)
+{
+    for (; len >= 255; len -= 255) {
+        if (*out == end)
+            return -1;
+        *(*out)++ = 255;
+    }
+    if (*out == end)
+        return -1;
+    *(*out)++ = len;
+    return 0;
+}
+
+/* Writes a sequence: literals, then a match unless match_len is 0. */
+static int
+put_sequence (uint8_t** out, uint8_t* end, const uint8_t* lit,
+              uint32_t lit_len, uint32_t offset, uint32_t match_len)
+{
+    uint32_t ml = match_len ? match_len - MIN_MATCH : 0;
+
+    if (*out == end)
+        return -1;
+    *(*out)++ = ((lit_len < 15 ? lit_len : 15) << 4) | (ml < 15 ? ml : 15);
+    if (lit_len >= 15 && 0 != put_length (out, end, lit_len - 15))
+        return -1;
+    if ((uint32_t)(end - *out) < lit_len)
+        return -1;
+    memcpy (*out, lit, lit_len);
+    *out += lit_len;
+    if (0 == match_len)
+        return 0;
+    if (end - *out < 2)
+        return -1;
+    *(*out)++ = offset & 0xFF;
+    *(*out)++ = offset >> 8;
+    if (ml >= 15 && 0 != put_length (out, end, ml - 15))
+        return -1;
+    return 0;
+}
+
+uint32_t
+lz4_compress (const uint8_t* src, uint32_t len, uint8_t* dst, uint32_t cap)
+{
+    int32_t table[1 << HASH_BITS];
+    uint8_t* out = dst;
+    uint8_t* end = dst + cap;
+    uint32_t anchor = 0, i = 0, ref, match_len;
+    uint32_t h;
+
+    memset (table, -1, sizeof (table));
+    while (len > MATCH_LIMIT && i < len - MATCH_LIMIT) {
+        h = hash4 (src + i);
+        ref = table[h];
+        table[h] = i;
+        if ((uint32_t)-1 == ref || i - ref > MAX_OFFSET ||
+            0 != memcmp (src + ref, src + i, MIN_MATCH)) {
+            i++;
+            continue;
+        }
+        match_len = MIN_MATCH;
+        while (i + match_len < len - LAST_LITERALS &&
+               src[ref + match_len] == src[i + match_len])
+            match_len++;
+        /* take in bytes before the match that also match */
+        while (i > anchor && ref > 0 && src[i - 1] == src[ref - 1]) {
+            i--;
+            ref--;
+            match_len++;
+        }
+        if (0 != put_sequence (&out, end, src + anchor, i - anchor, i - ref,
+                               match_len))
+            return 0;
+        i += match_len;
+        anchor = i;
+    }
+    if (0 != put_sequence (&out, end, src + anchor, len - anchor, 0, 0))
+        return 0;
+    return out - dst;
+}
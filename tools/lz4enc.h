@@ -0,0 +1,18 @@
+/* lz4enc.h - LZ4 block compressor for the host tools. */
+
+#ifndef _LZ4ENC_H
+#define _LZ4ENC_H
+
+#include <stdint.h>
+
+/* Compresses src into one LZ4 block in dst. Returns the compressed size,
+ * or 0 if it would take more than cap bytes. */
+uint32_t lz4_compress (const uint8_t* src, uint32_t len, uint8_t* dst,
+                       uint32_t cap);
+
+/* The kernel's decoder, student-distrib/lz4.c. Returns the bytes written
+ * to dst, or -1 for a corrupt block. */
+int32_t lz4_decompress (const uint8_t* src, uint32_t src_len, uint8_t* dst,
+                        uint32_t dst_len);
+
+#endif /* _LZ4ENC_H */
@@ -0,0 +1,131 @@
+/* zbench.c - Times the kernel's LZ4 decoder against a plain copy.
+ *
+ * Compresses the given files a 4kB block at a time, as createfs -z does,
+ * checks that every block decompresses back to what it was, then times
+ * reading all the blocks back by decompressing them and by copying them
+ * uncompressed. The difference is what reading a compressed image costs
+ * over reading a plain one, once the blocks are in memory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fsimg.h"
+#include "lz4enc.h"
+
+#define DEFAULT_ROUNDS  200
+
+typedef struct block_t {
+    uint8_t* raw;               /* the block of the file */
+    uint8_t* data;              /* as stored: compressed, or not */
+    uint32_t stored;
+    uint32_t size;
+} block_t;
+
+static block_t* blocks;
+static uint32_t num_blocks;
+
+static double
+now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Splits a file into blocks and compresses each one. */
+static void
+add_file (const char* path)
+{
+    uint8_t buf[FS_BLOCK_SIZE], out[FS_BLOCK_SIZE];
+    uint32_t size, len;
+    block_t* b;
+    FILE* fp;
+
+    if (NULL == (fp = fopen (path, "rb"))) {
+        perror (path);
+        exit (1);
+    }
+    while (0 != (size = fread (buf, 1, sizeof (buf), fp))) {
+        len = lz4_compress (buf, size, out, size - 1);
+        if (NULL == (blocks = realloc (blocks, (num_blocks + 1) * sizeof (block_t)))) {
+            perror ("zbench");
+            exit (1);
+        }
+        b = &blocks[num_blocks++];
+        b->size = size;
+        b->stored = len ? len : size;
+        b->raw = malloc (size);
+        b->data = malloc (b->stored);
+        memcpy (b->raw, buf, size);
+        memcpy (b->data, len ? out : buf, b->stored);
+    }
+    fclose (fp);
+}
+
+int
+main (int argc, char* argv[])
+{
+    static uint8_t dst[FS_BLOCK_SIZE];
+    uint64_t bytes = 0, stored = 0;
+    uint32_t sum = 0;
+    uint32_t i, r, rounds = DEFAULT_ROUNDS;
+    double t, t_lz4, t_copy;
+    int arg = 1;
+
+    if (argc > 2 && 0 == strcmp (argv[1], "-r")) {
+        rounds = strtoul (argv[2], NULL, 0);
+        arg = 3;
+    }
+    if (arg >= argc) {
+        fprintf (stderr, "usage: %s [-r <rounds>] <file>...\n", argv[0]);
+        return 2;
+    }
+    for (; arg < argc; arg++)
+        add_file (argv[arg]);
+
+    for (i = 0; i < num_blocks; i++) {
+        bytes += blocks[i].size;
+        stored += blocks[i].stored;
+        if (blocks[i].stored != blocks[i].size &&
+            ((int32_t)blocks[i].size != lz4_decompress (blocks[i].data,
+                 blocks[i].stored, dst, sizeof (dst)) ||
+             0 != memcmp (dst, blocks[i].raw, blocks[i].size))) {
+            fprintf (stderr, "block %u does not decompress\n", i);
+            return 1;
+        }
+    }
+
+    /* the sums keep the copies from being optimized away */
+    t = now ();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < num_blocks; i++) {
+            if (blocks[i].stored == blocks[i].size)
+                memcpy (dst, blocks[i].data, blocks[i].size);
+            else
+                lz4_decompress (blocks[i].data, blocks[i].stored, dst,
+                                sizeof (dst));
+            sum += dst[i % blocks[i].size];
+        }
+    }
+    t_lz4 = now () - t;
+
+    t = now ();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < num_blocks; i++) {
+            memcpy (dst, blocks[i].raw, blocks[i].size);
+            sum -= dst[i % blocks[i].size];
+        }
+    }
+    t_copy = now () - t;
+
+    printf ("%u blocks, %llu bytes stored in %llu (%.1f%%)\n", num_blocks,
+            (unsigned long long)bytes, (unsigned long long)stored,
+            100.0 * stored / bytes);
+    printf ("decompress: %8.1f MB/s\n", rounds * bytes / t_lz4 / 1e6);
+    printf ("copy:       %8.1f MB/s\n", rounds * bytes / t_copy / 1e6);
+    return 0 != sum;
+}